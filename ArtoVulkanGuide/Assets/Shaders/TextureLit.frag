@@ -1,9 +1,11 @@
 //glsl version 4.5
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 //shader input
 layout (location = 0) in vec3 inColor;
 layout (location = 1) in vec2 texCoord;
+layout (location = 2) flat in uint inMaterial;
 //output write
 layout (location = 0) out vec4 outFragColor;
 
@@ -16,10 +18,27 @@ layout(set = 0, binding = 1) uniform SceneData
     vec4 sunlightColor;
 } sceneData;
 
-layout(set = 2, binding = 0) uniform sampler2D tex;
+// 和GPUMaterialData一致，按材质ID存放
+struct MaterialData
+{
+    uint textureIndex;
+    uint pad0;
+    uint pad1;
+    uint pad2;
+};
+
+layout(std430, set = 2, binding = 0) readonly buffer MaterialBuffer
+{
+    MaterialData materials[];
+} materialBuffer;
+
+// 所有贴图的数组，只有材质用到的槽位写入过
+layout(set = 2, binding = 1) uniform sampler2D textures[];
 
 void main()
 {
-    vec3 color = texture(tex, texCoord).xyz;
+    // 一次Draw里的物体可能用不同的贴图，下标不是一致的
+    uint textureIndex = materialBuffer.materials[inMaterial].textureIndex;
+    vec3 color = texture(textures[nonuniformEXT(textureIndex)], texCoord).xyz;
     outFragColor = vec4(color, 1.0f);
 }
\ No newline at end of file
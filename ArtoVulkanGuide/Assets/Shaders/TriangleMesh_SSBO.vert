@@ -7,6 +7,7 @@ layout (location = 3) in vec2 vTexCoord;
 
 layout (location = 0) out vec3 outColor;
 layout (location = 1) out vec2 texCoord;
+layout (location = 2) flat out uint outMaterial;
 
 layout(set = 0, binding = 0) uniform CameraBuffer
 {
@@ -18,6 +19,10 @@ layout(set = 0, binding = 0) uniform CameraBuffer
 struct ObjectData
 {
     mat4 model;
+    uint materialIndex;
+    uint pad0;
+    uint pad1;
+    uint pad2;
 };
 
 //all object matrices
@@ -26,18 +31,14 @@ layout(std140, set = 1, binding = 0) readonly buffer ObjectBuffer
     ObjectData objects[];
 } objectBuffer;
 
-//push constants block
-layout( push_constant ) uniform constants
-{
-    vec4 data;
-    mat4 render_matrix;
-} PushConstants;
-
 void main()
 {
-    mat4 modelMatrix = objectBuffer.objects[gl_BaseInstance].model;
+    // gl_InstanceIndex = firstInstance + 实例序号，同一个Instanced Draw里的物体连续存放
+    mat4 modelMatrix = objectBuffer.objects[gl_InstanceIndex].model;
     mat4 transformMatrix = (cameraData.viewproj * modelMatrix);
     gl_Position = transformMatrix * vec4(vPosition, 1.0f);
     outColor = vColor;
     texCoord = vTexCoord;
+    // 同一个Instanced Draw里的物体可以是不同的材质
+    outMaterial = objectBuffer.objects[gl_InstanceIndex].materialIndex;
 }
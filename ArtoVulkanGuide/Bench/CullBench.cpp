@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "VulkanObjects/VKCulling.hpp"
+
+// 只测CPU剔除，不需要GPU
+// 例: CullBench --objects 100000 --iterations 200 --min-pixels 2
+int main(int argc, char* argv[])
+{
+    uint32_t objectCount = 100000;
+    uint32_t iterations = 200;
+    float minPixels = 2.0f;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool bHasValue = i + 1 < argc;
+
+        if (arg == "--objects" && bHasValue)         objectCount = (uint32_t)std::atoi(argv[++i]);
+        else if (arg == "--iterations" && bHasValue) iterations = (uint32_t)std::atoi(argv[++i]);
+        else if (arg == "--min-pixels" && bHasValue) minPixels = (float)std::atof(argv[++i]);
+    }
+
+    // 物体随机分布在相机周围，大约一部分在视锥体外，一部分远到可以按尺寸剔除
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> posDist(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> scaleDist(0.1f, 4.0f);
+
+    SceneCuller culler;
+    culler.Reserve(objectCount);
+    for (uint32_t i = 0; i < objectCount; i++)
+    {
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(posDist(rng), posDist(rng) * 0.1f, posDist(rng)));
+        transform = glm::scale(transform, glm::vec3(scaleDist(rng)));
+        culler.Add(glm::vec3(0.0f), 1.0f, glm::vec3(0.6f), transform);
+    }
+
+    glm::vec3 cameraPos(0.0f, 2.0f, 10.0f);
+    glm::mat4 view = glm::lookAt(cameraPos, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 proj = glm::perspective(glm::radians(70.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    proj[1][1] *= -1;
+    CullView cullView = CullView::FromMatrices(proj * view, proj, cameraPos, 1080.0f, minPixels);
+
+    std::vector<uint32_t> visible(objectCount);
+    std::vector<uint32_t> reference(objectCount);
+
+    auto run = [&](const char* name, auto&& cull)
+    {
+        uint32_t visibleCount = cull(visible.data());
+        auto start = std::chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            visibleCount = cull(visible.data());
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double ms = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+        std::cout << name << ": " << visibleCount << "/" << objectCount << " visible | "
+            << ms << "ms | " << (uint64_t)(objectCount / ms) << " objects/ms" << std::endl;
+        return visibleCount;
+    };
+
+    uint32_t referenceCount = run("Scalar", [&](uint32_t* out) { return culler.CullScalar(cullView, out); });
+    reference.assign(visible.begin(), visible.begin() + referenceCount);
+    uint32_t simdCount = run(SceneCuller::GetSIMDName(), [&](uint32_t* out) { return culler.Cull(cullView, out); });
+
+    // 两条路径的运算顺序一样，结果应该完全相同
+    if (simdCount != referenceCount || !std::equal(reference.begin(), reference.end(), visible.begin()))
+    {
+        std::cout << "SIMD result differs from scalar" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
\ No newline at end of file
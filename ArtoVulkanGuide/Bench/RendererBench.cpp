@@ -0,0 +1,82 @@
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include "VulkanObjects/VKEngine.hpp"
+
+// 不开窗口渲染固定帧数，每帧的计时写进CSV
+// 加上--target-ms可以测试动态分辨率
+// 例: RendererBench --objects 20000 --materials 16 --meshes 8 --textures 8 --bench-frames 500 --csv bench.csv
+int main(int argc, char* argv[])
+{
+    uint32_t warmupFrames = 60;
+    uint32_t benchFrames = 600;
+    std::string csvPath = "RendererBench.csv";
+    VkExtent2D extent {1024, 576};
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool bHasValue = i + 1 < argc;
+
+        if (arg == "--warmup" && bHasValue)            warmupFrames = (uint32_t)std::atoi(argv[++i]);
+        else if (arg == "--bench-frames" && bHasValue) benchFrames = (uint32_t)std::atoi(argv[++i]);
+        else if (arg == "--csv" && bHasValue)          csvPath = argv[++i];
+        else if (arg == "--width" && bHasValue)        extent.width = (uint32_t)std::atoi(argv[++i]);
+        else if (arg == "--height" && bHasValue)       extent.height = (uint32_t)std::atoi(argv[++i]);
+    }
+
+    VulkanEngine engine;
+    engine.mConfig = EngineConfig::FromCommandLine(argc, argv);
+    engine.mConfig.mbHeadless = true;
+    engine.mConfig.mbRecordTimings = true;
+    // 默认是initScene的41x41网格
+    if (engine.mConfig.mScene.mObjects == 0)
+    {
+        engine.mConfig.mScene.mObjects = 41 * 41;
+    }
+    engine.mWndExtent = extent;
+
+    engine.Init();
+    for (uint32_t i = 0; i < warmupFrames + benchFrames; i++)
+    {
+        engine.Draw();
+    }
+    // CleanUp会等GPU空闲并读回最后几帧的时间戳
+    engine.CleanUp();
+
+    std::ofstream csv(csvPath);
+    if (!csv.is_open())
+    {
+        std::cout << "Fail to open " << csvPath << std::endl;
+        return 1;
+    }
+
+    csv << "frame,cpu_ms,record_ms,submit_ms,gpu_ms,render_scale\n";
+    FrameTimings total {};
+    uint32_t count = 0;
+    for (auto & timings : engine.mFrameTimings)
+    {
+        if (timings.mFrame < warmupFrames) continue;
+
+        csv << timings.mFrame - warmupFrames << "," << timings.mCPUMs << "," << timings.mRecordMs << ","
+            << timings.mSubmitMs << "," << timings.mGPUMs << "," << timings.mRenderScale << "\n";
+
+        total.mCPUMs += timings.mCPUMs;
+        total.mRecordMs += timings.mRecordMs;
+        total.mSubmitMs += timings.mSubmitMs;
+        total.mGPUMs += timings.mGPUMs;
+        count++;
+    }
+
+    if (count > 0)
+    {
+        std::cout << "Bench " << count << " frames | cpu " << total.mCPUMs / count << "ms"
+            << " | record " << total.mRecordMs / count << "ms"
+            << " | submit " << total.mSubmitMs / count << "ms"
+            << " | gpu " << total.mGPUMs / count << "ms"
+            << " -> " << csvPath << std::endl;
+    }
+
+    return 0;
+}
\ No newline at end of file
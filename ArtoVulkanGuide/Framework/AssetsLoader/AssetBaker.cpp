@@ -331,16 +331,33 @@ bool ConvertMesh(const fs::path &input, const fs::path &output)
 
     ExtractMeshFromObj(shapes, attrib, indices, vertices);
 
+    //the obj is extracted as a triangle soup, weld it first so the simplifier can collapse edges and meshlets share vertices
+    size_t soupVertices = vertices.size();
+    vertices.resize(Assets::WeldVertices(vertices.data(), vertices.size(), indices.data()));
+    std::cout << "welded: " << soupVertices << " -> " << vertices.size() << " vertices" << std::endl;
+
     MeshInfo meshInfo;
     meshInfo.mVertexFormat = vertexFormatEnum;
     meshInfo.mVBSize = vertices.size() * sizeof(VertexFormat);
-    meshInfo.mIBSize = indices.size() * sizeof(uint32_t);
     meshInfo.mIndexSize = sizeof(uint32_t);
     meshInfo.mOriginalFile = input.string();
     meshInfo.mBounds = Assets::CalculateBounds(vertices.data(), vertices.size());
 
+    //meshlets cover LOD0 only, the simplified LODs are appended to the index buffer afterwards
+    Assets::MeshletData meshlets = Assets::BuildMeshlets(vertices.data(), vertices.size(), indices.data(), indices.size());
+    std::cout << "meshlets: " << meshlets.mMeshlets.size() << std::endl;
+
+    meshInfo.mLods = Assets::BuildLods(vertices.data(), vertices.size(), indices);
+    meshInfo.mIBSize = indices.size() * sizeof(uint32_t);
+    std::cout << "lods: " << meshInfo.mLods.size() << ", " << meshInfo.mLods.front().mIndexCount / 3 << " -> " << meshInfo.mLods.back().mIndexCount / 3 << " triangles" << std::endl;
+    //a mesh big enough to simplify that still ends with one lod usually means every vertex got locked, e.g. unwelded input
+    if (meshInfo.mLods.size() == 1 && meshInfo.mLods.front().mIndexCount / 3 >= Assets::MESH_LOD_MIN_TRIANGLES * 2)
+    {
+        std::cout << "WARN: " << input.string() << " produced a single lod, check for hard edges or unwelded vertices" << std::endl;
+    }
+
     auto start = std::chrono::high_resolution_clock::now();
-    Assets::AssetFile newFile = Assets::PackMesh(&meshInfo, (char*)vertices.data(), (char*)indices.data());
+    Assets::AssetFile newFile = Assets::PackMesh(&meshInfo, (char*)vertices.data(), (char*)indices.data(), &meshlets);
     auto  end = std::chrono::high_resolution_clock::now();
 
     diff = end - start;
@@ -569,12 +586,15 @@ bool ExtractGLTFMesh(
             MeshInfo meshInfo;
             meshInfo.mVertexFormat = VertexFormatEnum;
             meshInfo.mVBSize = vertices.size() * sizeof(VertexFormat);
-            meshInfo.mIBSize = indices.size() * sizeof(uint32_t);
             meshInfo.mIndexSize = sizeof(uint32_t);
             meshInfo.mOriginalFile = input.string();
             meshInfo.mBounds = Assets::CalculateBounds(vertices.data(), vertices.size());
 
-            Assets::AssetFile newFile = Assets::PackMesh(&meshInfo, (char*)vertices.data(), (char*)indices.data());
+            Assets::MeshletData meshlets = Assets::BuildMeshlets(vertices.data(), vertices.size(), indices.data(), indices.size());
+            meshInfo.mLods = Assets::BuildLods(vertices.data(), vertices.size(), indices);
+            meshInfo.mIBSize = indices.size() * sizeof(uint32_t);
+
+            Assets::AssetFile newFile = Assets::PackMesh(&meshInfo, (char*)vertices.data(), (char*)indices.data(), &meshlets);
 
             fs::path meshPath = outputFolder / (meshName + ".mesh");
 
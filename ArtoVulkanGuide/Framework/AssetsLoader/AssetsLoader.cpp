@@ -1,6 +1,8 @@
 #include <fstream>
 #include <iostream>
 
+#include <Tracy.hpp>
+
 #include "AssetsLoader.hpp"
 
 namespace Assets
@@ -40,6 +42,7 @@ namespace Assets
 
     bool LoadBinaryFile(const char *path, AssetFile& outFile)
     {
+        ZoneScoped;
         std::ifstream inFile;
         inFile.open(path, std::ios::binary);
 
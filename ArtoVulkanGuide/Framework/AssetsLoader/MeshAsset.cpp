@@ -1,5 +1,8 @@
+#include <cstring>
+
 #include "json.hpp"
 #include "lz4.h"
+#include <Tracy.hpp>
 
 #include "MeshAsset.hpp"
 
@@ -30,6 +33,18 @@ namespace Assets
         info.mVBSize = metaData["VertexBufferSize"];
         info.mIBSize = metaData["IndexBufferSize"];
         info.mIndexSize = (uint8_t)metaData["IndexSize"];
+        //version 1 assets have no meshlets
+        info.mMeshletCount = metaData.value("MeshletCount", uint64_t(0));
+        info.mMeshletVertexCount = metaData.value("MeshletVertexCount", uint64_t(0));
+        info.mMeshletTriangleCount = metaData.value("MeshletTriangleCount", uint64_t(0));
+        //version 3 adds the LOD chain, stored as [firstIndex, indexCount, error]
+        if (metaData.contains("Lods"))
+        {
+            for (const nlohmann::json& lod : metaData["Lods"])
+            {
+                info.mLods.push_back({ lod[0].get<uint32_t>(), lod[1].get<uint32_t>(), lod[2].get<float>() });
+            }
+        }
         info.mOriginalFile = metaData["OriginalFile"];
 
         std::string compressionString = metaData["Compression"];
@@ -54,11 +69,16 @@ namespace Assets
         return info;
     }
 
-    void UnpackMesh(MeshInfo *info, const char *srcBuffer, size_t srcSize, char *vertexBuffer, char *indexBuffer)
+    void UnpackMesh(MeshInfo *info, const char *srcBuffer, size_t srcSize, char *vertexBuffer, char *indexBuffer, MeshletData *meshlets)
     {
+        ZoneScoped;
+        size_t meshletSize = info->mMeshletCount * sizeof(Meshlet);
+        size_t meshletVertexSize = info->mMeshletVertexCount * sizeof(uint32_t);
+        size_t meshletTriangleSize = info->mMeshletTriangleCount * sizeof(uint32_t);
+
         //decompressing into temporal vector. TODO: streaming decompress directly on the buffers
         std::vector<char> decompressedBuffer;
-        decompressedBuffer.resize(info->mVBSize + info->mIBSize);
+        decompressedBuffer.resize(info->mVBSize + info->mIBSize + meshletSize + meshletVertexSize + meshletTriangleSize);
 
         LZ4_decompress_safe(srcBuffer, decompressedBuffer.data(), static_cast<int>(srcSize), static_cast<int>(decompressedBuffer.size()));
 
@@ -66,16 +86,33 @@ namespace Assets
         memcpy(vertexBuffer, decompressedBuffer.data(), info->mVBSize);
         //copy index buffer
         memcpy(indexBuffer, decompressedBuffer.data() + info->mVBSize, info->mIBSize);
+
+        //meshlets are stored after the index buffer
+        if (meshlets)
+        {
+            const char* meshletData = decompressedBuffer.data() + info->mVBSize + info->mIBSize;
+            meshlets->mMeshlets.resize(info->mMeshletCount);
+            meshlets->mVertices.resize(info->mMeshletVertexCount);
+            meshlets->mTriangles.resize(info->mMeshletTriangleCount);
+
+            memcpy(meshlets->mMeshlets.data(), meshletData, meshletSize);
+            memcpy(meshlets->mVertices.data(), meshletData + meshletSize, meshletVertexSize);
+            memcpy(meshlets->mTriangles.data(), meshletData + meshletSize + meshletVertexSize, meshletTriangleSize);
+        }
     }
 
-    AssetFile PackMesh(MeshInfo *info, char *vertexData, char *indexData)
+    AssetFile PackMesh(MeshInfo *info, char *vertexData, char *indexData, const MeshletData *meshlets)
     {
         AssetFile file;
         file.mType[0] = 'M';
         file.mType[1] = 'E';
         file.mType[2] = 'S';
         file.mType[3] = 'H';
-        file.mVersion = 1;
+        file.mVersion = 3;
+
+        info->mMeshletCount = meshlets ? meshlets->mMeshlets.size() : 0;
+        info->mMeshletVertexCount = meshlets ? meshlets->mVertices.size() : 0;
+        info->mMeshletTriangleCount = meshlets ? meshlets->mTriangles.size() : 0;
 
         nlohmann::json metadata;
         if (info->mVertexFormat == VertexFormat::P32N8C8V16) {
@@ -88,6 +125,15 @@ namespace Assets
         metadata["VertexBufferSize"] = info->mVBSize;
         metadata["IndexBufferSize"] = info->mIBSize;
         metadata["IndexSize"] = info->mIndexSize;
+        metadata["MeshletCount"] = info->mMeshletCount;
+        metadata["MeshletVertexCount"] = info->mMeshletVertexCount;
+        metadata["MeshletTriangleCount"] = info->mMeshletTriangleCount;
+        nlohmann::json lods = nlohmann::json::array();
+        for (const MeshLod& lod : info->mLods)
+        {
+            lods.push_back({ lod.mFirstIndex, lod.mIndexCount, lod.mError });
+        }
+        metadata["Lods"] = lods;
         metadata["OriginalFile"] = info->mOriginalFile;
 
         std::vector<float> boundsData;
@@ -105,7 +151,10 @@ namespace Assets
 
         metadata["Bounds"] = boundsData;
 
-        size_t fullSize = info->mVBSize + info->mIBSize;
+        size_t meshletSize = info->mMeshletCount * sizeof(Meshlet);
+        size_t meshletVertexSize = info->mMeshletVertexCount * sizeof(uint32_t);
+        size_t meshletTriangleSize = info->mMeshletTriangleCount * sizeof(uint32_t);
+        size_t fullSize = info->mVBSize + info->mIBSize + meshletSize + meshletVertexSize + meshletTriangleSize;
 
         std::vector<char> mergedBuffer;
         mergedBuffer.resize(fullSize);
@@ -116,6 +165,15 @@ namespace Assets
         //copy index buffer
         memcpy(mergedBuffer.data() + info->mVBSize, indexData, info->mIBSize);
 
+        //copy meshlets
+        if (meshlets)
+        {
+            char* meshletData = mergedBuffer.data() + info->mVBSize + info->mIBSize;
+            memcpy(meshletData, meshlets->mMeshlets.data(), meshletSize);
+            memcpy(meshletData + meshletSize, meshlets->mVertices.data(), meshletVertexSize);
+            memcpy(meshletData + meshletSize + meshletVertexSize, meshlets->mTriangles.data(), meshletTriangleSize);
+        }
+
         //compress buffer and copy it into the file struct
         size_t compressStaging = LZ4_compressBound(static_cast<int>(fullSize));
 
@@ -136,7 +194,7 @@ namespace Assets
         MeshBounds bounds{};
 
         float min[3] = { std::numeric_limits<float>::max(),std::numeric_limits<float>::max(),std::numeric_limits<float>::max() };
-        float max[3] = { std::numeric_limits<float>::min(),std::numeric_limits<float>::min(),std::numeric_limits<float>::min() };
+        float max[3] = { std::numeric_limits<float>::lowest(),std::numeric_limits<float>::lowest(),std::numeric_limits<float>::lowest() };
 
         for (int i = 0; i < count; i++)
         {
@@ -173,4 +231,517 @@ namespace Assets
 
         return bounds;
     }
+
+    //FNV-1a over the raw words, -0/0 and different NaNs count as different vertices which is harmless
+    static uint32_t HashVertex(const VertexF32PNCV &vertex)
+    {
+        static_assert(sizeof(VertexF32PNCV) % sizeof(uint32_t) == 0, "VertexF32PNCV must not have padding");
+        uint32_t words[sizeof(VertexF32PNCV) / sizeof(uint32_t)];
+        std::memcpy(words, &vertex, sizeof(VertexF32PNCV));
+
+        uint32_t hash = 2166136261u;
+        for (uint32_t word : words)
+        {
+            hash = (hash ^ word) * 16777619u;
+            hash ^= hash >> 15;
+        }
+        return hash;
+    }
+
+    size_t WeldVertices(VertexF32PNCV *vertices, size_t count, uint32_t *outIndices)
+    {
+        ZoneScoped;
+        //open addressing table holding indices of the welded vertices, at least twice the vertex count
+        size_t tableSize = 1;
+        while (tableSize < count * 2) tableSize <<= 1;
+        std::vector<uint32_t> table(tableSize, UINT32_MAX);
+
+        //a new vertex is always appended right after the welded ones, never past the one being read, so it can be written in place
+        uint32_t uniqueCount = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            const VertexF32PNCV vertex = vertices[i];
+            size_t slot = HashVertex(vertex) & (tableSize - 1);
+            while (table[slot] != UINT32_MAX && std::memcmp(&vertices[table[slot]], &vertex, sizeof(VertexF32PNCV)) != 0)
+            {
+                slot = (slot + 1) & (tableSize - 1);
+            }
+
+            if (table[slot] == UINT32_MAX)
+            {
+                table[slot] = uniqueCount;
+                vertices[uniqueCount++] = vertex;
+            }
+            outIndices[i] = table[slot];
+        }
+        return uniqueCount;
+    }
+
+    //symmetric 4x4 quadric, plus the accumulated weight used to normalize the error
+    struct Quadric
+    {
+        double mA[10] = {};
+        double mWeight = 0.0;
+
+        void AddPlane(double a, double b, double c, double d, double weight)
+        {
+            mA[0] += weight * a * a; mA[1] += weight * a * b; mA[2] += weight * a * c; mA[3] += weight * a * d;
+            mA[4] += weight * b * b; mA[5] += weight * b * c; mA[6] += weight * b * d;
+            mA[7] += weight * c * c; mA[8] += weight * c * d;
+            mA[9] += weight * d * d;
+            mWeight += weight;
+        }
+
+        void Add(const Quadric& other)
+        {
+            for (int i = 0; i < 10; i++) mA[i] += other.mA[i];
+            mWeight += other.mWeight;
+        }
+
+        //mean squared distance of p to the accumulated planes
+        double Evaluate(const float* p) const
+        {
+            double x = p[0], y = p[1], z = p[2];
+            double error =
+                mA[0] * x * x + 2.0 * mA[1] * x * y + 2.0 * mA[2] * x * z + 2.0 * mA[3] * x +
+                mA[4] * y * y + 2.0 * mA[5] * y * z + 2.0 * mA[6] * y +
+                mA[7] * z * z + 2.0 * mA[8] * z +
+                mA[9];
+            return mWeight > 0.0 ? std::max(error, 0.0) / mWeight : 0.0;
+        }
+    };
+
+    //keeps the quadrics between calls so a LOD chain is simplified incrementally from the original mesh
+    class MeshSimplifier
+    {
+    public:
+        MeshSimplifier(const VertexF32PNCV *vertices, size_t vertexCount, const uint32_t *indices, size_t indexCount)
+            : mVertices(vertices), mIndices(indices, indices + indexCount), mQuadrics(vertexCount), mLocked(vertexCount, false)
+        {
+            //vertices sharing a position with another vertex are on an attribute seam
+            std::vector<uint32_t> sorted(vertexCount);
+            for (uint32_t i = 0; i < vertexCount; i++) sorted[i] = i;
+            auto lessPosition = [&](uint32_t a, uint32_t b)
+            {
+                const float* pa = vertices[a].mPosition;
+                const float* pb = vertices[b].mPosition;
+                if (pa[0] != pb[0]) return pa[0] < pb[0];
+                if (pa[1] != pb[1]) return pa[1] < pb[1];
+                return pa[2] < pb[2];
+            };
+            std::sort(sorted.begin(), sorted.end(), lessPosition);
+            for (size_t i = 1; i < sorted.size(); i++)
+            {
+                if (!lessPosition(sorted[i - 1], sorted[i]))
+                {
+                    mLocked[sorted[i - 1]] = true;
+                    mLocked[sorted[i]] = true;
+                }
+            }
+
+            //edges used by a single triangle are on an open border
+            std::vector<uint64_t> edges;
+            edges.reserve(indexCount);
+            for (size_t i = 0; i + 2 < indexCount; i += 3)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    uint32_t a = indices[i + k];
+                    uint32_t b = indices[i + (k + 1) % 3];
+                    edges.push_back((uint64_t)std::min(a, b) << 32 | std::max(a, b));
+                }
+            }
+            std::sort(edges.begin(), edges.end());
+            for (size_t i = 0; i < edges.size();)
+            {
+                size_t j = i;
+                while (j < edges.size() && edges[j] == edges[i]) j++;
+                if (j - i == 1)
+                {
+                    mLocked[(uint32_t)(edges[i] >> 32)] = true;
+                    mLocked[(uint32_t)(edges[i] & 0xFFFFFFFF)] = true;
+                }
+                i = j;
+            }
+
+            //area weighted plane of every triangle
+            for (size_t i = 0; i + 2 < indexCount; i += 3)
+            {
+                float n[3];
+                float area = triangleNormal(vertices[indices[i]].mPosition, vertices[indices[i + 1]].mPosition, vertices[indices[i + 2]].mPosition, n);
+                if (area == 0.0f) continue;
+                const float* p = vertices[indices[i]].mPosition;
+                double d = -(n[0] * p[0] + n[1] * p[1] + n[2] * p[2]);
+                for (int k = 0; k < 3; k++)
+                {
+                    mQuadrics[indices[i + k]].AddPlane(n[0], n[1], n[2], d, area);
+                }
+            }
+        }
+
+        const std::vector<uint32_t>& Simplify(size_t targetIndexCount)
+        {
+            const size_t vertexCount = mQuadrics.size();
+            std::vector<uint32_t> collapseTarget(vertexCount);
+            std::vector<bool> touched(vertexCount);
+
+            while (mIndices.size() > targetIndexCount)
+            {
+                //vertex to triangle adjacency of the current indices
+                std::vector<uint32_t> triangleOffsets(vertexCount + 1, 0);
+                for (uint32_t index : mIndices) triangleOffsets[index + 1]++;
+                for (size_t v = 0; v < vertexCount; v++) triangleOffsets[v + 1] += triangleOffsets[v];
+                std::vector<uint32_t> adjacency(mIndices.size());
+                std::vector<uint32_t> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+                for (size_t i = 0; i < mIndices.size(); i++) adjacency[cursor[mIndices[i]]++] = (uint32_t)(i / 3);
+
+                //every directed edge v0 -> v1 where v0 is allowed to move
+                struct Collapse
+                {
+                    uint32_t mV0;
+                    uint32_t mV1;
+                    double mCost;
+                };
+                std::vector<Collapse> collapses;
+                collapses.reserve(mIndices.size() * 2);
+                for (size_t i = 0; i < mIndices.size(); i += 3)
+                {
+                    for (int k = 0; k < 3; k++)
+                    {
+                        uint32_t a = mIndices[i + k];
+                        uint32_t b = mIndices[i + (k + 1) % 3];
+                        if (!mLocked[a]) collapses.push_back({ a, b, collapseCost(a, b) });
+                        if (!mLocked[b]) collapses.push_back({ b, a, collapseCost(b, a) });
+                    }
+                }
+                std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.mCost < b.mCost; });
+
+                //cheapest collapses first, a vertex and its neighbourhood change at most once per pass
+                for (size_t v = 0; v < vertexCount; v++) collapseTarget[v] = (uint32_t)v;
+                std::fill(touched.begin(), touched.end(), false);
+                size_t trianglesToRemove = (mIndices.size() - targetIndexCount) / 3;
+                size_t removed = 0;
+                for (const Collapse& collapse : collapses)
+                {
+                    if (removed >= trianglesToRemove) break;
+                    if (touched[collapse.mV0] || touched[collapse.mV1]) continue;
+                    if (flipsTriangle(collapse.mV0, collapse.mV1, triangleOffsets, adjacency)) continue;
+
+                    collapseTarget[collapse.mV0] = collapse.mV1;
+                    mQuadrics[collapse.mV1].Add(mQuadrics[collapse.mV0]);
+                    mMaxError = std::max(mMaxError, collapse.mCost);
+
+                    for (uint32_t t = triangleOffsets[collapse.mV0]; t < triangleOffsets[collapse.mV0 + 1]; t++)
+                    {
+                        const uint32_t* triangle = &mIndices[adjacency[t] * 3];
+                        bool bShared = triangle[0] == collapse.mV1 || triangle[1] == collapse.mV1 || triangle[2] == collapse.mV1;
+                        removed += bShared ? 1 : 0;
+                        touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+                    }
+                }
+                if (removed == 0) break;
+
+                //remap the indices and drop the triangles that became degenerate
+                size_t write = 0;
+                for (size_t i = 0; i < mIndices.size(); i += 3)
+                {
+                    uint32_t a = collapseTarget[mIndices[i + 0]];
+                    uint32_t b = collapseTarget[mIndices[i + 1]];
+                    uint32_t c = collapseTarget[mIndices[i + 2]];
+                    if (a == b || b == c || c == a) continue;
+                    mIndices[write++] = a;
+                    mIndices[write++] = b;
+                    mIndices[write++] = c;
+                }
+                mIndices.resize(write);
+            }
+            return mIndices;
+        }
+
+        float GetError() const { return (float)std::sqrt(mMaxError); }
+
+    private:
+        static float triangleNormal(const float *a, const float *b, const float *c, float *outNormal)
+        {
+            float e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            float e1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+            float n[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+            float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (length == 0.0f) return 0.0f;
+            outNormal[0] = n[0] / length;
+            outNormal[1] = n[1] / length;
+            outNormal[2] = n[2] / length;
+            return length * 0.5f;
+        }
+
+        double collapseCost(uint32_t v0, uint32_t v1) const
+        {
+            Quadric q = mQuadrics[v0];
+            q.Add(mQuadrics[v1]);
+            return q.Evaluate(mVertices[v1].mPosition);
+        }
+
+        //moving v0 onto v1 must not turn any remaining triangle around v0 upside down
+        bool flipsTriangle(uint32_t v0, uint32_t v1, const std::vector<uint32_t> &triangleOffsets, const std::vector<uint32_t> &adjacency) const
+        {
+            for (uint32_t t = triangleOffsets[v0]; t < triangleOffsets[v0 + 1]; t++)
+            {
+                const uint32_t* triangle = &mIndices[adjacency[t] * 3];
+                if (triangle[0] == v1 || triangle[1] == v1 || triangle[2] == v1) continue;
+
+                const float* p[3];
+                const float* moved[3];
+                for (int k = 0; k < 3; k++)
+                {
+                    p[k] = mVertices[triangle[k]].mPosition;
+                    moved[k] = triangle[k] == v0 ? mVertices[v1].mPosition : p[k];
+                }
+                float before[3], after[3];
+                if (triangleNormal(p[0], p[1], p[2], before) == 0.0f) continue;
+                if (triangleNormal(moved[0], moved[1], moved[2], after) == 0.0f) return true;
+                if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] < 0.25f) return true;
+            }
+            return false;
+        }
+
+    private:
+        const VertexF32PNCV* mVertices;
+        std::vector<uint32_t> mIndices;
+        std::vector<Quadric> mQuadrics;
+        std::vector<bool> mLocked;
+        double mMaxError = 0.0;
+    };
+
+    std::vector<uint32_t> SimplifyMesh(const VertexF32PNCV *vertices, size_t vertexCount, const uint32_t *indices, size_t indexCount, size_t targetIndexCount, float *outError)
+    {
+        ZoneScoped;
+        MeshSimplifier simplifier(vertices, vertexCount, indices, indexCount);
+        std::vector<uint32_t> result = simplifier.Simplify(targetIndexCount);
+        if (outError)
+        {
+            *outError = simplifier.GetError();
+        }
+        return result;
+    }
+
+    std::vector<MeshLod> BuildLods(const VertexF32PNCV *vertices, size_t vertexCount, std::vector<uint32_t> &indices)
+    {
+        ZoneScoped;
+        std::vector<MeshLod> lods;
+        lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+
+        MeshSimplifier simplifier(vertices, vertexCount, indices.data(), indices.size());
+        size_t currentCount = indices.size();
+        while (lods.size() < MESH_MAX_LODS)
+        {
+            size_t targetCount = currentCount / 6 * 3;
+            if (targetCount < MESH_LOD_MIN_TRIANGLES * 3) break;
+
+            const std::vector<uint32_t>& lodIndices = simplifier.Simplify(targetCount);
+            //stop when the mesh can barely be reduced any more, e.g. everything left is locked
+            if (lodIndices.size() > currentCount * 3 / 4) break;
+
+            lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lodIndices.size()), simplifier.GetError() });
+            indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+            currentCount = lodIndices.size();
+        }
+        return lods;
+    }
+
+    static void ComputeMeshletBounds(const VertexF32PNCV *vertices, const MeshletData &data, Meshlet &meshlet)
+    {
+        const uint32_t* meshletVertices = data.mVertices.data() + meshlet.mVertexOffset;
+        const uint32_t* meshletTriangles = data.mTriangles.data() + meshlet.mTriangleOffset;
+
+        //bounding sphere around the center of the AABB
+        float min[3] = { std::numeric_limits<float>::max(),std::numeric_limits<float>::max(),std::numeric_limits<float>::max() };
+        float max[3] = { std::numeric_limits<float>::lowest(),std::numeric_limits<float>::lowest(),std::numeric_limits<float>::lowest() };
+        for (uint32_t i = 0; i < meshlet.mVertexCount; i++)
+        {
+            const float* p = vertices[meshletVertices[i]].mPosition;
+            for (int k = 0; k < 3; k++)
+            {
+                min[k] = std::min(min[k], p[k]);
+                max[k] = std::max(max[k], p[k]);
+            }
+        }
+        for (int k = 0; k < 3; k++)
+        {
+            meshlet.mCenter[k] = (min[k] + max[k]) * 0.5f;
+        }
+
+        float r2 = 0;
+        for (uint32_t i = 0; i < meshlet.mVertexCount; i++)
+        {
+            const float* p = vertices[meshletVertices[i]].mPosition;
+            float dx = p[0] - meshlet.mCenter[0];
+            float dy = p[1] - meshlet.mCenter[1];
+            float dz = p[2] - meshlet.mCenter[2];
+            r2 = std::max(r2, dx * dx + dy * dy + dz * dz);
+        }
+        meshlet.mRadius = std::sqrt(r2);
+
+        //normal cone from the face normals
+        std::vector<float> normals;
+        normals.reserve(meshlet.mTriangleCount * 3);
+        float axis[3] = { 0.0f, 0.0f, 0.0f };
+        for (uint32_t i = 0; i < meshlet.mTriangleCount; i++)
+        {
+            uint32_t packed = meshletTriangles[i];
+            const float* a = vertices[meshletVertices[packed & 0xFF]].mPosition;
+            const float* b = vertices[meshletVertices[(packed >> 8) & 0xFF]].mPosition;
+            const float* c = vertices[meshletVertices[(packed >> 16) & 0xFF]].mPosition;
+
+            float e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            float e1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+            float n[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+            float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            //skip degenerate triangles
+            if (length == 0.0f)
+            {
+                continue;
+            }
+            for (int k = 0; k < 3; k++)
+            {
+                normals.push_back(n[k] / length);
+                axis[k] += n[k] / length;
+            }
+        }
+
+        float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+        meshlet.mConeAxis[0] = axisLength > 0.0f ? axis[0] / axisLength : 0.0f;
+        meshlet.mConeAxis[1] = axisLength > 0.0f ? axis[1] / axisLength : 0.0f;
+        meshlet.mConeAxis[2] = axisLength > 0.0f ? axis[2] / axisLength : 0.0f;
+
+        float minDot = 1.0f;
+        for (size_t i = 0; i < normals.size(); i += 3)
+        {
+            float d = normals[i] * meshlet.mConeAxis[0] + normals[i + 1] * meshlet.mConeAxis[1] + normals[i + 2] * meshlet.mConeAxis[2];
+            minDot = std::min(minDot, d);
+        }
+
+        //the cone is too wide to ever be fully backfacing
+        if (axisLength == 0.0f || minDot <= 0.1f)
+        {
+            meshlet.mConeCutoff = 1.0f;
+        }
+        else
+        {
+            meshlet.mConeCutoff = std::sqrt(1.0f - minDot * minDot);
+        }
+    }
+
+    MeshletData BuildMeshlets(const VertexF32PNCV *vertices, size_t vertexCount, const uint32_t *indices, size_t indexCount)
+    {
+        ZoneScoped;
+        MeshletData data;
+
+        //local index of every mesh vertex in the current meshlet, 0xFF if not used yet
+        std::vector<uint8_t> localIndex(vertexCount, 0xFF);
+
+        Meshlet current{};
+        auto flush = [&]()
+        {
+            if (current.mTriangleCount == 0)
+            {
+                return;
+            }
+            for (uint32_t i = 0; i < current.mVertexCount; i++)
+            {
+                localIndex[data.mVertices[current.mVertexOffset + i]] = 0xFF;
+            }
+            ComputeMeshletBounds(vertices, data, current);
+            data.mMeshlets.push_back(current);
+
+            current = {};
+            current.mVertexOffset = static_cast<uint32_t>(data.mVertices.size());
+            current.mTriangleOffset = static_cast<uint32_t>(data.mTriangles.size());
+        };
+
+        //vertex -> triangle adjacency, so a meshlet grows through its neighbours instead of following the index order
+        const size_t triangleCount = indexCount / 3;
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+        {
+            adjacencyOffsets[indices[i] + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        {
+            std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < triangleCount * 3; i++)
+            {
+                adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        auto countNewVertices = [&](size_t triangle)
+        {
+            uint32_t a = indices[triangle * 3 + 0];
+            uint32_t b = indices[triangle * 3 + 1];
+            uint32_t c = indices[triangle * 3 + 2];
+            return (uint32_t)(localIndex[a] == 0xFF) + (localIndex[b] == 0xFF && b != a) + (localIndex[c] == 0xFF && c != a && c != b);
+        };
+
+        std::vector<bool> emitted(triangleCount, false);
+        size_t nextSeed = 0;
+        for (size_t n = 0; n < triangleCount; n++)
+        {
+            //take the unused triangle touching the current meshlet that adds the fewest vertices,
+            //start from the next unused one in index order when nothing touches it
+            size_t triangle = SIZE_MAX;
+            uint32_t newVertices = 4;
+            for (uint32_t i = 0; i < current.mVertexCount && newVertices > 0; i++)
+            {
+                uint32_t v = data.mVertices[current.mVertexOffset + i];
+                for (uint32_t j = adjacencyOffsets[v]; j < adjacencyOffsets[v + 1]; j++)
+                {
+                    uint32_t candidate = adjacency[j];
+                    if (emitted[candidate]) continue;
+                    uint32_t candidateNew = countNewVertices(candidate);
+                    if (candidateNew < newVertices)
+                    {
+                        triangle = candidate;
+                        newVertices = candidateNew;
+                    }
+                }
+            }
+            if (triangle == SIZE_MAX)
+            {
+                while (emitted[nextSeed]) nextSeed++;
+                triangle = nextSeed;
+                newVertices = countNewVertices(triangle);
+            }
+            emitted[triangle] = true;
+
+            uint32_t a = indices[triangle * 3 + 0];
+            uint32_t b = indices[triangle * 3 + 1];
+            uint32_t c = indices[triangle * 3 + 2];
+
+            if (current.mVertexCount + newVertices > MESHLET_MAX_VERTICES || current.mTriangleCount + 1 > MESHLET_MAX_TRIANGLES)
+            {
+                flush();
+            }
+
+            uint32_t packed = 0;
+            uint32_t corner[3] = { a, b, c };
+            for (int k = 0; k < 3; k++)
+            {
+                if (localIndex[corner[k]] == 0xFF)
+                {
+                    localIndex[corner[k]] = static_cast<uint8_t>(current.mVertexCount++);
+                    data.mVertices.push_back(corner[k]);
+                }
+                packed |= static_cast<uint32_t>(localIndex[corner[k]]) << (8 * k);
+            }
+            data.mTriangles.push_back(packed);
+            current.mTriangleCount++;
+        }
+        flush();
+
+        return data;
+    }
 }
\ No newline at end of file
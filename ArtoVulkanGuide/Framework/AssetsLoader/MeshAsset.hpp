@@ -33,10 +33,56 @@ namespace Assets
         float mExtents[3];
     };
 
+    // 每个Meshlet最多的顶点和三角形数，和Mesh Shader的输出上限一致
+    constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+    constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+    // 布局和Shader里的std430结构一致
+    struct Meshlet
+    {
+        float mCenter[3];
+        float mRadius;
+        // 法线锥，mConeCutoff为1时不做背面剔除
+        float mConeAxis[3];
+        float mConeCutoff;
+        uint32_t mVertexOffset;
+        uint32_t mTriangleOffset;
+        uint32_t mVertexCount;
+        uint32_t mTriangleCount;
+    };
+
+    struct MeshletData
+    {
+        std::vector<Meshlet> mMeshlets;
+        // Meshlet的局部顶点到Mesh顶点的索引
+        std::vector<uint32_t> mVertices;
+        // 每个三角形的三个局部顶点索引打包成a | b << 8 | c << 16
+        std::vector<uint32_t> mTriangles;
+    };
+
+    // LOD 0是原始网格，之后每一级的三角形数大约减半
+    constexpr uint32_t MESH_MAX_LODS = 8;
+    // 三角形少于这个数时不再生成更粗的LOD
+    constexpr uint32_t MESH_LOD_MIN_TRIANGLES = 32;
+
+    struct MeshLod
+    {
+        // 在索引Buffer里的范围，单位是索引，所有LOD共用同一份顶点
+        uint32_t mFirstIndex;
+        uint32_t mIndexCount;
+        // 和原始网格的偏差，物体空间的距离
+        float mError;
+    };
+
     struct MeshInfo
     {
         uint64_t mVBSize;
         uint64_t mIBSize;
+        uint64_t mMeshletCount = 0;
+        uint64_t mMeshletVertexCount = 0;
+        uint64_t mMeshletTriangleCount = 0;
+        // 为空时整个索引Buffer就是唯一的LOD
+        std::vector<MeshLod> mLods;
         MeshBounds mBounds;
         VertexFormat mVertexFormat;
         char mIndexSize;
@@ -45,7 +91,17 @@ namespace Assets
     };
 
     MeshInfo ReadMeshInfo(AssetFile* file);
-    void UnpackMesh(MeshInfo* info, const char* srcBuffer, size_t srcSize, char* vertexBuffer, char* indexBuffer);
-    AssetFile PackMesh(MeshInfo* info, char* vertexData, char* indexData);
+    void UnpackMesh(MeshInfo* info, const char* srcBuffer, size_t srcSize, char* vertexBuffer, char* indexBuffer, MeshletData* meshlets = nullptr);
+    AssetFile PackMesh(MeshInfo* info, char* vertexData, char* indexData, const MeshletData* meshlets = nullptr);
     MeshBounds CalculateBounds(VertexF32PNCV* vertices, size_t count);
+    // 合并没有索引的三角形列表里按位相同的顶点，合并后的顶点按第一次出现的顺序写回vertices的开头
+    // outIndices要有count个位置，返回合并后的顶点数，简化和Meshlet都需要合并后的网格
+    size_t WeldVertices(VertexF32PNCV* vertices, size_t count, uint32_t* outIndices);
+    // 二次误差度量(QEM)的边坍缩，顶点只合并到已有的顶点上，简化后的索引仍然使用原来的顶点
+    // 纹理接缝和开放边界上的顶点不移动，返回简化后的索引，outError是和原始网格的偏差
+    std::vector<uint32_t> SimplifyMesh(const VertexF32PNCV* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount, size_t targetIndexCount, float* outError = nullptr);
+    // indices里的三角形是LOD 0，逐级减半简化，每一级的索引追加到indices后面
+    std::vector<MeshLod> BuildLods(const VertexF32PNCV* vertices, size_t vertexCount, std::vector<uint32_t>& indices);
+    // 按索引顺序贪心地把三角形分成Meshlet，并计算每个Meshlet的包围球和法线锥
+    MeshletData BuildMeshlets(const VertexF32PNCV* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount);
 }
\ No newline at end of file
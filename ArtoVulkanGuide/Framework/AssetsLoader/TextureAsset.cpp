@@ -1,6 +1,7 @@
 #include <iostream>
 #include "json.hpp"
 #include "lz4.h"
+#include <Tracy.hpp>
 
 #include "TextureAsset.hpp"
 
@@ -49,6 +50,7 @@ namespace Assets
 
     void UnpackTexture(TextureInfo *info, const char *srcBuffer, size_t srcSize, char *dst)
     {
+        ZoneScoped;
         if (info->mCompressionMode == CompressionMode::LZ4)
         {
             for (auto& page : info->mPages)
@@ -65,6 +67,7 @@ namespace Assets
 
     void UnpackTexturePage(TextureInfo *info, int pageIndex, char *srcBuffer, char *dst)
     {
+        ZoneScoped;
         char* source = srcBuffer;
         for (int i = 0; i < pageIndex; i++)
         {
@@ -0,0 +1,155 @@
+#include "VKAllocator.hpp"
+
+static const char* MEMORY_CLASS_NAMES[] = { "DeviceLocal", "Staging", "PerFrame" };
+
+void BufferAllocator::Init(VmaAllocator allocator, VkDeviceSize blockSize, VkDeviceSize perFrameSize)
+{
+    mAllocator = allocator;
+
+    // 静态数据可能被任何阶段读取，用所有可能的Usage选内存类型
+    createPool(MemoryClass::DeviceLocal,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, blockSize, false);
+    createPool(MemoryClass::Staging, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0, blockSize, false);
+    // 线性Pool只能有一块，大小正好放下所有帧的数据
+    createPool(MemoryClass::PerFrame, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, perFrameSize, true);
+}
+
+void BufferAllocator::createPool(MemoryClass memoryClass, VkBufferUsageFlags sampleUsage, VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags,
+    VkDeviceSize blockSize, bool bLinear)
+{
+    Pool& pool = mPools[static_cast<uint32_t>(memoryClass)];
+    pool.mRequiredFlags = requiredFlags;
+    pool.mPreferredFlags = preferredFlags;
+    pool.mSmallLimit = bLinear ? blockSize : blockSize / 4;
+
+    VkBufferCreateInfo sampleCI = {};
+    sampleCI.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    sampleCI.pNext = nullptr;
+    sampleCI.size = 1024;
+    sampleCI.usage = sampleUsage;
+
+    VmaAllocationCreateInfo sampleAllocCI = {};
+    sampleAllocCI.requiredFlags = requiredFlags;
+    sampleAllocCI.preferredFlags = preferredFlags;
+    VK_CHECK(vmaFindMemoryTypeIndexForBufferInfo(mAllocator, &sampleCI, &sampleAllocCI, &pool.mMemoryType));
+
+    VmaPoolCreateInfo poolCI = {};
+    poolCI.memoryTypeIndex = pool.mMemoryType;
+    poolCI.flags = bLinear ? VMA_POOL_CREATE_LINEAR_ALGORITHM_BIT : 0;
+    poolCI.blockSize = blockSize;
+    poolCI.maxBlockCount = bLinear ? 1 : 0;
+    VK_CHECK(vmaCreatePool(mAllocator, &poolCI, &pool.mPool));
+}
+
+void BufferAllocator::Destroy()
+{
+    for (Pool& pool : mPools)
+    {
+        vmaDestroyPool(mAllocator, pool.mPool);
+        pool = Pool {};
+    }
+}
+
+AllocatedBuffer BufferAllocator::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, MemoryClass memoryClass, void** outMappedData)
+{
+    Pool& pool = mPools[static_cast<uint32_t>(memoryClass)];
+
+    VkBufferCreateInfo bufferCI = {};
+    bufferCI.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCI.pNext = nullptr;
+    bufferCI.size = size;
+    bufferCI.usage = usage;
+
+    VmaAllocationCreateInfo vmaAllocCI = {};
+    vmaAllocCI.flags = outMappedData ? VMA_ALLOCATION_CREATE_MAPPED_BIT : 0;
+
+    AllocatedBuffer newBuffer {};
+    VmaAllocationInfo allocInfo {};
+    VkResult result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    if (size <= pool.mSmallLimit)
+    {
+        // Pool满了，或者这个Usage不能用Pool的内存类型时会失败，退回到单独分配
+        vmaAllocCI.pool = pool.mPool;
+        result = vmaCreateBuffer(mAllocator, &bufferCI, &vmaAllocCI, &newBuffer.mBuffer, &newBuffer.mAllocation, &allocInfo);
+    }
+    if (result != VK_SUCCESS)
+    {
+        return CreateDedicatedBuffer(size, usage, memoryClass, outMappedData);
+    }
+
+    if (outMappedData)
+    {
+        *outMappedData = allocInfo.pMappedData;
+    }
+    return newBuffer;
+}
+
+AllocatedBuffer BufferAllocator::CreateDedicatedBuffer(VkDeviceSize size, VkBufferUsageFlags usage, MemoryClass memoryClass, void** outMappedData)
+{
+    Pool& pool = mPools[static_cast<uint32_t>(memoryClass)];
+
+    VkBufferCreateInfo bufferCI = {};
+    bufferCI.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCI.pNext = nullptr;
+    bufferCI.size = size;
+    bufferCI.usage = usage;
+
+    VmaAllocationCreateInfo vmaAllocCI = {};
+    vmaAllocCI.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT | (outMappedData ? VMA_ALLOCATION_CREATE_MAPPED_BIT : 0);
+    vmaAllocCI.requiredFlags = pool.mRequiredFlags;
+    vmaAllocCI.preferredFlags = pool.mPreferredFlags;
+
+    AllocatedBuffer newBuffer {};
+    VmaAllocationInfo allocInfo {};
+    VK_CHECK(vmaCreateBuffer(mAllocator, &bufferCI, &vmaAllocCI, &newBuffer.mBuffer, &newBuffer.mAllocation, &allocInfo));
+    pool.mDedicatedCount++;
+
+    if (outMappedData)
+    {
+        *outMappedData = allocInfo.pMappedData;
+    }
+    return newBuffer;
+}
+
+void BufferAllocator::DestroyBuffer(const AllocatedBuffer& buffer)
+{
+    vmaDestroyBuffer(mAllocator, buffer.mBuffer, buffer.mAllocation);
+}
+
+BufferPoolStats BufferAllocator::GetPoolStats(MemoryClass memoryClass) const
+{
+    VmaPoolStats poolStats {};
+    vmaGetPoolStats(mAllocator, mPools[static_cast<uint32_t>(memoryClass)].mPool, &poolStats);
+
+    BufferPoolStats stats;
+    stats.mBlockCount = poolStats.blockCount;
+    stats.mBlockBytes = poolStats.size;
+    stats.mAllocationCount = poolStats.allocationCount;
+    stats.mUsedBytes = poolStats.size - poolStats.unusedSize;
+    return stats;
+}
+
+void BufferAllocator::PrintStats() const
+{
+    std::cout << "Buffer pools:" << std::endl;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(MemoryClass::Count); i++)
+    {
+        BufferPoolStats stats = GetPoolStats(static_cast<MemoryClass>(i));
+        std::cout << "    " << MEMORY_CLASS_NAMES[i] << " (type " << mPools[i].mMemoryType << "): "
+            << stats.mAllocationCount << " buffers, " << stats.mUsedBytes / 1024 << "/" << stats.mBlockBytes / 1024 << " KB in "
+            << stats.mBlockCount << " blocks, " << mPools[i].mDedicatedCount << " dedicated" << std::endl;
+    }
+
+    // 包括图片和单独分配的Buffer
+    VmaStats vmaStats {};
+    vmaCalculateStats(mAllocator, &vmaStats);
+    const VkPhysicalDeviceProperties* props = nullptr;
+    vmaGetPhysicalDeviceProperties(mAllocator, &props);
+    std::cout << "    device memory allocations " << vmaStats.total.blockCount << "/" << props->limits.maxMemoryAllocationCount
+        << ", " << vmaStats.total.allocationCount << " resources" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+
+#include "VKTypes.hpp"
+
+// Buffer内存的用途分类，每类一个VMA自定义Pool
+enum class MemoryClass : uint32_t
+{
+    // 只有GPU访问的数据，DEVICE_LOCAL
+    DeviceLocal = 0,
+    // CPU写入、Transfer读取的Staging，HOST_VISIBLE | HOST_COHERENT
+    Staging,
+    // 每帧CPU写、GPU直接读的常驻映射Buffer，优先选同时DEVICE_LOCAL的类型
+    PerFrame,
+    Count,
+};
+
+struct BufferPoolStats
+{
+    // 向驱动申请的VkDeviceMemory
+    uint64_t mBlockCount = 0;
+    VkDeviceSize mBlockBytes = 0;
+    // 从这些块里子分配出的Buffer
+    uint64_t mAllocationCount = 0;
+    VkDeviceSize mUsedBytes = 0;
+};
+
+// VMA之上的Buffer分配层，所有Buffer都从这里创建，用vmaDestroyBuffer或DestroyBuffer释放
+// 小Buffer从所属分类的Pool里的大块显存中子分配，不再每个Buffer一次vkAllocateMemory
+// 超过块大小1/4的Buffer单独分配，避免大块里留下碎片
+// PerFrame是线性Pool，只有一块，每帧的Buffer按创建顺序紧挨着放
+// 内存类型按Property Flags显式选择，不依赖VmaMemoryUsage
+class BufferAllocator
+{
+public:
+    // perFrameSize是所有帧的PerFrame Buffer加起来的大小
+    void Init(VmaAllocator allocator, VkDeviceSize blockSize, VkDeviceSize perFrameSize);
+    void Destroy();
+
+    // outMappedData不为空时Buffer常驻映射，只能用于Staging和PerFrame
+    AllocatedBuffer CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, MemoryClass memoryClass, void** outMappedData = nullptr);
+    // 不进Pool，单独占一块VkDeviceMemory，销毁时立即还给驱动
+    // 用于运行中会整块释放的大Buffer，Pool会保留空块，释放后显存用量不会下降
+    AllocatedBuffer CreateDedicatedBuffer(VkDeviceSize size, VkBufferUsageFlags usage, MemoryClass memoryClass, void** outMappedData = nullptr);
+    void DestroyBuffer(const AllocatedBuffer& buffer);
+
+    BufferPoolStats GetPoolStats(MemoryClass memoryClass) const;
+    // 每个Pool的统计，以及整个设备的VkDeviceMemory个数和maxMemoryAllocationCount的对比
+    void PrintStats() const;
+
+    VmaAllocator GetVmaAllocator() const { return mAllocator; }
+
+private:
+    struct Pool
+    {
+        VmaPool mPool = VK_NULL_HANDLE;
+        uint32_t mMemoryType = UINT32_MAX;
+        VkMemoryPropertyFlags mRequiredFlags = 0;
+        VkMemoryPropertyFlags mPreferredFlags = 0;
+        // 不超过这个大小的Buffer从Pool里分配
+        VkDeviceSize mSmallLimit = 0;
+        // 超过mSmallLimit或者Pool放不下，单独分配的次数
+        uint64_t mDedicatedCount = 0;
+    };
+
+    void createPool(MemoryClass memoryClass, VkBufferUsageFlags sampleUsage, VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags,
+        VkDeviceSize blockSize, bool bLinear);
+
+private:
+    VmaAllocator mAllocator = VK_NULL_HANDLE;
+    Pool mPools[static_cast<uint32_t>(MemoryClass::Count)];
+};
\ No newline at end of file
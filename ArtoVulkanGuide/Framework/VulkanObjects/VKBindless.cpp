@@ -0,0 +1,103 @@
+#include <array>
+#include <iostream>
+
+#include "VKBindless.hpp"
+#include "VKInitializers.hpp"
+
+void BindlessTable::Init(VkDevice device, DescriptorLayoutCache& layoutCache, uint32_t capacity)
+{
+    mDevice = device;
+    mCapacity = capacity;
+
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings {
+        VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 0),
+        VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1)
+    };
+    bindings[1].descriptorCount = mCapacity;
+
+    // 材质Buffer在第一次绑定之前写入，不需要标记
+    // UPDATE_UNUSED_WHILE_PENDING：提交之后还能更新这一帧没有用到的槽位
+    std::array<VkDescriptorBindingFlags, 2> bindingFlags {
+        0,
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+    };
+    mLayout = layoutCache.CreateLayout(bindings.data(), static_cast<uint32_t>(bindings.size()),
+        VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT, bindingFlags.data());
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes {{
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, mCapacity }
+    }};
+    VkDescriptorPoolCreateInfo poolCI {};
+    poolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolCI.pNext = nullptr;
+    poolCI.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolCI.maxSets = 1;
+    poolCI.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolCI.pPoolSizes = poolSizes.data();
+    VK_CHECK(vkCreateDescriptorPool(mDevice, &poolCI, nullptr, &mPool));
+
+    VkDescriptorSetAllocateInfo descSetAI {};
+    descSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descSetAI.pNext = nullptr;
+    descSetAI.descriptorPool = mPool;
+    descSetAI.descriptorSetCount = 1;
+    descSetAI.pSetLayouts = &mLayout;
+    VK_CHECK(vkAllocateDescriptorSets(mDevice, &descSetAI, &mSet));
+}
+
+void BindlessTable::Destroy()
+{
+    vkDestroyDescriptorPool(mDevice, mPool, nullptr);
+    mPool = VK_NULL_HANDLE;
+    mSet = VK_NULL_HANDLE;
+}
+
+uint32_t BindlessTable::AllocateTexture()
+{
+    if (mTextureCount >= mCapacity)
+    {
+        std::cout << "Bindless texture table is full: " << mCapacity << " textures" << std::endl;
+        abort();
+    }
+    return mTextureCount++;
+}
+
+void BindlessTable::WriteTexture(uint32_t index, VkSampler sampler, VkImageView imageView)
+{
+    VkDescriptorImageInfo imageInfo {};
+    imageInfo.sampler = sampler;
+    imageInfo.imageView = imageView;
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkWriteDescriptorSet write {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.pNext = nullptr;
+    write.dstSet = mSet;
+    write.dstBinding = 1;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(mDevice, 1, &write, 0, nullptr);
+    mTextureWrites++;
+}
+
+void BindlessTable::WriteMaterials(VkBuffer buffer, VkDeviceSize range)
+{
+    VkDescriptorBufferInfo bufferInfo {};
+    bufferInfo.buffer = buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = range;
+
+    VkWriteDescriptorSet write {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.pNext = nullptr;
+    write.dstSet = mSet;
+    write.dstBinding = 0;
+    write.dstArrayElement = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(mDevice, 1, &write, 0, nullptr);
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+#include "VKTypes.hpp"
+#include "VKDescriptors.hpp"
+
+constexpr uint32_t BINDLESS_INVALID_INDEX = UINT32_MAX;
+// 贴图数组的大小，设备的UPDATE_AFTER_BIND上限更小时取上限
+constexpr uint32_t MAX_BINDLESS_TEXTURES = 4096;
+
+// 所有材质共用的Set 2：binding 0是材质Buffer，binding 1是所有贴图的数组
+// 着色器用物体数据里的材质下标找到材质，再用材质里的贴图下标采样，换材质不需要重新绑定描述符集
+// 贴图数组带PARTIALLY_BOUND和UPDATE_AFTER_BIND，没写入或已经驱逐的槽位只要不被采样就合法，
+// 在飞帧没有用到的槽位可以在描述符集绑定之后直接重写
+class BindlessTable
+{
+public:
+    // capacity是贴图数组的大小，调用者按设备上限截断
+    void Init(VkDevice device, DescriptorLayoutCache& layoutCache, uint32_t capacity);
+    // 布局由DescriptorLayoutCache销毁
+    void Destroy();
+
+    // 分配一个贴图槽位，用完时报错退出
+    uint32_t AllocateTexture();
+    // 调用时在飞的帧不能采样这个槽位
+    void WriteTexture(uint32_t index, VkSampler sampler, VkImageView imageView);
+    // 材质Buffer在场景确定后、第一次绑定之前写入一次
+    void WriteMaterials(VkBuffer buffer, VkDeviceSize range);
+
+    VkDescriptorSetLayout GetLayout() const { return mLayout; }
+    VkDescriptorSet GetSet() const { return mSet; }
+    uint32_t GetCapacity() const { return mCapacity; }
+    uint32_t GetTextureCount() const { return mTextureCount; }
+
+    // 统计信息
+    uint64_t mTextureWrites = 0;
+
+private:
+    VkDevice mDevice = VK_NULL_HANDLE;
+    VkDescriptorSetLayout mLayout = VK_NULL_HANDLE;
+    // 带UPDATE_AFTER_BIND的描述符集只能从带同样标记的Pool分配，单独一个Pool
+    VkDescriptorPool mPool = VK_NULL_HANDLE;
+    VkDescriptorSet mSet = VK_NULL_HANDLE;
+    uint32_t mCapacity = 0;
+    uint32_t mTextureCount = 0;
+};
\ No newline at end of file
@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <cmath>
+
+#include "VKCulling.hpp"
+
+#include <Tracy.hpp>
+
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define ARTO_CULL_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define ARTO_CULL_SSE
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    #include <arm_neon.h>
+    #define ARTO_CULL_NEON
+#endif
+
+CullView CullView::FromMatrices(const glm::mat4& viewProj, const glm::mat4& proj, const glm::vec3& cameraPos, float viewportHeight, float minPixels)
+{
+    CullView view {};
+
+    // glm是列主序，第i行是(m[0][i], m[1][i], m[2][i], m[3][i])
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++)
+    {
+        rows[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+    }
+    view.mPlanes[0] = rows[3] + rows[0];
+    view.mPlanes[1] = rows[3] - rows[0];
+    view.mPlanes[2] = rows[3] + rows[1];
+    view.mPlanes[3] = rows[3] - rows[1];
+    // Vulkan的深度范围是[0, 1]，近平面是z >= 0
+    view.mPlanes[4] = rows[2];
+    view.mPlanes[5] = rows[3] - rows[2];
+    for (auto & plane : view.mPlanes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    view.mCameraPos = cameraPos;
+    // proj[1][1]是cot(fov/2)，Y翻转过的矩阵是负数
+    view.mProjScale = std::abs(proj[1][1]) * viewportHeight * 0.5f;
+    view.mMinPixels = minPixels;
+    return view;
+}
+
+void SceneCuller::Clear()
+{
+    for (auto* v : { &mCenterX, &mCenterY, &mCenterZ, &mRadius, &mMinX, &mMinY, &mMinZ, &mMaxX, &mMaxY, &mMaxZ })
+    {
+        v->clear();
+    }
+}
+
+void SceneCuller::Reserve(size_t count)
+{
+    for (auto* v : { &mCenterX, &mCenterY, &mCenterZ, &mRadius, &mMinX, &mMinY, &mMinZ, &mMaxX, &mMaxY, &mMaxZ })
+    {
+        v->reserve(count);
+    }
+}
+
+uint32_t SceneCuller::Add(const glm::vec3& localCenter, float localRadius, const glm::vec3& localExtents, const glm::mat4& transform)
+{
+    uint32_t index = GetCount();
+    for (auto* v : { &mCenterX, &mCenterY, &mCenterZ, &mRadius, &mMinX, &mMinY, &mMinZ, &mMaxX, &mMaxY, &mMaxZ })
+    {
+        v->push_back(0.0f);
+    }
+    Update(index, localCenter, localRadius, localExtents, transform);
+    return index;
+}
+
+void SceneCuller::Update(uint32_t index, const glm::vec3& localCenter, float localRadius, const glm::vec3& localExtents, const glm::mat4& transform)
+{
+    glm::vec3 center = glm::vec3(transform * glm::vec4(localCenter, 1.0f));
+
+    // 半径按最大的轴缩放，非均匀缩放时球会偏大但不会漏掉
+    glm::vec3 axisX = glm::vec3(transform[0]);
+    glm::vec3 axisY = glm::vec3(transform[1]);
+    glm::vec3 axisZ = glm::vec3(transform[2]);
+    float scale = std::max({ glm::length(axisX), glm::length(axisY), glm::length(axisZ) });
+
+    // 变换后的AABB半长 = |M| * 局部半长
+    glm::vec3 extents = glm::abs(axisX) * localExtents.x + glm::abs(axisY) * localExtents.y + glm::abs(axisZ) * localExtents.z;
+
+    mCenterX[index] = center.x;
+    mCenterY[index] = center.y;
+    mCenterZ[index] = center.z;
+    mRadius[index] = localRadius * scale;
+    mMinX[index] = center.x - extents.x;
+    mMinY[index] = center.y - extents.y;
+    mMinZ[index] = center.z - extents.z;
+    mMaxX[index] = center.x + extents.x;
+    mMaxY[index] = center.y + extents.y;
+    mMaxZ[index] = center.z + extents.z;
+}
+
+const char* SceneCuller::GetSIMDName()
+{
+#if defined(ARTO_CULL_AVX)
+    return "AVX";
+#elif defined(ARTO_CULL_SSE)
+    return "SSE2";
+#elif defined(ARTO_CULL_NEON)
+    return "NEON";
+#else
+    return "Scalar";
+#endif
+}
+
+// AABB对每个平面只需要测试离平面最远的那个角，平面对所有物体相同，所以每个平面先选好用Min还是Max
+struct PlaneCorner
+{
+    const float* mX;
+    const float* mY;
+    const float* mZ;
+};
+
+uint32_t SceneCuller::cullRange(const CullView& view, uint32_t begin, uint32_t end, uint32_t* outVisible) const
+{
+    const float minPixels2 = view.mMinPixels * view.mMinPixels;
+    const float projScale2x4 = 4.0f * view.mProjScale * view.mProjScale;
+
+    uint32_t visibleCount = 0;
+    for (uint32_t i = begin; i < end; i++)
+    {
+        bool bVisible = true;
+        for (const auto & plane : view.mPlanes)
+        {
+            float sphereDist = (plane.x * mCenterX[i] + plane.y * mCenterY[i]) + (plane.z * mCenterZ[i] + plane.w);
+            float boxDist = (plane.x * (plane.x > 0.0f ? mMaxX[i] : mMinX[i]) + plane.y * (plane.y > 0.0f ? mMaxY[i] : mMinY[i])) +
+                (plane.z * (plane.z > 0.0f ? mMaxZ[i] : mMinZ[i]) + plane.w);
+            bVisible = bVisible && sphereDist >= -mRadius[i] && boxDist >= 0.0f;
+        }
+
+        // 直径的像素数 2r * scale / d < minPixels，两边平方避免开方
+        float dx = mCenterX[i] - view.mCameraPos.x;
+        float dy = mCenterY[i] - view.mCameraPos.y;
+        float dz = mCenterZ[i] - view.mCameraPos.z;
+        float dist2 = dx * dx + dy * dy + dz * dz;
+        float size2 = (mRadius[i] * mRadius[i]) * projScale2x4;
+        bVisible = bVisible && size2 >= minPixels2 * dist2;
+
+        outVisible[visibleCount] = i;
+        visibleCount += bVisible ? 1 : 0;
+    }
+    return visibleCount;
+}
+
+uint32_t SceneCuller::CullScalar(const CullView& view, uint32_t* outVisible) const
+{
+    ZoneScoped;
+    return cullRange(view, 0, GetCount(), outVisible);
+}
+
+uint32_t SceneCuller::Cull(const CullView& view, uint32_t* outVisible) const
+{
+    ZoneScoped;
+    const uint32_t count = GetCount();
+
+    PlaneCorner corners[6];
+    for (int p = 0; p < 6; p++)
+    {
+        const glm::vec4& plane = view.mPlanes[p];
+        corners[p].mX = plane.x > 0.0f ? mMaxX.data() : mMinX.data();
+        corners[p].mY = plane.y > 0.0f ? mMaxY.data() : mMinY.data();
+        corners[p].mZ = plane.z > 0.0f ? mMaxZ.data() : mMinZ.data();
+    }
+
+    const float minPixels2 = view.mMinPixels * view.mMinPixels;
+    const float projScale2x4 = 4.0f * view.mProjScale * view.mProjScale;
+
+    uint32_t i = 0;
+    uint32_t visibleCount = 0;
+
+#if defined(ARTO_CULL_AVX)
+    constexpr uint32_t WIDTH = 8;
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 camX = _mm256_set1_ps(view.mCameraPos.x);
+    const __m256 camY = _mm256_set1_ps(view.mCameraPos.y);
+    const __m256 camZ = _mm256_set1_ps(view.mCameraPos.z);
+    const __m256 minPixels = _mm256_set1_ps(minPixels2);
+    const __m256 projScale = _mm256_set1_ps(projScale2x4);
+    for (; i + WIDTH <= count; i += WIDTH)
+    {
+        __m256 cx = _mm256_loadu_ps(mCenterX.data() + i);
+        __m256 cy = _mm256_loadu_ps(mCenterY.data() + i);
+        __m256 cz = _mm256_loadu_ps(mCenterZ.data() + i);
+        __m256 r = _mm256_loadu_ps(mRadius.data() + i);
+        __m256 negR = _mm256_sub_ps(zero, r);
+
+        __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++)
+        {
+            __m256 nx = _mm256_set1_ps(view.mPlanes[p].x);
+            __m256 ny = _mm256_set1_ps(view.mPlanes[p].y);
+            __m256 nz = _mm256_set1_ps(view.mPlanes[p].z);
+            __m256 nw = _mm256_set1_ps(view.mPlanes[p].w);
+
+            __m256 sphereDist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, cx), _mm256_mul_ps(ny, cy)), _mm256_add_ps(_mm256_mul_ps(nz, cz), nw));
+            __m256 boxDist = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(nx, _mm256_loadu_ps(corners[p].mX + i)), _mm256_mul_ps(ny, _mm256_loadu_ps(corners[p].mY + i))),
+                _mm256_add_ps(_mm256_mul_ps(nz, _mm256_loadu_ps(corners[p].mZ + i)), nw));
+            visible = _mm256_and_ps(visible, _mm256_cmp_ps(sphereDist, negR, _CMP_GE_OQ));
+            visible = _mm256_and_ps(visible, _mm256_cmp_ps(boxDist, zero, _CMP_GE_OQ));
+        }
+
+        __m256 dx = _mm256_sub_ps(cx, camX);
+        __m256 dy = _mm256_sub_ps(cy, camY);
+        __m256 dz = _mm256_sub_ps(cz, camZ);
+        __m256 dist2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+        __m256 size2 = _mm256_mul_ps(_mm256_mul_ps(r, r), projScale);
+        visible = _mm256_and_ps(visible, _mm256_cmp_ps(size2, _mm256_mul_ps(minPixels, dist2), _CMP_GE_OQ));
+
+        uint32_t mask = (uint32_t)_mm256_movemask_ps(visible);
+        for (uint32_t lane = 0; lane < WIDTH; lane++)
+        {
+            outVisible[visibleCount] = i + lane;
+            visibleCount += (mask >> lane) & 1;
+        }
+    }
+#elif defined(ARTO_CULL_SSE)
+    constexpr uint32_t WIDTH = 4;
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 camX = _mm_set1_ps(view.mCameraPos.x);
+    const __m128 camY = _mm_set1_ps(view.mCameraPos.y);
+    const __m128 camZ = _mm_set1_ps(view.mCameraPos.z);
+    const __m128 minPixels = _mm_set1_ps(minPixels2);
+    const __m128 projScale = _mm_set1_ps(projScale2x4);
+    for (; i + WIDTH <= count; i += WIDTH)
+    {
+        __m128 cx = _mm_loadu_ps(mCenterX.data() + i);
+        __m128 cy = _mm_loadu_ps(mCenterY.data() + i);
+        __m128 cz = _mm_loadu_ps(mCenterZ.data() + i);
+        __m128 r = _mm_loadu_ps(mRadius.data() + i);
+        __m128 negR = _mm_sub_ps(zero, r);
+
+        __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++)
+        {
+            __m128 nx = _mm_set1_ps(view.mPlanes[p].x);
+            __m128 ny = _mm_set1_ps(view.mPlanes[p].y);
+            __m128 nz = _mm_set1_ps(view.mPlanes[p].z);
+            __m128 nw = _mm_set1_ps(view.mPlanes[p].w);
+
+            __m128 sphereDist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_add_ps(_mm_mul_ps(nz, cz), nw));
+            __m128 boxDist = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(nx, _mm_loadu_ps(corners[p].mX + i)), _mm_mul_ps(ny, _mm_loadu_ps(corners[p].mY + i))),
+                _mm_add_ps(_mm_mul_ps(nz, _mm_loadu_ps(corners[p].mZ + i)), nw));
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(sphereDist, negR));
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(boxDist, zero));
+        }
+
+        __m128 dx = _mm_sub_ps(cx, camX);
+        __m128 dy = _mm_sub_ps(cy, camY);
+        __m128 dz = _mm_sub_ps(cz, camZ);
+        __m128 dist2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        __m128 size2 = _mm_mul_ps(_mm_mul_ps(r, r), projScale);
+        visible = _mm_and_ps(visible, _mm_cmpge_ps(size2, _mm_mul_ps(minPixels, dist2)));
+
+        uint32_t mask = (uint32_t)_mm_movemask_ps(visible);
+        for (uint32_t lane = 0; lane < WIDTH; lane++)
+        {
+            outVisible[visibleCount] = i + lane;
+            visibleCount += (mask >> lane) & 1;
+        }
+    }
+#elif defined(ARTO_CULL_NEON)
+    constexpr uint32_t WIDTH = 4;
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t camX = vdupq_n_f32(view.mCameraPos.x);
+    const float32x4_t camY = vdupq_n_f32(view.mCameraPos.y);
+    const float32x4_t camZ = vdupq_n_f32(view.mCameraPos.z);
+    const float32x4_t minPixels = vdupq_n_f32(minPixels2);
+    const float32x4_t projScale = vdupq_n_f32(projScale2x4);
+    // NEON没有movemask，每个Lane和自己的位相与后水平相加
+    const uint32_t laneBitsArray[4] = { 1, 2, 4, 8 };
+    const uint32x4_t laneBits = vld1q_u32(laneBitsArray);
+    for (; i + WIDTH <= count; i += WIDTH)
+    {
+        float32x4_t cx = vld1q_f32(mCenterX.data() + i);
+        float32x4_t cy = vld1q_f32(mCenterY.data() + i);
+        float32x4_t cz = vld1q_f32(mCenterZ.data() + i);
+        float32x4_t r = vld1q_f32(mRadius.data() + i);
+        float32x4_t negR = vnegq_f32(r);
+
+        uint32x4_t visible = vdupq_n_u32(0xFFFFFFFF);
+        for (int p = 0; p < 6; p++)
+        {
+            const glm::vec4& plane = view.mPlanes[p];
+            float32x4_t sphereDist = vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(plane.w), cx, plane.x), cy, plane.y), cz, plane.z);
+            float32x4_t boxDist = vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(plane.w),
+                vld1q_f32(corners[p].mX + i), plane.x),
+                vld1q_f32(corners[p].mY + i), plane.y),
+                vld1q_f32(corners[p].mZ + i), plane.z);
+            visible = vandq_u32(visible, vcgeq_f32(sphereDist, negR));
+            visible = vandq_u32(visible, vcgeq_f32(boxDist, zero));
+        }
+
+        float32x4_t dx = vsubq_f32(cx, camX);
+        float32x4_t dy = vsubq_f32(cy, camY);
+        float32x4_t dz = vsubq_f32(cz, camZ);
+        float32x4_t dist2 = vmlaq_f32(vmlaq_f32(vmulq_f32(dx, dx), dy, dy), dz, dz);
+        float32x4_t size2 = vmulq_f32(vmulq_f32(r, r), projScale);
+        visible = vandq_u32(visible, vcgeq_f32(size2, vmulq_f32(minPixels, dist2)));
+
+        uint32_t mask = vaddvq_u32(vandq_u32(visible, laneBits));
+        for (uint32_t lane = 0; lane < WIDTH; lane++)
+        {
+            outVisible[visibleCount] = i + lane;
+            visibleCount += (mask >> lane) & 1;
+        }
+    }
+#endif
+
+    visibleCount += cullRange(view, i, count, outVisible + visibleCount);
+    return visibleCount;
+}
\ No newline at end of file
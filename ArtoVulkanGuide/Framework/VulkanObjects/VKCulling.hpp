@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// 一次剔除用到的相机参数
+struct CullView
+{
+    // 从VP矩阵提取、法线朝内且归一化的6个平面
+    glm::vec4 mPlanes[6];
+    glm::vec3 mCameraPos;
+    // 投影后的像素尺寸 = 半径 * mProjScale / 距离
+    float mProjScale = 0.0f;
+    // 包围球投影直径小于这么多像素的物体被剔除，为0时不做贡献剔除
+    float mMinPixels = 0.0f;
+
+    static CullView FromMatrices(const glm::mat4& viewProj, const glm::mat4& proj, const glm::vec3& cameraPos, float viewportHeight, float minPixels);
+};
+
+// 世界空间的包围球和AABB按分量分开存放(SoA)，一条SIMD指令同时测试多个物体
+// 只有物体移动时才需要更新包围体，剔除时只读
+class SceneCuller
+{
+public:
+    void Clear();
+    void Reserve(size_t count);
+    // 用网格局部空间的包围体和物体矩阵计算世界空间的包围体，返回物体的下标
+    uint32_t Add(const glm::vec3& localCenter, float localRadius, const glm::vec3& localExtents, const glm::mat4& transform);
+    void Update(uint32_t index, const glm::vec3& localCenter, float localRadius, const glm::vec3& localExtents, const glm::mat4& transform);
+
+    // 可见物体的下标按升序写入outVisible，数组至少要有GetCount()个元素，返回可见的数量
+    uint32_t Cull(const CullView& view, uint32_t* outVisible) const;
+    // 标量版本，用于对比结果和性能
+    uint32_t CullScalar(const CullView& view, uint32_t* outVisible) const;
+
+    uint32_t GetCount() const { return static_cast<uint32_t>(mRadius.size()); }
+    // 编译时选择的SIMD路径
+    static const char* GetSIMDName();
+
+private:
+    // 从begin开始的物体用标量测试，处理SIMD宽度以外剩下的部分
+    uint32_t cullRange(const CullView& view, uint32_t begin, uint32_t end, uint32_t* outVisible) const;
+
+private:
+    std::vector<float> mCenterX, mCenterY, mCenterZ, mRadius;
+    std::vector<float> mMinX, mMinY, mMinZ;
+    std::vector<float> mMaxX, mMaxY, mMaxZ;
+};
\ No newline at end of file
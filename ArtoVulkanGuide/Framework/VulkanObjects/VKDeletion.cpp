@@ -0,0 +1,94 @@
+#include "VKDeletion.hpp"
+
+void TypedDeletionQueue::Init(VkDevice device, VmaAllocator allocator)
+{
+    mDevice = device;
+    mAllocator = allocator;
+}
+
+void TypedDeletionQueue::push(DeletionType type, uint64_t handle, uint64_t retireValue, VmaAllocation allocation)
+{
+    if (handle == 0) return;
+
+    mTypes.push_back(type);
+    mHandles.push_back(handle);
+    mAllocations.push_back(allocation);
+    mRetireValues.push_back(retireValue);
+}
+
+void TypedDeletionQueue::Retire(uint64_t completedValue)
+{
+    const uint32_t count = static_cast<uint32_t>(mTypes.size());
+    while (mHead < count && mRetireValues[mHead] <= completedValue)
+    {
+        destroy(mHead++);
+    }
+
+    // 全部销毁时从头开始，否则销毁的部分超过一半再把剩下的挪到前面
+    if (mHead == count)
+    {
+        mTypes.clear();
+        mHandles.clear();
+        mAllocations.clear();
+        mRetireValues.clear();
+        mHead = 0;
+    }
+    else if (mHead > count / 2)
+    {
+        mTypes.erase(mTypes.begin(), mTypes.begin() + mHead);
+        mHandles.erase(mHandles.begin(), mHandles.begin() + mHead);
+        mAllocations.erase(mAllocations.begin(), mAllocations.begin() + mHead);
+        mRetireValues.erase(mRetireValues.begin(), mRetireValues.begin() + mHead);
+        mHead = 0;
+    }
+}
+
+void TypedDeletionQueue::Flush()
+{
+    Retire(UINT64_MAX);
+}
+
+void TypedDeletionQueue::destroy(uint32_t index)
+{
+    const uint64_t handle = mHandles[index];
+    switch (mTypes[index])
+    {
+    case DeletionType::Buffer:
+        vmaDestroyBuffer(mAllocator, (VkBuffer)handle, mAllocations[index]);
+        break;
+    case DeletionType::Image:
+        vmaDestroyImage(mAllocator, (VkImage)handle, mAllocations[index]);
+        break;
+    case DeletionType::ImageView:
+        vkDestroyImageView(mDevice, (VkImageView)handle, nullptr);
+        break;
+    case DeletionType::Sampler:
+        vkDestroySampler(mDevice, (VkSampler)handle, nullptr);
+        break;
+    case DeletionType::Pipeline:
+        vkDestroyPipeline(mDevice, (VkPipeline)handle, nullptr);
+        break;
+    case DeletionType::PipelineLayout:
+        vkDestroyPipelineLayout(mDevice, (VkPipelineLayout)handle, nullptr);
+        break;
+    case DeletionType::DescriptorSetLayout:
+        vkDestroyDescriptorSetLayout(mDevice, (VkDescriptorSetLayout)handle, nullptr);
+        break;
+    case DeletionType::DescriptorPool:
+        vkDestroyDescriptorPool(mDevice, (VkDescriptorPool)handle, nullptr);
+        break;
+    case DeletionType::ShaderModule:
+        vkDestroyShaderModule(mDevice, (VkShaderModule)handle, nullptr);
+        break;
+    case DeletionType::CommandPool:
+        vkDestroyCommandPool(mDevice, (VkCommandPool)handle, nullptr);
+        break;
+    case DeletionType::QueryPool:
+        vkDestroyQueryPool(mDevice, (VkQueryPool)handle, nullptr);
+        break;
+    case DeletionType::Semaphore:
+        vkDestroySemaphore(mDevice, (VkSemaphore)handle, nullptr);
+        break;
+    }
+    mDestroyedCount++;
+}
\ No newline at end of file
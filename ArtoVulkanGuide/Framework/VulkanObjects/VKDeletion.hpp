@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "VKTypes.hpp"
+
+// 延迟删除的对象类型，决定用哪个vkDestroy函数
+enum class DeletionType : uint8_t
+{
+    Buffer,
+    Image,
+    ImageView,
+    Sampler,
+    Pipeline,
+    PipelineLayout,
+    DescriptorSetLayout,
+    DescriptorPool,
+    ShaderModule,
+    CommandPool,
+    QueryPool,
+    Semaphore,
+};
+
+// 运行中删除GPU可能还在使用的对象：记下类型、句柄、VMA分配和Timeline值，Timeline到达后再销毁
+// 每一项只占几个平铺数组里的一个位置，Push不分配闭包，Retire只比较整数
+// 每帧按Graphics Timeline已完成的值调用Retire，不需要等设备空闲
+class TypedDeletionQueue
+{
+public:
+    void Init(VkDevice device, VmaAllocator allocator);
+
+    // retireValue之前的提交都完成后销毁，通常是下一次提交的值
+    // 非分发句柄在32位平台上是uint64_t，统一转换成整数保存
+    template<typename T>
+    void Push(DeletionType type, T handle, uint64_t retireValue, VmaAllocation allocation = VK_NULL_HANDLE)
+    {
+        push(type, (uint64_t)handle, retireValue, allocation);
+    }
+    void Push(const AllocatedBuffer& buffer, uint64_t retireValue) { Push(DeletionType::Buffer, buffer.mBuffer, retireValue, buffer.mAllocation); }
+    void Push(const AllocatedImage& image, uint64_t retireValue) { Push(DeletionType::Image, image.mImage, retireValue, image.mAllocation); }
+
+    // 销毁所有retireValue不超过completedValue的对象
+    void Retire(uint64_t completedValue);
+    // 退出时设备已经空闲，销毁剩下的所有对象
+    void Flush();
+
+    uint32_t GetPendingCount() const { return static_cast<uint32_t>(mTypes.size() - mHead); }
+
+    // 统计信息
+    uint64_t mDestroyedCount = 0;
+
+private:
+    void push(DeletionType type, uint64_t handle, uint64_t retireValue, VmaAllocation allocation);
+    void destroy(uint32_t index);
+
+private:
+    VkDevice mDevice = VK_NULL_HANDLE;
+    VmaAllocator mAllocator = VK_NULL_HANDLE;
+
+    // 按Push的顺序排列，retireValue通常是递增的，从mHead开始检查
+    // 后面出现较小的值时要等前面的项一起销毁，只会晚不会早
+    std::vector<DeletionType> mTypes;
+    std::vector<uint64_t> mHandles;
+    std::vector<VmaAllocation> mAllocations;
+    std::vector<uint64_t> mRetireValues;
+    uint32_t mHead = 0;
+};
\ No newline at end of file
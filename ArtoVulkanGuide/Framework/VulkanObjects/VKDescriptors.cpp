@@ -0,0 +1,298 @@
+#include <algorithm>
+
+#include "VKDescriptors.hpp"
+
+// 每个描述符集平均需要的各类描述符个数，Pool按这个比例乘以描述符集个数分配
+static const struct
+{
+    VkDescriptorType mType;
+    float mRatio;
+} POOL_SIZE_RATIOS[] = {
+    { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f },
+    { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+    { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4.0f },
+    { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 0.5f },
+    { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0.5f },
+    { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f },
+};
+
+// FNV-1a
+static uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+void DescriptorAllocator::Init(VkDevice device, uint32_t setsPerPool)
+{
+    mDevice = device;
+    mSetsPerPool = std::max(setsPerPool, 1u);
+}
+
+void DescriptorAllocator::Destroy()
+{
+    ResetPools();
+    for (VkDescriptorPool pool : mReadyPools)
+    {
+        vkDestroyDescriptorPool(mDevice, pool, nullptr);
+    }
+    mReadyPools.clear();
+}
+
+VkDescriptorPool DescriptorAllocator::createPool()
+{
+    // 单个描述符集可能超过平均比例，每类至少留一个描述符集里可能用到的数量
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for (const auto& ratio : POOL_SIZE_RATIOS)
+    {
+        uint32_t count = std::max(static_cast<uint32_t>(ratio.mRatio * mSetsPerPool), 16u);
+        poolSizes.push_back({ ratio.mType, count });
+    }
+
+    VkDescriptorPoolCreateInfo poolCI {};
+    poolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolCI.pNext = nullptr;
+    poolCI.flags = 0;
+    poolCI.maxSets = mSetsPerPool;
+    poolCI.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolCI.pPoolSizes = poolSizes.data();
+
+    VkDescriptorPool pool;
+    VK_CHECK(vkCreateDescriptorPool(mDevice, &poolCI, nullptr, &pool));
+    mSetsPerPool = std::min(mSetsPerPool * 2, MAX_SETS_PER_POOL);
+    return pool;
+}
+
+VkDescriptorPool DescriptorAllocator::nextPool()
+{
+    if (!mReadyPools.empty())
+    {
+        VkDescriptorPool pool = mReadyPools.back();
+        mReadyPools.pop_back();
+        return pool;
+    }
+    return createPool();
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout)
+{
+    if (mCurrentPool == VK_NULL_HANDLE)
+    {
+        mCurrentPool = nextPool();
+    }
+
+    VkDescriptorSetAllocateInfo descSetAI {};
+    descSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descSetAI.pNext = nullptr;
+    descSetAI.descriptorPool = mCurrentPool;
+    descSetAI.descriptorSetCount = 1;
+    descSetAI.pSetLayouts = &layout;
+
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    VkResult result = vkAllocateDescriptorSets(mDevice, &descSetAI, &set);
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+    {
+        // 当前的Pool用完了，换一个新的再试一次
+        mFullPools.push_back(mCurrentPool);
+        mCurrentPool = nextPool();
+        descSetAI.descriptorPool = mCurrentPool;
+        result = vkAllocateDescriptorSets(mDevice, &descSetAI, &set);
+    }
+    VK_CHECK(result);
+
+    mAllocatedSets++;
+    return set;
+}
+
+void DescriptorAllocator::ResetPools()
+{
+    if (mCurrentPool != VK_NULL_HANDLE)
+    {
+        mFullPools.push_back(mCurrentPool);
+        mCurrentPool = VK_NULL_HANDLE;
+    }
+    for (VkDescriptorPool pool : mFullPools)
+    {
+        VK_CHECK(vkResetDescriptorPool(mDevice, pool, 0));
+        mReadyPools.push_back(pool);
+    }
+    mFullPools.clear();
+}
+
+void DescriptorLayoutCache::Init(VkDevice device)
+{
+    mDevice = device;
+}
+
+void DescriptorLayoutCache::Destroy()
+{
+    for (auto& it : mLayouts)
+    {
+        vkDestroyDescriptorUpdateTemplate(mDevice, it.second.mUpdateTemplate, nullptr);
+        vkDestroyDescriptorSetLayout(mDevice, it.first, nullptr);
+    }
+    mLayouts.clear();
+    mLayoutsByHash.clear();
+}
+
+bool DescriptorLayoutCache::isSameLayout(const LayoutInfo& a, const LayoutInfo& b)
+{
+    if (a.mFlags != b.mFlags || a.mBindings.size() != b.mBindings.size() || a.mBindingFlags != b.mBindingFlags) return false;
+    for (size_t i = 0; i < a.mBindings.size(); i++)
+    {
+        const VkDescriptorSetLayoutBinding& x = a.mBindings[i];
+        const VkDescriptorSetLayoutBinding& y = b.mBindings[i];
+        if (x.binding != y.binding || x.descriptorType != y.descriptorType || x.descriptorCount != y.descriptorCount ||
+            x.stageFlags != y.stageFlags || x.pImmutableSamplers != y.pImmutableSamplers)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::CreateLayout(const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount, VkDescriptorSetLayoutCreateFlags flags,
+    const VkDescriptorBindingFlags* bindingFlags)
+{
+    mRequests++;
+
+    // 绑定标记要跟着绑定一起排序
+    std::vector<uint32_t> order(bindingCount);
+    for (uint32_t i = 0; i < bindingCount; i++)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+    {
+        return bindings[a].binding < bindings[b].binding;
+    });
+
+    LayoutInfo info;
+    info.mFlags = flags;
+    for (uint32_t i : order)
+    {
+        info.mBindings.push_back(bindings[i]);
+        if (bindingFlags != nullptr)
+        {
+            info.mBindingFlags.push_back(bindingFlags[i]);
+        }
+    }
+
+    // 逐个字段计算，结构体里的填充不参与
+    uint64_t hash = HashBytes(&flags, sizeof(flags));
+    for (const VkDescriptorSetLayoutBinding& binding : info.mBindings)
+    {
+        hash = HashBytes(&binding.binding, sizeof(binding.binding), hash);
+        hash = HashBytes(&binding.descriptorType, sizeof(binding.descriptorType), hash);
+        hash = HashBytes(&binding.descriptorCount, sizeof(binding.descriptorCount), hash);
+        hash = HashBytes(&binding.stageFlags, sizeof(binding.stageFlags), hash);
+        info.mDescriptorCount += binding.descriptorCount;
+    }
+    if (!info.mBindingFlags.empty())
+    {
+        hash = HashBytes(info.mBindingFlags.data(), info.mBindingFlags.size() * sizeof(VkDescriptorBindingFlags), hash);
+    }
+
+    auto range = mLayoutsByHash.equal_range(hash);
+    for (auto it = range.first; it != range.second; it++)
+    {
+        if (isSameLayout(mLayouts.at(it->second), info))
+        {
+            return it->second;
+        }
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCI {};
+    bindingFlagsCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsCI.pNext = nullptr;
+    bindingFlagsCI.bindingCount = static_cast<uint32_t>(info.mBindingFlags.size());
+    bindingFlagsCI.pBindingFlags = info.mBindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo layoutCI {};
+    layoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutCI.pNext = info.mBindingFlags.empty() ? nullptr : &bindingFlagsCI;
+    layoutCI.flags = flags;
+    layoutCI.bindingCount = static_cast<uint32_t>(info.mBindings.size());
+    layoutCI.pBindings = info.mBindings.data();
+    VkDescriptorSetLayout layout;
+    VK_CHECK(vkCreateDescriptorSetLayout(mDevice, &layoutCI, nullptr, &layout));
+
+    // 每个绑定一项，数据从DescriptorInfo数组里连续读取
+    std::vector<VkDescriptorUpdateTemplateEntry> entries;
+    size_t offset = 0;
+    for (const VkDescriptorSetLayoutBinding& binding : info.mBindings)
+    {
+        if (binding.descriptorCount == 0) continue;
+
+        VkDescriptorUpdateTemplateEntry entry {};
+        entry.dstBinding = binding.binding;
+        entry.dstArrayElement = 0;
+        entry.descriptorCount = binding.descriptorCount;
+        entry.descriptorType = binding.descriptorType;
+        entry.offset = offset;
+        entry.stride = sizeof(DescriptorInfo);
+        entries.push_back(entry);
+        offset += binding.descriptorCount * sizeof(DescriptorInfo);
+    }
+
+    VkDescriptorUpdateTemplateCreateInfo templateCI {};
+    templateCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    templateCI.pNext = nullptr;
+    templateCI.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+    templateCI.pDescriptorUpdateEntries = entries.data();
+    templateCI.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    templateCI.descriptorSetLayout = layout;
+    VK_CHECK(vkCreateDescriptorUpdateTemplate(mDevice, &templateCI, nullptr, &info.mUpdateTemplate));
+
+    mLayoutsByHash.emplace(hash, layout);
+    mLayouts.emplace(layout, std::move(info));
+    return layout;
+}
+
+void DescriptorLayoutCache::UpdateSet(VkDescriptorSet set, VkDescriptorSetLayout layout, const DescriptorInfo* infos)
+{
+    vkUpdateDescriptorSetWithTemplate(mDevice, set, mLayouts.at(layout).mUpdateTemplate, infos);
+}
+
+void DescriptorSetCache::Init(DescriptorAllocator* allocator, DescriptorLayoutCache* layoutCache)
+{
+    mAllocator = allocator;
+    mLayoutCache = layoutCache;
+}
+
+void DescriptorSetCache::Destroy()
+{
+    // 描述符集随Pool一起释放
+    mSetsByHash.clear();
+    mSets.clear();
+}
+
+VkDescriptorSet DescriptorSetCache::Get(VkDescriptorSetLayout layout, const DescriptorInfo* infos)
+{
+    mRequests++;
+
+    const uint32_t count = mLayoutCache->GetDescriptorCount(layout);
+    uint64_t hash = HashBytes(&layout, sizeof(layout));
+    hash = HashBytes(infos, count * sizeof(DescriptorInfo), hash);
+
+    auto range = mSetsByHash.equal_range(hash);
+    for (auto it = range.first; it != range.second; it++)
+    {
+        const CachedSet& cached = mSets[it->second];
+        if (cached.mLayout == layout && memcmp(cached.mInfos.data(), infos, count * sizeof(DescriptorInfo)) == 0)
+        {
+            return cached.mSet;
+        }
+    }
+
+    VkDescriptorSet set = mAllocator->Allocate(layout);
+    mLayoutCache->UpdateSet(set, layout, infos);
+
+    mSetsByHash.emplace(hash, static_cast<uint32_t>(mSets.size()));
+    mSets.push_back({ layout, std::vector<DescriptorInfo>(infos, infos + count), set });
+    return set;
+}
\ No newline at end of file
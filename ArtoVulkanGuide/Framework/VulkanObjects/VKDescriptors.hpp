@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <unordered_map>
+
+#include "VKTypes.hpp"
+
+// 更新模板读取的一个描述符，图片和Buffer大小相同，可以放在一个数组里
+// 作为缓存的Key时按字节比较，所以先清零再逐个字段赋值，填充部分保持为0
+struct DescriptorInfo
+{
+    union
+    {
+        VkDescriptorImageInfo mImage;
+        VkDescriptorBufferInfo mBuffer;
+    };
+
+    DescriptorInfo() { memset(this, 0, sizeof(*this)); }
+    DescriptorInfo(VkSampler sampler, VkImageView imageView, VkImageLayout imageLayout) : DescriptorInfo()
+    {
+        mImage.sampler = sampler;
+        mImage.imageView = imageView;
+        mImage.imageLayout = imageLayout;
+    }
+    DescriptorInfo(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) : DescriptorInfo()
+    {
+        mBuffer.buffer = buffer;
+        mBuffer.offset = offset;
+        mBuffer.range = range;
+    }
+};
+
+// 描述符集从一串Pool里分配，当前的Pool用完时换下一个，没有空的Pool就新建一个更大的
+// ResetPools把所有Pool整个重置，适合每帧重新分配的描述符集
+class DescriptorAllocator
+{
+public:
+    // setsPerPool是第一个Pool的大小，之后每次新建翻倍，不超过MAX_SETS_PER_POOL
+    void Init(VkDevice device, uint32_t setsPerPool);
+    void Destroy();
+
+    VkDescriptorSet Allocate(VkDescriptorSetLayout layout);
+    // 调用前GPU必须已经用完从这里分配的所有描述符集
+    void ResetPools();
+
+    uint32_t GetPoolCount() const { return static_cast<uint32_t>(mFullPools.size() + mReadyPools.size()) + (mCurrentPool != VK_NULL_HANDLE ? 1 : 0); }
+
+    static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+    // 统计信息
+    uint64_t mAllocatedSets = 0;
+
+private:
+    VkDescriptorPool createPool();
+    VkDescriptorPool nextPool();
+
+private:
+    VkDevice mDevice = VK_NULL_HANDLE;
+    uint32_t mSetsPerPool = 0;
+    VkDescriptorPool mCurrentPool = VK_NULL_HANDLE;
+    // 分配失败过的Pool，重置后回到mReadyPools
+    std::vector<VkDescriptorPool> mFullPools;
+    std::vector<VkDescriptorPool> mReadyPools;
+};
+
+// 相同绑定的VkDescriptorSetLayout只创建一次，所有布局在Destroy时统一销毁
+// 每个布局按绑定顺序生成一个更新模板，DescriptorInfo数组按绑定号从小到大、每个绑定descriptorCount项排列
+class DescriptorLayoutCache
+{
+public:
+    void Init(VkDevice device);
+    void Destroy();
+
+    // bindingFlags不为空时和bindings一一对应，描述符索引用的PARTIALLY_BOUND、UPDATE_AFTER_BIND等标记
+    VkDescriptorSetLayout CreateLayout(const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount, VkDescriptorSetLayoutCreateFlags flags = 0,
+        const VkDescriptorBindingFlags* bindingFlags = nullptr);
+    // 用更新模板一次写入整个描述符集，infos的个数是布局里所有绑定的descriptorCount之和
+    void UpdateSet(VkDescriptorSet set, VkDescriptorSetLayout layout, const DescriptorInfo* infos);
+    uint32_t GetDescriptorCount(VkDescriptorSetLayout layout) const { return mLayouts.at(layout).mDescriptorCount; }
+    uint32_t GetLayoutCount() const { return static_cast<uint32_t>(mLayouts.size()); }
+
+    // 统计信息
+    uint64_t mRequests = 0;
+
+private:
+    struct LayoutInfo
+    {
+        VkDescriptorSetLayoutCreateFlags mFlags = 0;
+        // 按绑定号排序
+        std::vector<VkDescriptorSetLayoutBinding> mBindings;
+        // 和mBindings顺序相同，没有指定时为空
+        std::vector<VkDescriptorBindingFlags> mBindingFlags;
+        uint32_t mDescriptorCount = 0;
+        VkDescriptorUpdateTemplate mUpdateTemplate = VK_NULL_HANDLE;
+    };
+
+    static bool isSameLayout(const LayoutInfo& a, const LayoutInfo& b);
+
+private:
+    VkDevice mDevice = VK_NULL_HANDLE;
+    std::unordered_multimap<uint64_t, VkDescriptorSetLayout> mLayoutsByHash;
+    std::unordered_map<VkDescriptorSetLayout, LayoutInfo> mLayouts;
+};
+
+// 内容不再变化的描述符集按(布局, 内容)缓存，相同的内容只分配和写入一次
+// 描述符集的生命周期和分配它的DescriptorAllocator相同
+class DescriptorSetCache
+{
+public:
+    void Init(DescriptorAllocator* allocator, DescriptorLayoutCache* layoutCache);
+    void Destroy();
+
+    VkDescriptorSet Get(VkDescriptorSetLayout layout, const DescriptorInfo* infos);
+
+    uint32_t GetSetCount() const { return static_cast<uint32_t>(mSets.size()); }
+
+    // 统计信息
+    uint64_t mRequests = 0;
+
+private:
+    struct CachedSet
+    {
+        VkDescriptorSetLayout mLayout;
+        std::vector<DescriptorInfo> mInfos;
+        VkDescriptorSet mSet;
+    };
+
+private:
+    DescriptorAllocator* mAllocator = nullptr;
+    DescriptorLayoutCache* mLayoutCache = nullptr;
+    std::unordered_multimap<uint64_t, uint32_t> mSetsByHash;
+    std::vector<CachedSet> mSets;
+};
\ No newline at end of file
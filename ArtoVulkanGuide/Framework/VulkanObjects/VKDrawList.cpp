@@ -0,0 +1,66 @@
+#include <algorithm>
+
+#include "VKDrawList.hpp"
+
+#include <Tracy.hpp>
+
+uint64_t DrawList::MakeKey(uint32_t pass, uint32_t pipeline, uint32_t mesh, uint32_t material, float depth)
+{
+    uint64_t quantizedDepth = (uint64_t)(std::clamp(depth, 0.0f, 1.0f) * 4095.0f);
+
+    return ((uint64_t)(pass & 0xF) << 60) |
+        ((uint64_t)(pipeline & (DRAW_KEY_MAX_PIPELINES - 1)) << 52) |
+        ((uint64_t)(mesh & (DRAW_KEY_MAX_MESHES - 1)) << 28) |
+        ((uint64_t)(material & (DRAW_KEY_MAX_MATERIALS - 1)) << 12) |
+        quantizedDepth;
+}
+
+void DrawList::Sort()
+{
+    ZoneScoped;
+    const size_t count = mItems.size();
+    if (count < 2) return;
+
+    // 一次遍历统计所有8个字节的直方图
+    uint32_t histograms[8][256] = {};
+    for (const auto & item : mItems)
+    {
+        for (uint32_t b = 0; b < 8; b++)
+        {
+            histograms[b][(item.mKey >> (b * 8)) & 0xFF]++;
+        }
+    }
+
+    mScratch.resize(count);
+    DrawItem* src = mItems.data();
+    DrawItem* dst = mScratch.data();
+
+    for (uint32_t b = 0; b < 8; b++)
+    {
+        uint32_t* histogram = histograms[b];
+        uint32_t shift = b * 8;
+
+        // 所有Key这个字节都一样，这一趟不改变顺序
+        if (histogram[(src[0].mKey >> shift) & 0xFF] == count) continue;
+
+        uint32_t offset = 0;
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t bucketCount = histogram[i];
+            histogram[i] = offset;
+            offset += bucketCount;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            dst[histogram[(src[i].mKey >> shift) & 0xFF]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+
+    // 奇数趟之后结果在Scratch里
+    if (src != mItems.data())
+    {
+        mItems.swap(mScratch);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// 64位排序Key，从高位到低位：
+// | Pass 4 | Pipeline 8 | 网格 24 | 材质 16 | 深度 12 |
+// 网格字段是网格ID * LOD数 + LOD，所以比其他字段宽，深度只用于近远排序，12位足够
+// 按Key排序后，同一个Pass里相同Pipeline的物体相邻，其次是网格，状态切换最少
+// 贴图都在Bindless数组里，换材质不需要绑定，相同网格不同材质的物体也能合并成一次Instanced Draw
+// 同一状态下的物体按深度从近到远，减少Overdraw
+constexpr uint32_t DRAW_PASS_OPAQUE = 0;
+// 各字段能表示的ID个数，超出时不同的网格会得到相同的Key，被合并成一次Instanced Draw
+// 创建网格和材质时检查，超出时报错退出
+constexpr uint32_t DRAW_KEY_MAX_PIPELINES = 1u << 8;
+constexpr uint32_t DRAW_KEY_MAX_MESHES = 1u << 24;
+constexpr uint32_t DRAW_KEY_MAX_MATERIALS = 1u << 16;
+
+struct DrawItem
+{
+    uint64_t mKey;
+    // 物体在场景数组里的下标
+    uint32_t mObject;
+    // 选中的LOD，网格的Key里也包含它，排序后相同LOD的物体相邻
+    uint32_t mLod;
+};
+
+// 录制时统计的状态切换次数
+struct DrawStats
+{
+    void Add(const DrawStats& other)
+    {
+        mPipelineBinds += other.mPipelineBinds;
+        mDescSetBinds += other.mDescSetBinds;
+        mVertexBufferBinds += other.mVertexBufferBinds;
+        mIndexBufferBinds += other.mIndexBufferBinds;
+        mDraws += other.mDraws;
+        mInstances += other.mInstances;
+        mTriangles += other.mTriangles;
+    }
+
+    uint64_t mPipelineBinds = 0;
+    uint64_t mDescSetBinds = 0;
+    uint64_t mVertexBufferBinds = 0;
+    uint64_t mIndexBufferBinds = 0;
+    uint64_t mDraws = 0;
+    uint64_t mInstances = 0;
+    uint64_t mTriangles = 0;
+};
+
+class DrawList
+{
+public:
+    // depth是归一化到[0, 1]的深度，超出范围会被截断
+    static uint64_t MakeKey(uint32_t pass, uint32_t pipeline, uint32_t mesh, uint32_t material, float depth);
+
+    void Clear() { mItems.clear(); }
+    void Reserve(size_t count) { mItems.reserve(count); }
+    void Add(uint64_t key, uint32_t object, uint32_t lod = 0) { mItems.push_back({ key, object, lod }); }
+
+    // LSD基数排序，每趟8位，所有Key在某个字节上都相同时跳过这一趟，是稳定排序
+    void Sort();
+
+    const DrawItem* GetItems() const { return mItems.data(); }
+    uint32_t GetCount() const { return static_cast<uint32_t>(mItems.size()); }
+
+private:
+    std::vector<DrawItem> mItems;
+    std::vector<DrawItem> mScratch;
+};
\ No newline at end of file
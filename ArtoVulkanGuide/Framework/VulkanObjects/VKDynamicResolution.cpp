@@ -0,0 +1,68 @@
+#include <cmath>
+#include <algorithm>
+
+#include "VKDynamicResolution.hpp"
+
+// 指数平均的权重
+constexpr double SMOOTHING = 0.1;
+// 改变比例后至少收集这么多帧再做下一次调整
+constexpr uint32_t MIN_SAMPLES = 8;
+// GPU时间在目标的[85%, 100%]之间时不调整，避免来回抖动，调整时瞄准中间
+constexpr double LOWER_BOUND = 0.85;
+constexpr double AIM = 0.92;
+// 每次调整最多改变10%
+constexpr float MAX_STEP = 0.1f;
+
+void DynamicResolution::Init(VkExtent2D maxExtent, double targetMs, float minScale, uint32_t framesInFlight)
+{
+    mMaxExtent = maxExtent;
+    mTargetMs = targetMs;
+    mMinScale = std::clamp(minScale, 0.1f, 1.0f);
+    mScale = 1.0f;
+    mAverageMs = 0.0;
+    mSampleCount = 0;
+    mSettleFrames = 0;
+    mFramesInFlight = framesInFlight;
+}
+
+bool DynamicResolution::AddSample(double gpuMs)
+{
+    if (mTargetMs <= 0.0) return false;
+
+    if (mSettleFrames > 0)
+    {
+        mSettleFrames--;
+        return false;
+    }
+
+    mAverageMs = mSampleCount == 0 ? gpuMs : mAverageMs * (1.0 - SMOOTHING) + gpuMs * SMOOTHING;
+    mSampleCount++;
+    if (mSampleCount < MIN_SAMPLES) return false;
+
+    if (mAverageMs <= mTargetMs && mAverageMs >= mTargetMs * LOWER_BOUND) return false;
+    // 已经是最大分辨率并且还有余量
+    if (mAverageMs < mTargetMs && mScale >= 1.0f) return false;
+
+    // GPU时间近似和像素数成正比，比例是边长的缩放，所以取平方根
+    float desired = mScale * (float)std::sqrt(mTargetMs * AIM / mAverageMs);
+    desired = std::clamp(desired, mScale * (1.0f - MAX_STEP), mScale * (1.0f + MAX_STEP));
+    desired = std::clamp(desired, mMinScale, 1.0f);
+    if (std::abs(desired - mScale) < 0.01f) return false;
+
+    mScale = desired;
+    mAverageMs = 0.0;
+    mSampleCount = 0;
+    mSettleFrames = mFramesInFlight;
+    return true;
+}
+
+VkExtent2D DynamicResolution::GetRenderExtent() const
+{
+    // 按8对齐，减少分块渲染的GPU上不完整的Tile
+    auto scaleSide = [&](uint32_t side)
+    {
+        uint32_t scaled = (uint32_t)((float)side * mScale) & ~7u;
+        return std::clamp(scaled, std::min(side, 8u), side);
+    };
+    return { scaleSide(mMaxExtent.width), scaleSide(mMaxExtent.height) };
+}
\ No newline at end of file
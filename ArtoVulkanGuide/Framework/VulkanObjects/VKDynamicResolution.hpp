@@ -0,0 +1,30 @@
+#pragma once
+
+#include "VKTypes.hpp"
+
+// 根据GPU时间调整渲染分辨率，负载高时降低分辨率，把GPU时间稳定在目标附近
+// 渲染用的Image按最大分辨率分配，每帧只改变渲染区域，不需要重新创建资源
+class DynamicResolution
+{
+public:
+    // targetMs为0时不调整，一直使用最大分辨率
+    void Init(VkExtent2D maxExtent, double targetMs, float minScale, uint32_t framesInFlight);
+    // 每读回一帧的GPU时间调用一次，返回比例是否改变
+    bool AddSample(double gpuMs);
+    VkExtent2D GetRenderExtent() const;
+
+public:
+    VkExtent2D mMaxExtent {};
+    double mTargetMs = 0.0;
+    float mMinScale = 0.5f;
+    // 边长的缩放比例
+    float mScale = 1.0f;
+
+private:
+    // GPU时间的指数平均，每次改变比例后重新开始
+    double mAverageMs = 0.0;
+    uint32_t mSampleCount = 0;
+    // 改变比例时还在飞的帧用的是旧分辨率，跳过它们的结果
+    uint32_t mSettleFrames = 0;
+    uint32_t mFramesInFlight = 1;
+};
\ No newline at end of file
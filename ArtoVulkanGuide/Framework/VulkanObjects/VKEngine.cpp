@@ -1,6 +1,12 @@
 ﻿#include <iostream>
 #include <array>
 #include <fstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <random>
+#include <glm/gtc/type_ptr.hpp>
 
 #include <SDL.h>
 #include <SDL_vulkan.h>
@@ -15,34 +21,230 @@
 #include "VKImage.hpp"
 #include "VKTexture.hpp"
 
+#include <Tracy.hpp>
+
 constexpr bool bUseValidationLayers = true;
+constexpr uint32_t STATS_REPORT_INTERVAL = 240;
+// 每个线程至少分到这么多Draw Call才值得拆分
+constexpr uint32_t MIN_DRAWS_PER_WORKER = 128;
+constexpr float CAMERA_NEAR_PLANE = 0.1f;
+constexpr float CAMERA_FAR_PLANE = 200.0f;
+// 剔除Compute Shader的local_size_x
+constexpr uint32_t CULL_GROUP_SIZE = 64;
+
+#ifdef TRACY_ENABLE
+// VMA每次向驱动申请或释放VkDeviceMemory时通知Tracy，按显存块统计
+static void VKAPI_PTR TracyVmaAllocate(VmaAllocator allocator, uint32_t memoryType, VkDeviceMemory memory, VkDeviceSize size, void* pUserData)
+{
+    TracyAllocN((void*)(uintptr_t)memory, size, "VMA");
+}
+
+static void VKAPI_PTR TracyVmaFree(VmaAllocator allocator, uint32_t memoryType, VkDeviceMemory memory, VkDeviceSize size, void* pUserData)
+{
+    TracyFreeN((void*)(uintptr_t)memory, "VMA");
+}
+#endif
+
+static const char* PresentModeName(VkPresentModeKHR mode)
+{
+    switch (mode)
+    {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR: return "IMMEDIATE";
+        case VK_PRESENT_MODE_MAILBOX_KHR:   return "MAILBOX";
+        case VK_PRESENT_MODE_FIFO_KHR:      return "FIFO";
+        default:                            return "OTHER";
+    }
+}
+
+static double ElapsedMs(std::chrono::high_resolution_clock::time_point start, std::chrono::high_resolution_clock::time_point end)
+{
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1000000.0;
+}
+
+// Bindless贴图数组需要的描述符索引特性在Vulkan 1.3里仍然是可选的，返回设备缺少的第一个，都支持时返回nullptr
+static const char* MissingDescriptorIndexingFeature(VkPhysicalDevice gpu)
+{
+    VkPhysicalDeviceVulkan12Features features12 {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 features2 {};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &features12;
+    vkGetPhysicalDeviceFeatures2(gpu, &features2);
+
+    if (!features12.descriptorIndexing)                            return "descriptorIndexing";
+    if (!features12.shaderSampledImageArrayNonUniformIndexing)     return "shaderSampledImageArrayNonUniformIndexing";
+    if (!features12.runtimeDescriptorArray)                        return "runtimeDescriptorArray";
+    if (!features12.descriptorBindingPartiallyBound)               return "descriptorBindingPartiallyBound";
+    if (!features12.descriptorBindingSampledImageUpdateAfterBind)  return "descriptorBindingSampledImageUpdateAfterBind";
+    if (!features12.descriptorBindingUpdateUnusedWhilePending)     return "descriptorBindingUpdateUnusedWhilePending";
+    return nullptr;
+}
+
+EngineConfig EngineConfig::FromCommandLine(int argc, char* argv[])
+{
+    EngineConfig config{};
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool bHasValue = i + 1 < argc;
+
+        if (arg == "--frames" && bHasValue)
+        {
+            config.mFrameOverlap = (uint32_t)std::atoi(argv[++i]);
+        }
+        else if (arg == "--present" && bHasValue)
+        {
+            std::string mode = argv[++i];
+            if (mode == "fifo")           config.mPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+            else if (mode == "mailbox")   config.mPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+            else if (mode == "immediate") config.mPresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+            else std::cout << "Unknown present mode: " << mode << ", fallback to fifo" << std::endl;
+        }
+        else if (arg == "--threads" && bHasValue)
+        {
+            config.mRecordThreads = (uint32_t)std::atoi(argv[++i]);
+        }
+        else if (arg == "--headless")
+        {
+            config.mbHeadless = true;
+        }
+        else if (arg == "--objects" && bHasValue)
+        {
+            config.mScene.mObjects = (uint32_t)std::atoi(argv[++i]);
+        }
+        else if (arg == "--materials" && bHasValue)
+        {
+            config.mScene.mMaterials = (uint32_t)std::atoi(argv[++i]);
+        }
+        else if (arg == "--meshes" && bHasValue)
+        {
+            config.mScene.mMeshes = (uint32_t)std::atoi(argv[++i]);
+        }
+        else if (arg == "--textures" && bHasValue)
+        {
+            config.mScene.mTextures = (uint32_t)std::atoi(argv[++i]);
+        }
+        else if (arg == "--target-ms" && bHasValue)
+        {
+            config.mTargetGPUMs = std::atof(argv[++i]);
+        }
+        else if (arg == "--min-scale" && bHasValue)
+        {
+            config.mMinResolutionScale = (float)std::atof(argv[++i]);
+        }
+        else if (arg == "--gpu-driven")
+        {
+            config.mbGPUDriven = true;
+        }
+        else if (arg == "--no-occlusion")
+        {
+            config.mbOcclusionCulling = false;
+        }
+        else if (arg == "--no-cpu-cull")
+        {
+            config.mbCPUCulling = false;
+        }
+        else if (arg == "--min-pixels" && bHasValue)
+        {
+            config.mMinPixelSize = (float)std::atof(argv[++i]);
+        }
+        else if (arg == "--meshlets")
+        {
+            config.mbMeshlets = true;
+        }
+        else if (arg == "--no-mesh-shaders")
+        {
+            config.mbMeshShaders = false;
+        }
+        else if (arg == "--lod-error" && bHasValue)
+        {
+            config.mLodPixelError = (float)std::atof(argv[++i]);
+        }
+        else if (arg == "--memory-budget" && bHasValue)
+        {
+            config.mMemoryBudgetMB = (uint32_t)std::atoi(argv[++i]);
+        }
+        else if (arg == "--pipeline-cache" && bHasValue)
+        {
+            config.mPipelineCachePath = argv[++i];
+        }
+        else if (arg == "--no-pipeline-cache")
+        {
+            config.mPipelineCachePath.clear();
+        }
+    }
+    return config;
+}
 
 void VulkanEngine::Init()
 {
-    SDL_Init(SDL_INIT_VIDEO);
+    ZoneScoped;
+    auto initStart = std::chrono::high_resolution_clock::now();
+    mConfig.mFrameOverlap = std::clamp(mConfig.mFrameOverlap, 1u, MAX_FRAME_OVERLAP);
+    mFrames.resize(mConfig.mFrameOverlap);
 
-    auto wndFlags = (SDL_WindowFlags)(SDL_WINDOW_VULKAN);
+    // Meshlet的剔除结果只能由间接绘制使用
+    if (mConfig.mbMeshlets && !mConfig.mbGPUDriven)
+    {
+        std::cout << "Meshlet culling requires the GPU driven path, enabling it" << std::endl;
+        mConfig.mbGPUDriven = true;
+    }
 
-    mWnd = SDL_CreateWindow(
-        "Vulkan Engine",
-        SDL_WINDOWPOS_UNDEFINED,
-        SDL_WINDOWPOS_UNDEFINED,
-        (int)mWndExtent.width,
-        (int)mWndExtent.height,
-        wndFlags
-        );
+    if (!mConfig.mbHeadless)
+    {
+        SDL_Init(SDL_INIT_VIDEO);
+
+        auto wndFlags = (SDL_WindowFlags)(SDL_WINDOW_VULKAN);
+
+        mWnd = SDL_CreateWindow(
+            "Vulkan Engine",
+            SDL_WINDOWPOS_UNDEFINED,
+            SDL_WINDOWPOS_UNDEFINED,
+            (int)mWndExtent.width,
+            (int)mWndExtent.height,
+            wndFlags
+            );
+    }
 
     initVulkan();
     initSwapChain();
-    initDefaultRenderPass();
-    initFrameBuffers();
+    initRenderGraph();
     initCommands();
     initSyncObjects();
     initDescriptors();
+    initUploadEngine();
+    initGeometryBuffer();
     initPipelines();
     loadImages();
     loadMeshes();
-    initScene();
+    if (mConfig.mScene.mObjects > 0)
+    {
+        initSyntheticScene();
+    }
+    else
+    {
+        initScene();
+    }
+    uploadMaterials();
+    if (mConfig.mbGPUDriven)
+    {
+        initGPUDriven();
+    }
+    else if (mConfig.mbCPUCulling)
+    {
+        initCulling();
+    }
+    initResidency();
+
+    // 有没有读到缓存分别是热启动和冷启动，两次运行的Pipeline时间之差就是缓存省下的编译时间
+    std::cout << "Startup: " << ElapsedMs(initStart, std::chrono::high_resolution_clock::now()) << "ms, pipelines "
+        << mPipelineCreateMs << "ms, " << (mPipelineCache.IsWarm() ? "warm" : "cold") << " pipeline cache";
+    if (mPipelineCache.IsWarm())
+    {
+        std::cout << " (" << mPipelineCache.GetLoadedBytes() << " bytes from " << mPipelineCache.GetPath() << ")";
+    }
+    std::cout << std::endl;
 
     mb_Initialized = true;
 }
@@ -53,84 +255,184 @@ void VulkanEngine::CleanUp()
     {
         vkDeviceWaitIdle(mDevice);
 
+        pollFrameLatency();
+        reportFrameStats(true);
+
+        // 这次运行新建的Pipeline已经都在缓存里，和读进来的数据一起写回
+        mPipelineCache.Save();
+
         mMainDeletionQueue.Flush();
 
-        vkDestroySurfaceKHR(mInstance, mSurface, nullptr);
+        if (mSurface != VK_NULL_HANDLE)
+        {
+            vkDestroySurfaceKHR(mInstance, mSurface, nullptr);
+        }
 
         vkDestroyDevice(mDevice, nullptr);
         vkb::destroy_debug_utils_messenger(mInstance, mDebugMessenger);
         vkDestroyInstance(mInstance, nullptr);
 
-        SDL_DestroyWindow(mWnd);
+        if (mWnd != nullptr)
+        {
+            SDL_DestroyWindow(mWnd);
+        }
     }
 }
 
 void VulkanEngine::Draw()
 {
-    if (SDL_GetWindowFlags(mWnd) & SDL_WINDOW_MINIMIZED) return;
+    ZoneScoped;
+    if (mWnd != nullptr && (SDL_GetWindowFlags(mWnd) & SDL_WINDOW_MINIMIZED)) return;
+
+    auto frameStart = std::chrono::high_resolution_clock::now();
+    if (mFrameIndex > 0)
+    {
+        mFrameTimeStats.AddSample(ElapsedMs(mLastFrameTime, frameStart));
+    }
+    mLastFrameTime = frameStart;
 
-    // 等GPU渲染完成最后一帧，超时1s
-    VK_CHECK(vkWaitForFences(mDevice, 1, &GetCurrentFrame().mRenderFence, true, 1000000000));
-    VK_CHECK(vkResetFences(mDevice, 1, &GetCurrentFrame().mRenderFence));
+    // 等GPU渲染完成这个FrameData上一次提交的帧，超时1s
+    // Timeline的值只增不减，不需要像Fence一样重置
+    {
+        ZoneScopedN("WaitForFrame");
+        mGraphicsTimeline.Wait(GetCurrentFrame().mTimelineValue, 1000000000);
+    }
+    pollFrameLatency();
 
-    // 等到Fence同步后，可以确定命令执行完成，可以重置Command Buffer
+    // GPU已经用完这一帧的资源，可以删除已经完成的帧释放的对象，临时数据也可以从头开始分配
+    mDeletionQueue.Retire(mGraphicsTimeline.GetCompletedValue());
+    mResidency.RetirePendingFree(mGraphicsTimeline.GetCompletedValue());
+    GetCurrentFrame().mTransientBuffer.Reset();
+
+    // 等到Timeline同步后，可以确定命令执行完成，可以重置Command Buffer
     VK_CHECK(vkResetCommandBuffer(GetCurrentFrame().mCmdBuffer, 0));
+    for (auto & pool : GetCurrentFrame().mWorkerCmdPools)
+    {
+        VK_CHECK(vkResetCommandPool(mDevice, pool, 0));
+    }
 
-    // 从SwapChain中获取Image的Index
-    uint32_t swapChainImageIdx;
-    VK_CHECK(vkAcquireNextImageKHR(mDevice, mSwapChain, 1000000000, GetCurrentFrame().mPresentSem, nullptr, &swapChainImageIdx));
+    // 从SwapChain中获取Image的Index，Headless模式只有一张离屏Image
+    uint32_t swapChainImageIdx = 0;
+    if (!mConfig.mbHeadless)
+    {
+        VK_CHECK(vkAcquireNextImageKHR(mDevice, mSwapChain, 1000000000, GetCurrentFrame().mPresentSem, nullptr, &swapChainImageIdx));
+    }
 
     VkCommandBuffer cmdBuffer = GetCurrentFrame().mCmdBuffer;
+    VkQueryPool timestampPool = GetCurrentFrame().mTimestampPool;
 
     // 开始Command Buffer的录制，这里只使用一次用于显示
+    auto recordStart = std::chrono::high_resolution_clock::now();
     VkCommandBufferBeginInfo cmdBI = VKInit::CmdBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
     VK_CHECK(vkBeginCommandBuffer(cmdBuffer, &cmdBI));
 
-    //make a clear-color from frame number. This will flash with a 120 frame period.
-    VkClearValue clearValues[2];
-    float flash = abs(sin((float)mFrameIndex / 120.f));
-    clearValues[0].color = { { 0.0f, 0.0f, flash, 1.0f } };
-    clearValues[1].depthStencil.depth = 1.0f;
+    if (timestampPool != VK_NULL_HANDLE)
+    {
+        vkCmdResetQueryPool(cmdBuffer, timestampPool, 0, 2);
+        vkCmdWriteTimestamp2(cmdBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, timestampPool, 0);
+    }
+
+    // 分辨率在录制前确定，整帧使用同一个值
+    mRenderExtent = mDynamicResolution.GetRenderExtent();
+    mRenderGraph.SetRenderExtent(mSceneColorTarget, mRenderExtent);
+    mRenderGraph.SetRenderExtent(mDepthTarget, mRenderExtent);
+
+    // 相机和场景参数在所有Pass之前写入，剔除和绘制都会用到
+    updateCameraData();
+    if (!mConfig.mbGPUDriven && mConfig.mbCPUCulling)
+    {
+        cullScene();
+    }
+    // 可见物体的网格和贴图被驱逐过时在这里重新上传，要在下面取得所有权之前
+    updateResidency();
+
+    // 提交还没提交的上传，并在Graphics队列上取得这些资源的所有权
+    VkPipelineStageFlags2 uploadWaitStage;
+    uint64_t uploadWaitValue = mUploadEngine.RecordAcquireBarriers(cmdBuffer, uploadWaitStage);
 
-    VkRenderPassBeginInfo rpBI = VKInit::RenderPassBeginInfo(mRenderPass, mWndExtent, mFrameBuffers[swapChainImageIdx]);
-    rpBI.clearValueCount = 2;
-    rpBI.pClearValues = clearValues;
+    // 读回之前帧的GPU时间戳，要在RenderPass之外录制
+    TracyVkCollect(mTracyCtx, cmdBuffer);
 
-    vkCmdBeginRenderPass(cmdBuffer, &rpBI, VK_SUBPASS_CONTENTS_INLINE);
+    //make a clear-color from frame number. This will flash with a 120 frame period.
+    VkClearValue clearColor;
+    float flash = abs(sin((float)mFrameIndex / 120.f));
+    clearColor.color = { { 0.0f, 0.0f, flash, 1.0f } };
+    mRenderGraph.SetClearValue(mSceneColorTarget, clearColor);
 
-    DrawObjects(cmdBuffer, mRenderScenes.data(), (uint32_t)mRenderScenes.size());
+    // Barrier、Layout转换和Dynamic Rendering都由RenderGraph录制
+    mRenderGraph.SetImportedImage(mSwapChainTarget, mSwapChainImages[swapChainImageIdx], mSwapChainImageViews[swapChainImageIdx]);
+    {
+        TracyVkZone(mTracyCtx, cmdBuffer, "RenderGraph");
+        mRenderGraph.Execute(cmdBuffer);
+    }
+    if (timestampPool != VK_NULL_HANDLE)
+    {
+        vkCmdWriteTimestamp2(cmdBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, timestampPool, 1);
+    }
 
-    vkCmdEndRenderPass(cmdBuffer);
     // 所有操作完成，可以关闭CommandBuffer，不能写入了，可以开始执行
     VK_CHECK(vkEndCommandBuffer(cmdBuffer));
+    auto submitStart = std::chrono::high_resolution_clock::now();
 
     // 准备提交CommandBuffer到队列
     // 需要在wait信号量上等待，它表示交换链在渲染前准备完毕
-    // 渲染完成后需要signal信号量
-    VkSubmitInfo submit = VKInit::SubmitInfo(&cmdBuffer);
-    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    submit.pWaitDstStageMask = &waitStage;
-    submit.waitSemaphoreCount = 1;
-    submit.pWaitSemaphores = &GetCurrentFrame().mPresentSem;
-    submit.signalSemaphoreCount = 1;
-    submit.pSignalSemaphores = &GetCurrentFrame().mRenderSem;
-
-    // 提交命令到队列并执行
-    // renderFence会阻塞直到命令执行完成
-    VK_CHECK(vkQueueSubmit(mGraphicsQueue, 1, &submit, GetCurrentFrame().mRenderFence));
-
-    // 准备呈现，把刚才渲染的图片呈现到窗口
-    // 现在要等的是render信号量，确保渲染完成后才提交到窗口
-    VkPresentInfoKHR presentInfo = VKInit::PresentInfo();
-    presentInfo.pSwapchains = &mSwapChain;
-    presentInfo.swapchainCount = 1;
-    presentInfo.pWaitSemaphores = &GetCurrentFrame().mRenderSem;
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pImageIndices = &swapChainImageIdx;
-
-    VK_CHECK(vkQueuePresentKHR(mGraphicsQueue, &presentInfo));
+    // 渲染完成后需要signal信号量，同时Graphics Timeline会signal一个新的值
+    // 有上传还没完成时，额外等待Transfer Timeline
+    // Headless模式没有SwapChain，只需要Timeline
+    VkSemaphoreSubmitInfo waitInfos[2];
+    uint32_t waitCount = 0;
+    if (!mConfig.mbHeadless)
+    {
+        waitInfos[waitCount++] = VKInit::SemaphoreSubmitInfo(VK_PIPELINE_STAGE_2_BLIT_BIT, GetCurrentFrame().mPresentSem);
+    }
+    if (uploadWaitValue > 0)
+    {
+        waitInfos[waitCount++] = VKInit::SemaphoreSubmitInfo(uploadWaitStage, mUploadEngine.mTimeline.mSemaphore, uploadWaitValue);
+    }
+    VkSemaphoreSubmitInfo signalInfo = VKInit::SemaphoreSubmitInfo(VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, GetCurrentFrame().mRenderSem);
+
+    // 提交命令到队列并执行，记下这一帧的Timeline值
+    // 同一帧里可以有多次提交，只需要记录最后一次的值
+    mGraphicsTimeline.Submit(cmdBuffer, waitInfos, waitCount, &signalInfo, mConfig.mbHeadless ? 0 : 1);
+    GetCurrentFrame().mTimelineValue = mGraphicsTimeline.mLastSubmitted;
+    GetCurrentFrame().mCPUStartTime = frameStart;
+    GetCurrentFrame().mbLatencyPending = true;
+    GetCurrentFrame().mFrameNumber = (uint32_t)mFrameIndex;
+
+    if (!mConfig.mbHeadless)
+    {
+        // 准备呈现，把刚才渲染的图片呈现到窗口
+        // 现在要等的是render信号量，确保渲染完成后才提交到窗口
+        VkPresentInfoKHR presentInfo = VKInit::PresentInfo();
+        presentInfo.pSwapchains = &mSwapChain;
+        presentInfo.swapchainCount = 1;
+        presentInfo.pWaitSemaphores = &GetCurrentFrame().mRenderSem;
+        presentInfo.waitSemaphoreCount = 1;
+        presentInfo.pImageIndices = &swapChainImageIdx;
+
+        VK_CHECK(vkQueuePresentKHR(mGraphicsQueue, &presentInfo));
+    }
+
+    if (mConfig.mbRecordTimings)
+    {
+        // GPU时间要等这一帧完成后在pollFrameLatency里填
+        auto frameEnd = std::chrono::high_resolution_clock::now();
+        mFrameTimings.push_back({
+            (uint32_t)mFrameIndex,
+            ElapsedMs(frameStart, frameEnd),
+            ElapsedMs(recordStart, submitStart),
+            ElapsedMs(submitStart, frameEnd),
+            0.0,
+            mDynamicResolution.mScale });
+    }
 
     mFrameIndex++;
+    FrameMark;
+
+    if (mFrameIndex % STATS_REPORT_INTERVAL == 0)
+    {
+        reportFrameStats(false);
+    }
 }
 
 void VulkanEngine::Run()
@@ -162,37 +464,105 @@ void VulkanEngine::Run()
 
 FrameData& VulkanEngine::GetCurrentFrame()
 {
-    return mFrames[mFrameIndex % FRAME_OVERLAP];
+    return mFrames[mFrameIndex % mFrames.size()];
 }
 
 FrameData& VulkanEngine::GetLastFrame()
 {
-    return mFrames[(mFrameIndex - 1) % 2];
+    return mFrames[(mFrameIndex + mFrames.size() - 1) % mFrames.size()];
 }
 
-AllocatedBuffer VulkanEngine::CreateBuffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage)
+void VulkanEngine::pollFrameLatency()
 {
-    //allocate vertex buffer
-    VkBufferCreateInfo bufferCI = {};
-    bufferCI.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bufferCI.pNext = nullptr;
-    bufferCI.size = allocSize;
-    bufferCI.usage = usage;
+    // 只在每帧开始时轮询，所以统计的精度是一个CPU帧
+    auto now = std::chrono::high_resolution_clock::now();
+    for (auto & frame : mFrames)
+    {
+        if (!frame.mbLatencyPending) continue;
+        if (!mGraphicsTimeline.IsComplete(frame.mTimelineValue)) continue;
 
-    //let the VMA library know that this data should be writeable by CPU, but also readable by GPU
-    VmaAllocationCreateInfo vmaAllocCI = {};
-    vmaAllocCI.usage = memoryUsage;
+        mLatencyStats.AddSample(ElapsedMs(frame.mCPUStartTime, now));
+        frame.mbLatencyPending = false;
+
+        // 这一帧已经完成，时间戳可以直接读，不需要WAIT
+        if (frame.mTimestampPool != VK_NULL_HANDLE)
+        {
+            uint64_t timestamps[2];
+            VkResult result = vkGetQueryPoolResults(mDevice, frame.mTimestampPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+            if (result == VK_SUCCESS)
+            {
+                double gpuMs = (double)(timestamps[1] - timestamps[0]) * mGPUProps.limits.timestampPeriod / 1000000.0;
+                mGPUTimeStats.AddSample(gpuMs);
+                mDynamicResolution.AddSample(gpuMs);
+                if (frame.mFrameNumber < mFrameTimings.size())
+                {
+                    mFrameTimings[frame.mFrameNumber].mGPUMs = gpuMs;
+                }
+            }
+        }
+    }
+}
 
-    AllocatedBuffer newBuffer{};
+void VulkanEngine::reportFrameStats(bool bFinal)
+{
+    if (mLatencyStats.mSamples == 0) return;
+
+    double frameMs = mFrameTimeStats.GetAverage();
+    std::cout << (bFinal ? "[Final] " : "")
+        << PresentModeName(mPresentMode) << " x" << mFrames.size()
+        << " | frame " << frameMs << "ms (" << (frameMs > 0.0 ? 1000.0 / frameMs : 0.0) << " fps)"
+        << " | latency avg " << mLatencyStats.GetAverage() << "ms, max " << mLatencyStats.mMaxMs << "ms"
+        << " | gpu " << mGPUTimeStats.GetAverage() << "ms"
+        << " | scale " << mDynamicResolution.mScale
+        << std::endl;
+
+    // 每帧平均的状态切换次数
+    if (mDrawStatsFrames > 0)
+    {
+        std::cout << "    draws " << mDrawStats.mDraws / mDrawStatsFrames
+            << " | instances " << mDrawStats.mInstances / mDrawStatsFrames
+            << " | triangles " << mDrawStats.mTriangles / mDrawStatsFrames
+            << " | pipeline binds " << mDrawStats.mPipelineBinds / mDrawStatsFrames
+            << " | descriptor set binds " << mDrawStats.mDescSetBinds / mDrawStatsFrames
+            << " | vertex buffer binds " << mDrawStats.mVertexBufferBinds / mDrawStatsFrames
+            << " | index buffer binds " << mDrawStats.mIndexBufferBinds / mDrawStatsFrames
+            << std::endl;
+        if (mConfig.mbCPUCulling && !mConfig.mbGPUDriven)
+        {
+            std::cout << "    visible " << mVisibleStats / mDrawStatsFrames << "/" << mRenderScenes.size()
+                << " (" << SceneCuller::GetSIMDName() << ")" << std::endl;
+        }
+    }
 
-    //allocate the buffer
-    VK_CHECK(vmaCreateBuffer(
-        mAllocator, &bufferCI, &vmaAllocCI,
-        &newBuffer.mBuffer,
-        &newBuffer.mAllocation,
-        nullptr));
+    // 预算为0时不驱逐
+    const VkDeviceSize budget = mResidency.GetBudget();
+    std::cout << "    memory " << mResidentBytes / (1024 * 1024) << "/";
+    if (budget > 0) std::cout << budget / (1024 * 1024) << " MB";
+    else std::cout << "unlimited";
+    std::cout << " | resident meshes " << mResidency.GetResidentCount(ResidentType::Mesh) << "/" << mResidency.GetCount(ResidentType::Mesh)
+        << " | resident textures " << mResidency.GetResidentCount(ResidentType::Texture) << "/" << mResidency.GetCount(ResidentType::Texture)
+        << " | evictions " << mResidency.mEvictionCount << " (" << mResidency.mEvictedBytes / (1024 * 1024) << " MB)"
+        << " | reloads " << mResidency.mReloadCount
+        << std::endl;
+
+    if (bFinal)
+    {
+        mBufferAllocator.PrintStats();
+    }
+    else
+    {
+        mLatencyStats.Reset();
+        mFrameTimeStats.Reset();
+        mGPUTimeStats.Reset();
+        mDrawStats = DrawStats{};
+        mDrawStatsFrames = 0;
+        mVisibleStats = 0;
+    }
+}
 
-    return newBuffer;
+AllocatedBuffer VulkanEngine::CreateBuffer(size_t allocSize, VkBufferUsageFlags usage, MemoryClass memoryClass)
+{
+    return mBufferAllocator.CreateBuffer(allocSize, usage, memoryClass);
 }
 
 size_t VulkanEngine::PadUniformBufferSize(size_t originalSize)
@@ -208,33 +578,16 @@ size_t VulkanEngine::PadUniformBufferSize(size_t originalSize)
     return alignedSize;
 }
 
-void VulkanEngine::ImmediateSubmit(std::function<void(VkCommandBuffer cmdBuffer)>&& function)
-{
-    VkCommandBuffer cmdBuffer = mUploadContext.mCmdBuffer;
-    VkCommandBufferBeginInfo cmdBufferBI = VKInit::CmdBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-
-    VK_CHECK(vkBeginCommandBuffer(cmdBuffer, &cmdBufferBI));
-
-    function(cmdBuffer);
-
-    VK_CHECK(vkEndCommandBuffer(cmdBuffer));
-
-    VkSubmitInfo submitInfo = VKInit::SubmitInfo(&cmdBuffer);
-    VK_CHECK(vkQueueSubmit(mGraphicsQueue, 1, &submitInfo, mUploadContext.mUploadFence));
-
-    vkWaitForFences(mDevice, 1, &mUploadContext.mUploadFence, true, 9999999999);
-    vkResetFences(mDevice, 1, &mUploadContext.mUploadFence);
-    vkResetCommandPool(mDevice, mUploadContext.mCmdPool, 0);
-}
-
 void VulkanEngine::initVulkan()
 {
+    ZoneScoped;
     vkb::InstanceBuilder builder;
 
     auto inst = builder.set_app_name("Vulkan Engine")
         .request_validation_layers(bUseValidationLayers)
         .use_default_debug_messenger()
         .require_api_version(1, 3, 0)
+        .set_headless(mConfig.mbHeadless)
         .build();
 
     vkb::Instance vkbInst = inst.value();
@@ -242,34 +595,157 @@ void VulkanEngine::initVulkan()
     mInstance = vkbInst.instance;
     mDebugMessenger = vkbInst.debug_messenger;
 
-    // 这个函数在SDL2.26.5中无法成功创建Surface
-    SDL_Vulkan_CreateSurface(mWnd, mInstance, &mSurface);
+    // Headless模式没有Surface，vkbootstrap选择设备时也不要求Present支持
+    mSurface = VK_NULL_HANDLE;
+    if (!mConfig.mbHeadless)
+    {
+        // 这个函数在SDL2.26.5中无法成功创建Surface
+        SDL_Vulkan_CreateSurface(mWnd, mInstance, &mSurface);
+    }
+
+    // Timeline Semaphore和vkQueueSubmit2需要的特性
+    VkPhysicalDeviceVulkan12Features features12 {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.timelineSemaphore = VK_TRUE;
+    // GPU Driven用Compute写出的数量绘制
+    features12.drawIndirectCount = mConfig.mbGPUDriven ? VK_TRUE : VK_FALSE;
+    // 深度金字塔的MAX归约采样
+    features12.samplerFilterMinmax = (mConfig.mbGPUDriven && mConfig.mbOcclusionCulling) ? VK_TRUE : VK_FALSE;
+    // Bindless贴图数组：按材质下标非一致地索引，数组可以不写满，绑定后还能写入
+    // 这些特性不在1.3的必选范围内，先确认至少有一个设备支持，否则选择设备时只会报找不到合适的设备
+    {
+        uint32_t gpuCount = 0;
+        VK_CHECK(vkEnumeratePhysicalDevices(mInstance, &gpuCount, nullptr));
+        std::vector<VkPhysicalDevice> gpus(gpuCount);
+        VK_CHECK(vkEnumeratePhysicalDevices(mInstance, &gpuCount, gpus.data()));
+
+        bool bSupported = false;
+        for (VkPhysicalDevice gpu : gpus)
+        {
+            const char* missing = MissingDescriptorIndexingFeature(gpu);
+            if (missing == nullptr)
+            {
+                bSupported = true;
+                break;
+            }
+            VkPhysicalDeviceProperties props;
+            vkGetPhysicalDeviceProperties(gpu, &props);
+            std::cout << props.deviceName << " does not support " << missing << std::endl;
+        }
+        if (!bSupported)
+        {
+            std::cout << "No device supports the descriptor indexing features required by bindless materials" << std::endl;
+            abort();
+        }
+    }
+    features12.descriptorIndexing = VK_TRUE;
+    features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    features12.runtimeDescriptorArray = VK_TRUE;
+    features12.descriptorBindingPartiallyBound = VK_TRUE;
+    features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+
+    VkPhysicalDeviceVulkan13Features features13 {};
+    features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    features13.synchronization2 = VK_TRUE;
+    features13.dynamicRendering = VK_TRUE;
 
     vkb::PhysicalDeviceSelector selector{ vkbInst };
-    vkb::PhysicalDevice physicalDevice = selector
+    selector
         .set_minimum_version(1, 3)
-        .set_surface(mSurface)
-        .select()
-        .value();
+        .set_required_features_12(features12)
+        .set_required_features_13(features13)
+        .set_surface(mSurface);
+    // Mesh Shader是可选的，不支持的设备用Compute剔除Meshlet
+    if (mConfig.mbMeshlets && mConfig.mbMeshShaders)
+    {
+        selector.add_desired_extension(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+    }
+    // 驱动报告的每个堆的预算和用量，显存压力下驱逐资源时使用
+    selector.add_desired_extension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    vkb::PhysicalDevice physicalDevice = selector.select().value();
 
     vkb::DeviceBuilder deviceBuilder { physicalDevice };
     VkPhysicalDeviceShaderDrawParametersFeatures shaderDrawParamsFeatures {};
     shaderDrawParamsFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_DRAW_PARAMETERS_FEATURES;
     shaderDrawParamsFeatures.pNext = nullptr;
     shaderDrawParamsFeatures.shaderDrawParameters = VK_TRUE;
+    deviceBuilder.add_pNext(&shaderDrawParamsFeatures);
+
+    // 扩展存在时还要确认Task和Mesh Shader两个特性都支持
+    VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures {};
+    meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+    std::vector<std::string> extensions = physicalDevice.get_extensions();
+    if (std::find(extensions.begin(), extensions.end(), VK_EXT_MESH_SHADER_EXTENSION_NAME) != extensions.end())
+    {
+        VkPhysicalDeviceFeatures2 features2 {};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &meshShaderFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalDevice.physical_device, &features2);
+
+        mbMeshShading = meshShaderFeatures.taskShader == VK_TRUE && meshShaderFeatures.meshShader == VK_TRUE;
+        // 只打开用到的两个特性
+        VkPhysicalDeviceMeshShaderFeaturesEXT enabledFeatures {};
+        enabledFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+        enabledFeatures.taskShader = meshShaderFeatures.taskShader;
+        enabledFeatures.meshShader = meshShaderFeatures.meshShader;
+        meshShaderFeatures = enabledFeatures;
+        deviceBuilder.add_pNext(&meshShaderFeatures);
+    }
+
+    mbMemoryBudget = std::find(extensions.begin(), extensions.end(), VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) != extensions.end();
 
-    vkb::Device vkbDevice = deviceBuilder.add_pNext(&shaderDrawParamsFeatures).build().value();
+    vkb::Device vkbDevice = deviceBuilder.build().value();
 
     mDevice = vkbDevice.device;
     mGPU = physicalDevice.physical_device;
 
+    if (mbMeshShading)
+    {
+        mCmdDrawMeshTasks = (PFN_vkCmdDrawMeshTasksEXT)vkGetDeviceProcAddr(mDevice, "vkCmdDrawMeshTasksEXT");
+    }
+    if (mConfig.mbMeshlets)
+    {
+        std::cout << "Meshlet culling: " << (mbMeshShading ? "task/mesh shaders" : "compute") << std::endl;
+    }
+
     mGraphicsQueue = vkbDevice.get_queue(vkb::QueueType::graphics).value();
     mGraphicsQueueFamily = vkbDevice.get_queue_index(vkb::QueueType::graphics).value();
 
+    // 优先使用只支持Transfer的Queue Family，其次是其它支持Transfer的Family，都没有就和Graphics共用一个队列
+    mTransferQueue = mGraphicsQueue;
+    mTransferQueueFamily = mGraphicsQueueFamily;
+    auto dedicatedQueue = vkbDevice.get_dedicated_queue(vkb::QueueType::transfer);
+    auto separateQueue = vkbDevice.get_queue(vkb::QueueType::transfer);
+    if (dedicatedQueue)
+    {
+        mTransferQueue = dedicatedQueue.value();
+        mTransferQueueFamily = vkbDevice.get_dedicated_queue_index(vkb::QueueType::transfer).value();
+    }
+    else if (separateQueue)
+    {
+        mTransferQueue = separateQueue.value();
+        mTransferQueueFamily = vkbDevice.get_queue_index(vkb::QueueType::transfer).value();
+    }
+    std::cout << "Transfer queue family: " << mTransferQueueFamily << (mTransferQueueFamily == mGraphicsQueueFamily ? " (shared with graphics)" : "") << std::endl;
+
     VmaAllocatorCreateInfo vmaAllocCI {};
     vmaAllocCI.physicalDevice = physicalDevice;
     vmaAllocCI.device = mDevice;
     vmaAllocCI.instance = mInstance;
+    // VMA需要1.1的vkGetPhysicalDeviceMemoryProperties2来读取预算
+    if (mbMemoryBudget)
+    {
+        vmaAllocCI.vulkanApiVersion = VK_API_VERSION_1_1;
+        vmaAllocCI.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    }
+    std::cout << "Memory budget extension: " << (mbMemoryBudget ? "enabled" : "unavailable") << std::endl;
+#ifdef TRACY_ENABLE
+    VmaDeviceMemoryCallbacks vmaMemoryCallbacks {};
+    vmaMemoryCallbacks.pfnAllocate = TracyVmaAllocate;
+    vmaMemoryCallbacks.pfnFree = TracyVmaFree;
+    vmaAllocCI.pDeviceMemoryCallbacks = &vmaMemoryCallbacks;
+#endif
     vmaCreateAllocator(&vmaAllocCI, &mAllocator);
 
     mMainDeletionQueue.PushFunction([&]()
@@ -277,21 +753,79 @@ void VulkanEngine::initVulkan()
         vmaDestroyAllocator(mAllocator);
     });
 
+    // 每帧的临时数据都从PerFrame Pool里分配，块大小按帧数算好，额外留一点给对齐
+    const VkDeviceSize perFrameSize = mFrames.size() * (FRAME_TRANSIENT_SIZE + sizeof(GPUObjectData) * MAX_OBJECTS + 64 * 1024);
+    mBufferAllocator.Init(mAllocator, BUFFER_POOL_BLOCK_SIZE, perFrameSize);
+
+    // 在销毁Allocator之前，这时所有Buffer都已经释放
+    mMainDeletionQueue.PushFunction([&]()
+    {
+        mBufferAllocator.Destroy();
+    });
+
+    // 在销毁Pool之前，销毁运行中释放、还没到Timeline值的对象
+    mDeletionQueue.Init(mDevice, mAllocator);
+    mMainDeletionQueue.PushFunction([&]()
+    {
+        std::cout << "Deferred deletions: " << mDeletionQueue.mDestroyedCount << " retired, "
+            << mDeletionQueue.GetPendingCount() << " pending at shutdown" << std::endl;
+        mDeletionQueue.Flush();
+    });
+
     vkGetPhysicalDeviceProperties(mGPU, &mGPUProps);
     std::cout << "The GPU has a minimum buffer alignment of " << mGPUProps.limits.minUniformBufferOffsetAlignment << std::endl;
+
+    // 支持时所有Graphics和Compute队列都能写时间戳
+    mbGPUTimestamps = mGPUProps.limits.timestampComputeAndGraphics == VK_TRUE;
 };
 
 void VulkanEngine::initSwapChain()
 {
+    ZoneScoped;
+    if (mConfig.mbHeadless)
+    {
+        // 没有窗口时渲染到一张离屏Image，当作只有一张Image的SwapChain
+        mSwapChainFormat = VK_FORMAT_B8G8R8A8_SRGB;
+        mPresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+
+        VkExtent3D imageExtent { mWndExtent.width, mWndExtent.height, 1 };
+        VkImageCreateInfo imageCI = VKInit::ImageCreateInfo(mSwapChainFormat, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, imageExtent);
+        VmaAllocationCreateInfo vmaAllocCI {};
+        vmaAllocCI.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+        VK_CHECK(vmaCreateImage(mAllocator, &imageCI, &vmaAllocCI, &mOffscreenImage.mImage, &mOffscreenImage.mAllocation, nullptr));
+
+        VkImageViewCreateInfo viewCI = VKInit::ImageViewCreateInfo(mSwapChainFormat, mOffscreenImage.mImage, VK_IMAGE_ASPECT_COLOR_BIT);
+        VkImageView offscreenView;
+        VK_CHECK(vkCreateImageView(mDevice, &viewCI, nullptr, &offscreenView));
+
+        mSwapChainImages = { mOffscreenImage.mImage };
+        mSwapChainImageViews = { offscreenView };
+        std::cout << "Headless, frames in flight: " << mFrames.size() << std::endl;
+
+        mMainDeletionQueue.PushFunction([=]()
+        {
+            vkDestroyImageView(mDevice, offscreenView, nullptr);
+            vmaDestroyImage(mAllocator, mOffscreenImage.mImage, mOffscreenImage.mAllocation);
+        });
+        return;
+    }
+
     vkb::SwapchainBuilder swapChainBuilder { mGPU, mDevice, mSurface };
     vkb::Swapchain vkbSwapChain = swapChainBuilder
         .use_default_format_selection()
-        .set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
+        .set_desired_present_mode(mConfig.mPresentMode)
+        .set_desired_min_image_count(mConfig.mFrameOverlap + 1)
         .set_desired_extent(mWndExtent.width, mWndExtent.height)
+        .add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
         .build()
         .value();
 
     mSwapChain = vkbSwapChain.swapchain;
+    // 设备不支持时vkbootstrap会回退到FIFO，这里记录实际使用的模式
+    mPresentMode = vkbSwapChain.present_mode;
+    std::cout << "Present mode: " << PresentModeName(mPresentMode)
+        << ", frames in flight: " << mFrames.size()
+        << ", swapchain images: " << vkbSwapChain.image_count << std::endl;
     mSwapChainImages = vkbSwapChain.get_images().value();
     mSwapChainImageViews = vkbSwapChain.get_image_views().value();
     mSwapChainFormat = vkbSwapChain.image_format;
@@ -299,135 +833,150 @@ void VulkanEngine::initSwapChain()
     // 删除函数，可以在CleanUp中调用Flush自动删除
     mMainDeletionQueue.PushFunction([=]()
     {
+        for (auto & view : mSwapChainImageViews)
+        {
+            vkDestroyImageView(mDevice, view, nullptr);
+        }
         vkDestroySwapchainKHR(mDevice, mSwapChain, nullptr);
     });
+}
 
-    VkExtent3D dsExtent = { mWndExtent.width, mWndExtent.height, 1 };
-    mDSFormat = VK_FORMAT_D32_SFLOAT;
-
-    VkImageCreateInfo dsImageCI = VKInit::ImageCreateInfo(mDSFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, dsExtent);
-
-    VmaAllocationCreateInfo dsAllocCI {};
-    dsAllocCI.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-    dsAllocCI.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    vmaCreateImage(mAllocator, &dsImageCI, &dsAllocCI, &mDSImage.mImage, &mDSImage.mAllocation, nullptr);
-
-    VkImageViewCreateInfo dsViewCI = VKInit::ImageViewCreateInfo(mDSFormat, mDSImage.mImage, VK_IMAGE_ASPECT_DEPTH_BIT);
-    VK_CHECK(vkCreateImageView(mDevice, &dsViewCI, nullptr, &mDSView));
-
+void VulkanEngine::initRenderGraph()
+{
+    ZoneScoped;
+    mRenderGraph.Init(mDevice, mAllocator);
     mMainDeletionQueue.PushFunction([=]()
     {
-        vkDestroyImageView(mDevice, mDSView, nullptr);
-        vmaDestroyImage(mAllocator, mDSImage.mImage, mDSImage.mAllocation);
+        mRenderGraph.Destroy();
     });
-}
 
-void VulkanEngine::initDefaultRenderPass()
-{
-    // 定义一个attachment绑定到color image上
-    // attachment在renderpass开始时加载为clear，结束时保存
-    // 开始状态为undefined，结束时是present状态
-    VkAttachmentDescription colorAttachDesc {};
-    colorAttachDesc.format = mSwapChainFormat;
-    colorAttachDesc.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachDesc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachDesc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachDesc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachDesc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachDesc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachDesc.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    VkAttachmentReference colorAttachRef {};
-    colorAttachRef.attachment = 0;
-    colorAttachRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkAttachmentDescription dsAttachDesc {};
-    dsAttachDesc.flags = 0;
-    dsAttachDesc.format = mDSFormat;
-    dsAttachDesc.samples = VK_SAMPLE_COUNT_1_BIT;
-    dsAttachDesc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    dsAttachDesc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    dsAttachDesc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    dsAttachDesc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    dsAttachDesc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    dsAttachDesc.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    VkAttachmentReference dsAttachRef {};
-    dsAttachRef.attachment = 1;
-    dsAttachRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpassDesc {};
-    subpassDesc.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpassDesc.colorAttachmentCount = 1;
-    subpassDesc.pColorAttachments = &colorAttachRef;
-    subpassDesc.pDepthStencilAttachment = &dsAttachRef;
-
-    VkSubpassDependency colorDependency {};
-    colorDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    colorDependency.dstSubpass = 0;
-    colorDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    colorDependency.srcAccessMask = 0;
-    colorDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    colorDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-    VkSubpassDependency dsDependency {};
-    dsDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dsDependency.dstSubpass = 0;
-    dsDependency.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-    dsDependency.srcAccessMask = 0;
-    dsDependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-    dsDependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-    VkSubpassDependency dependencies[2] = { colorDependency, dsDependency};
-    VkAttachmentDescription attachments[2] = { colorAttachDesc, dsAttachDesc };
-
-    VkRenderPassCreateInfo rpCI {};
-    rpCI.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    rpCI.attachmentCount = 2;
-    rpCI.pAttachments = attachments;
-    rpCI.subpassCount = 1;
-    rpCI.pSubpasses = &subpassDesc;
-    rpCI.dependencyCount = 2;
-    rpCI.pDependencies = dependencies;
-
-    VK_CHECK(vkCreateRenderPass(mDevice, &rpCI, nullptr, &mRenderPass));
+    // SwapChain的Image由Present信号量在BLIT阶段等待，放大完成后转换到Present
+    RGImageState swapChainInitial { VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_NONE };
+    RGImageState swapChainFinal { VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE };
+    if (mConfig.mbHeadless)
+    {
+        // 离屏Image每帧都被重写，要等上一帧的写完成，结束后留在TRANSFER_DST不再转换
+        swapChainInitial.mAccess = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        swapChainFinal = { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE };
+    }
+    mSwapChainTarget = mRenderGraph.ImportImage("SwapChain", mSwapChainFormat, mWndExtent, VK_IMAGE_ASPECT_COLOR_BIT, swapChainInitial, swapChainFinal);
 
-    mMainDeletionQueue.PushFunction([=]()
+    // 场景的颜色和深度按窗口大小分配，实际渲染的区域每帧由动态分辨率决定
+    mSceneColorTarget = mRenderGraph.CreateImage("SceneColor", mSwapChainFormat, mWndExtent,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    // 颜色每帧在Draw里更新，这里先设置让Compile选择CLEAR
+    VkClearValue colorClear {};
+    mRenderGraph.SetClearValue(mSceneColorTarget, colorClear);
+
+    // 深度只在这一帧的Pass里使用，由RenderGraph分配
+    mDSFormat = VK_FORMAT_D32_SFLOAT;
+    // 遮挡剔除时第一阶段画完后从深度生成金字塔
+    VkImageUsageFlags depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    if (mConfig.mbGPUDriven && mConfig.mbOcclusionCulling)
     {
-        vkDestroyRenderPass(mDevice, mRenderPass, nullptr);
-    });
-}
+        depthUsage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+    }
+    mDepthTarget = mRenderGraph.CreateImage("Depth", mDSFormat, mWndExtent, depthUsage, VK_IMAGE_ASPECT_DEPTH_BIT);
 
-void VulkanEngine::initFrameBuffers()
-{
-    // 为SwapChain的Image创建FrameBuffer，它会把绑定RenderPass到Image用于渲染
-    VkFramebufferCreateInfo fbCI = VKInit::FrameBufferCreateInfo(mRenderPass, mWndExtent);
+    VkClearValue depthClear;
+    depthClear.depthStencil.depth = 1.0f;
+    mRenderGraph.SetClearValue(mDepthTarget, depthClear);
 
-    auto swapChainImageCount = static_cast<uint32_t>(mSwapChainImages.size());
-    mFrameBuffers = std::vector<VkFramebuffer>(swapChainImageCount);
+    // GPU Driven时先用Compute剔除并生成间接绘制命令
+    if (mConfig.mbGPUDriven)
+    {
+        mRenderGraph.AddPass("Cull", [this](const RGPassContext& context)
+        {
+            cullObjects(context.mCmdBuffer, 0);
+        });
+    }
 
-    for (uint32_t i = 0; i < swapChainImageCount; i++)
+    mRenderGraph.AddPass("Forward", [this](const RGPassContext& context)
     {
-        VkImageView attachments[2];
-        attachments[0] = mSwapChainImageViews[i];
-        attachments[1] = mDSView;
+        if (mConfig.mbGPUDriven)
+        {
+            drawObjectsIndirect(context.mCmdBuffer, *context.mInheritance, 0);
+        }
+        else
+        {
+            if (mConfig.mbCPUCulling)
+            {
+                DrawObjects(context.mCmdBuffer, *context.mInheritance, mRenderScenes.data(), mVisibleCount, mVisibleObjects.data());
+            }
+            else
+            {
+                DrawObjects(context.mCmdBuffer, *context.mInheritance, mRenderScenes.data(), (uint32_t)mRenderScenes.size());
+            }
+        }
+    })
+        .Color(mSceneColorTarget)
+        .Depth(mDepthTarget)
+        .Secondary();
 
-        fbCI.pAttachments = attachments;
-        fbCI.attachmentCount = 2;
-        VK_CHECK(vkCreateFramebuffer(mDevice, &fbCI, nullptr, &mFrameBuffers[i]));
+    // 两阶段遮挡剔除：用第一阶段的深度生成金字塔，重新测试被上一帧金字塔遮挡的物体，补画新出现的
+    if (mConfig.mbGPUDriven && mConfig.mbOcclusionCulling)
+    {
+        mRenderGraph.AddPass("DepthPyramid", [this](const RGPassContext& context)
+        {
+            buildDepthPyramid(context.mCmdBuffer);
+        })
+            .Read(mDepthTarget, RGAccess::ComputeSampled);
 
-        mMainDeletionQueue.PushFunction([=]()
+        mRenderGraph.AddPass("CullLate", [this](const RGPassContext& context)
         {
-            vkDestroyFramebuffer(mDevice, mFrameBuffers[i], nullptr);
-            vkDestroyImageView(mDevice, mSwapChainImageViews[i], nullptr);
+            cullObjects(context.mCmdBuffer, 1);
         });
+
+        mRenderGraph.AddPass("ForwardLate", [this](const RGPassContext& context)
+        {
+            drawObjectsIndirect(context.mCmdBuffer, *context.mInheritance, 1);
+        })
+            .Color(mSceneColorTarget)
+            .Depth(mDepthTarget)
+            .Secondary();
+    }
+
+    // 渲染区域小于窗口时线性过滤放大，相等时就是一次拷贝
+    mRenderGraph.AddPass("Upscale", [this](const RGPassContext& context)
+    {
+        VKUtil::BlitImageToImage(context.mCmdBuffer,
+            mRenderGraph.GetImage(mSceneColorTarget), mRenderGraph.GetImage(mSwapChainTarget),
+            mRenderExtent, mWndExtent);
+    })
+        .Read(mSceneColorTarget, RGAccess::TransferSrc)
+        .Write(mSwapChainTarget, RGAccess::TransferDst);
+
+    mRenderGraph.Compile();
+
+    mDynamicResolution.Init(mWndExtent, mConfig.mTargetGPUMs, mConfig.mMinResolutionScale, (uint32_t)mFrames.size());
+    mRenderExtent = mWndExtent;
+    if (mConfig.mTargetGPUMs > 0.0)
+    {
+        std::cout << "Dynamic resolution, target GPU time " << mConfig.mTargetGPUMs << "ms, min scale " << mDynamicResolution.mMinScale << std::endl;
     }
 }
 
 void VulkanEngine::initCommands()
 {
+    ZoneScoped;
+    uint32_t workerCount = mConfig.mRecordThreads;
+    if (workerCount == 0)
+    {
+        uint32_t cores = std::thread::hardware_concurrency();
+        workerCount = cores > 1 ? cores - 1 : 0;
+    }
+    mWorkerPool.Init(workerCount);
+    std::cout << "Command recording threads: " << mWorkerPool.GetThreadCount() << std::endl;
+
+    mMainDeletionQueue.PushFunction([=]()
+    {
+        mWorkerPool.Destroy();
+    });
+
     VkCommandPoolCreateInfo cmdPoolCI = VKInit::CmdPoolCreateInfo(mGraphicsQueueFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    // Secondary的Pool每帧整体重置，用TRANSIENT就够了
+    VkCommandPoolCreateInfo workerPoolCI = VKInit::CmdPoolCreateInfo(mGraphicsQueueFamily, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
 
     for (auto & frame : mFrames)
     {
@@ -440,22 +989,50 @@ void VulkanEngine::initCommands()
         {
             vkDestroyCommandPool(mDevice, frame.mCmdPool, nullptr);
         });
-    }
 
-    VkCommandPoolCreateInfo uploadCmdPoolCI = VKInit::CmdPoolCreateInfo(mGraphicsQueueFamily);
-    VK_CHECK(vkCreateCommandPool(mDevice, &uploadCmdPoolCI, nullptr, &mUploadContext.mCmdPool));
+        frame.mWorkerCmdPools.resize(mWorkerPool.GetThreadCount());
+        frame.mWorkerCmdBuffers.resize(mWorkerPool.GetThreadCount());
+        for (uint32_t i = 0; i < mWorkerPool.GetThreadCount(); i++)
+        {
+            VK_CHECK(vkCreateCommandPool(mDevice, &workerPoolCI, nullptr, &frame.mWorkerCmdPools[i]));
+
+            VkCommandBufferAllocateInfo secondaryAI = VKInit::CmdBufferAllocateInfo(frame.mWorkerCmdPools[i], 1, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+            VK_CHECK(vkAllocateCommandBuffers(mDevice, &secondaryAI, &frame.mWorkerCmdBuffers[i]));
+
+            VkCommandPool workerPool = frame.mWorkerCmdPools[i];
+            mMainDeletionQueue.PushFunction([=]()
+            {
+                vkDestroyCommandPool(mDevice, workerPool, nullptr);
+            });
+        }
+    }
+
+#ifdef TRACY_ENABLE
+    // Tracy的GPU Context初始化时要提交一次命令来校准时间戳
+    VK_CHECK(vkCreateCommandPool(mDevice, &cmdPoolCI, nullptr, &mTracyCmdPool));
+    VkCommandBufferAllocateInfo tracyCmdAI = VKInit::CmdBufferAllocateInfo(mTracyCmdPool, 1);
+    VkCommandBuffer tracyCmdBuffer;
+    VK_CHECK(vkAllocateCommandBuffers(mDevice, &tracyCmdAI, &tracyCmdBuffer));
+    mTracyCtx = TracyVkContext(mGPU, mDevice, mGraphicsQueue, tracyCmdBuffer);
 
     mMainDeletionQueue.PushFunction([=]()
     {
-        vkDestroyCommandPool(mDevice, mUploadContext.mCmdPool, nullptr);
+        TracyVkDestroy(mTracyCtx);
+        vkDestroyCommandPool(mDevice, mTracyCmdPool, nullptr);
     });
-    VkCommandBufferAllocateInfo cmdBufferAI = VKInit::CmdBufferAllocateInfo(mUploadContext.mCmdPool, 1);
-    VK_CHECK(vkAllocateCommandBuffers(mDevice, &cmdBufferAI, &mUploadContext.mCmdBuffer));
-
+#endif
 }
 
 void VulkanEngine::initPipelines()
 {
+    ZoneScoped;
+    // 之后创建的剔除和金字塔的Compute Pipeline也用这个缓存，退出时由CleanUp写回
+    mPipelineCache.Init(mDevice, mGPUProps, mConfig.mPipelineCachePath);
+    mMainDeletionQueue.PushFunction([&]()
+    {
+        mPipelineCache.Destroy();
+    });
+
     VkShaderModule colorMeshFS;
     if (!loadShaderModule("../../Assets/Shaders/DefaultLit.frag.spv", &colorMeshFS))
     {
@@ -472,34 +1049,29 @@ void VulkanEngine::initPipelines()
         std::cerr << "Error when building shader" << std::endl;
     }
 
+    // 物体矩阵和材质下标都从Object SSBO里按gl_InstanceIndex读取，不需要Push Constant
+    // 有没有贴图的材质都用同一个Layout，Set 2是Bindless的贴图数组和材质Buffer
     VkPipelineLayoutCreateInfo meshPipelineLayoutCI = VKInit::PipelineLayoutCreateInfo();
-    VkPushConstantRange pushConstant;
-    pushConstant.offset = 0;
-    pushConstant.size = sizeof(MeshPushConstants);
-    pushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    meshPipelineLayoutCI.pushConstantRangeCount = 1;
-    meshPipelineLayoutCI.pPushConstantRanges = &pushConstant;
-
-    std::array<VkDescriptorSetLayout, 2> descSetLayouts = { mGlobalDescSetLayout, mSceneDescSetLayout };
+
+    std::array<VkDescriptorSetLayout, 3> descSetLayouts = { mGlobalDescSetLayout, mSceneDescSetLayout, mBindless.GetLayout() };
     meshPipelineLayoutCI.setLayoutCount = static_cast<uint32_t>(descSetLayouts.size());
     meshPipelineLayoutCI.pSetLayouts = descSetLayouts.data();
-    VkPipelineLayout meshPipelineLayout;
-    VK_CHECK(vkCreatePipelineLayout(mDevice, &meshPipelineLayoutCI, nullptr, &meshPipelineLayout));
-
-    std::array<VkDescriptorSetLayout, 3> texDescSetLayouts = { mGlobalDescSetLayout, mSceneDescSetLayout, mTextureDescSetLayout };
-    VkPipelineLayoutCreateInfo texPipelineLayoutCI = meshPipelineLayoutCI;
-    texPipelineLayoutCI.setLayoutCount = static_cast<uint32_t>(texDescSetLayouts.size());
-    texPipelineLayoutCI.pSetLayouts = texDescSetLayouts.data();
-    VkPipelineLayout texPipelineLayout;
-    VK_CHECK(vkCreatePipelineLayout(mDevice, &texPipelineLayoutCI, nullptr, &texPipelineLayout));
+    VK_CHECK(vkCreatePipelineLayout(mDevice, &meshPipelineLayoutCI, nullptr, &mMeshPipelineLayout));
 
     PipelineBuilder pipelineBuilder;
+    auto buildPipeline = [&]()
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        VkPipeline pipeline = pipelineBuilder.BuildPipeline(mDevice, mPipelineCache.GetCache());
+        mPipelineCreateMs += ElapsedMs(start, std::chrono::high_resolution_clock::now());
+        return pipeline;
+    };
     pipelineBuilder.mShaderStageCIs.push_back(
         VKInit::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, meshVS));
     pipelineBuilder.mShaderStageCIs.push_back(
         VKInit::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, colorMeshFS));
 
-    pipelineBuilder.mPipelineLayout = meshPipelineLayout;
+    pipelineBuilder.mPipelineLayout = mMeshPipelineLayout;
 
     pipelineBuilder.mVIState = VKInit::PipelineVIStateCreateInfo();
     pipelineBuilder.mIAState = VKInit::PipelineIAStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
@@ -512,30 +1084,88 @@ void VulkanEngine::initPipelines()
     pipelineBuilder.mViewport.maxDepth = 1.0f;
     pipelineBuilder.mScissor.offset = {0, 0};
     pipelineBuilder.mScissor.extent = mWndExtent;
+    // 渲染分辨率每帧会变，Viewport和Scissor在录制时设置
+    pipelineBuilder.mDynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
 
     pipelineBuilder.mRSState = VKInit::PipelineRSStateCreateInfo(VK_POLYGON_MODE_FILL);
     pipelineBuilder.mMSState = VKInit::PipelineMSStateCreateInfo();
     pipelineBuilder.mCBAttach = VKInit::PipelineCBAttachState();
     pipelineBuilder.mDSState = VKInit::PipelineDSStateCreateInfo(true, true, VK_COMPARE_OP_LESS_OR_EQUAL);
 
-    // Mesh Rendering
-    VertexInputDesc viDesc = Vertex::GetVertexDesc();
-    pipelineBuilder.mVIState.pVertexAttributeDescriptions = viDesc.mAttributes.data();
-    pipelineBuilder.mVIState.vertexAttributeDescriptionCount = (uint32_t)viDesc.mAttributes.size();
-    pipelineBuilder.mVIState.pVertexBindingDescriptions = viDesc.mBindings.data();
-    pipelineBuilder.mVIState.vertexBindingDescriptionCount = (uint32_t)viDesc.mBindings.size();
+    // Mesh Rendering，位置和其他属性分别来自两路流
+    pipelineBuilder.mVIState = VertexLayouts::Full.GetVIState();
+
+    pipelineBuilder.mColorFormat = mSwapChainFormat;
+    pipelineBuilder.mDepthFormat = mDSFormat;
 
-    VkPipeline meshPipeline = pipelineBuilder.BuildPipeline(mDevice, mRenderPass);
+    VkPipeline meshPipeline = buildPipeline();
 
-    CreateMaterial(meshPipeline, meshPipelineLayout, "DefaultMesh");
+    CreateMaterial(meshPipeline, mMeshPipelineLayout, "DefaultMesh");
 
     pipelineBuilder.mShaderStageCIs.clear();
     pipelineBuilder.mShaderStageCIs.push_back(VKInit::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, meshVS));
     pipelineBuilder.mShaderStageCIs.push_back(VKInit::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, texMeshFS));
 
-    pipelineBuilder.mPipelineLayout = texPipelineLayout;
-    VkPipeline texPipeline = pipelineBuilder.BuildPipeline(mDevice, mRenderPass);
-    CreateMaterial(texPipeline, texPipelineLayout, "TexturedMesh");
+    VkPipeline texPipeline = buildPipeline();
+    CreateMaterial(texPipeline, mMeshPipelineLayout, "TexturedMesh");
+
+    // Task/Mesh Shader代替顶点着色器，片元着色器不变，Meshlet数据都在Set 3
+    VkPipeline meshletPipeline = VK_NULL_HANDLE;
+    VkPipeline texMeshletPipeline = VK_NULL_HANDLE;
+    if (mbMeshShading)
+    {
+        const VkShaderStageFlags meshletStages = VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+        std::array<VkDescriptorSetLayoutBinding, 10> meshletBindings;
+        for (uint32_t i = 0; i < 8; i++)
+        {
+            meshletBindings[i] = VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, meshletStages, i);
+        }
+        meshletBindings[8] = VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_TASK_BIT_EXT, 8);
+        meshletBindings[9] = VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, meshletStages, 9);
+
+        mMeshletDescSetLayout = mDescLayoutCache.CreateLayout(meshletBindings.data(), static_cast<uint32_t>(meshletBindings.size()));
+
+        VkPushConstantRange meshletPushConstant {};
+        meshletPushConstant.offset = 0;
+        meshletPushConstant.size = sizeof(GPUMeshletDrawParams);
+        meshletPushConstant.stageFlags = VK_SHADER_STAGE_TASK_BIT_EXT;
+
+        // Set 2和顶点着色器路径一样是Bindless的描述符集
+        std::array<VkDescriptorSetLayout, 4> meshletSetLayouts = { mGlobalDescSetLayout, mSceneDescSetLayout, mBindless.GetLayout(), mMeshletDescSetLayout };
+        VkPipelineLayoutCreateInfo meshletPipelineLayoutCI = VKInit::PipelineLayoutCreateInfo();
+        meshletPipelineLayoutCI.setLayoutCount = static_cast<uint32_t>(meshletSetLayouts.size());
+        meshletPipelineLayoutCI.pSetLayouts = meshletSetLayouts.data();
+        meshletPipelineLayoutCI.pushConstantRangeCount = 1;
+        meshletPipelineLayoutCI.pPushConstantRanges = &meshletPushConstant;
+        VK_CHECK(vkCreatePipelineLayout(mDevice, &meshletPipelineLayoutCI, nullptr, &mMeshletPipelineLayout));
+
+        VkShaderModule meshletTS;
+        if (!loadShaderModule("../../Assets/Shaders/Meshlet.task.spv", &meshletTS))
+        {
+            std::cerr << "Error when building shader" << std::endl;
+        }
+        VkShaderModule meshletMS;
+        if (!loadShaderModule("../../Assets/Shaders/Meshlet.mesh.spv", &meshletMS))
+        {
+            std::cerr << "Error when building shader" << std::endl;
+        }
+
+        pipelineBuilder.mPipelineLayout = mMeshletPipelineLayout;
+        pipelineBuilder.mShaderStageCIs.clear();
+        pipelineBuilder.mShaderStageCIs.push_back(VKInit::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_TASK_BIT_EXT, meshletTS));
+        pipelineBuilder.mShaderStageCIs.push_back(VKInit::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_MESH_BIT_EXT, meshletMS));
+        pipelineBuilder.mShaderStageCIs.push_back(VKInit::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, colorMeshFS));
+        meshletPipeline = buildPipeline();
+
+        pipelineBuilder.mShaderStageCIs[2] = VKInit::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, texMeshFS);
+        texMeshletPipeline = buildPipeline();
+
+        GetMaterial("DefaultMesh")->mMeshletPipeline = meshletPipeline;
+        GetMaterial("TexturedMesh")->mMeshletPipeline = texMeshletPipeline;
+
+        vkDestroyShaderModule(mDevice, meshletTS, nullptr);
+        vkDestroyShaderModule(mDevice, meshletMS, nullptr);
+    }
 
     vkDestroyShaderModule(mDevice, texMeshFS, nullptr);
     vkDestroyShaderModule(mDevice, meshVS, nullptr);
@@ -546,13 +1176,20 @@ void VulkanEngine::initPipelines()
         vkDestroyPipeline(mDevice, meshPipeline, nullptr);
         vkDestroyPipeline(mDevice, texPipeline, nullptr);
 
-        vkDestroyPipelineLayout(mDevice, meshPipelineLayout, nullptr);
-        vkDestroyPipelineLayout(mDevice, texPipelineLayout, nullptr);
+        vkDestroyPipelineLayout(mDevice, mMeshPipelineLayout, nullptr);
+
+        if (mbMeshShading)
+        {
+            vkDestroyPipeline(mDevice, meshletPipeline, nullptr);
+            vkDestroyPipeline(mDevice, texMeshletPipeline, nullptr);
+            vkDestroyPipelineLayout(mDevice, mMeshletPipelineLayout, nullptr);
+        }
     });
 }
 
 void VulkanEngine::initScene()
 {
+    ZoneScoped;
     RenderScene scene{};
     scene.mMesh = GetMesh("ObjMesh");
     scene.mMaterial = GetMaterial("DefaultMesh");
@@ -582,15 +1219,6 @@ void VulkanEngine::initScene()
         }
     }
 
-    Material* texMat = GetMaterial("TexturedMesh");
-    VkDescriptorSetAllocateInfo descSetAI {};
-    descSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    descSetAI.pNext = nullptr;
-    descSetAI.descriptorPool = mDescPool;
-    descSetAI.descriptorSetCount = 1;
-    descSetAI.pSetLayouts = &mTextureDescSetLayout;
-    vkAllocateDescriptorSets(mDevice, &descSetAI, &texMat->mTexSet);
-
     VkSamplerCreateInfo samplerCI = VKInit::SamplerCreateInfo(VK_FILTER_NEAREST);
 
     VkSampler blockySampler;
@@ -601,147 +1229,745 @@ void VulkanEngine::initScene()
         vkDestroySampler(mDevice, blockySampler, nullptr);
     });
 
-    VkDescriptorImageInfo descImageInfo {};
-    descImageInfo.sampler = blockySampler;
-    descImageInfo.imageView = mTextures["EmpireDiffuse"].mImageView;
-    descImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    auto it = mTextures.find("EmpireDiffuse");
+    if (it != mTextures.end())
+    {
+        bindMaterialTexture(GetMaterial("TexturedMesh"), &it->second, blockySampler);
+    }
+}
+
+void VulkanEngine::initSyntheticScene()
+{
+    ZoneScoped;
+    const SyntheticSceneConfig& config = mConfig.mScene;
+    uint32_t meshCount = std::max(config.mMeshes, 1u);
+    uint32_t materialCount = std::max(config.mMaterials, 1u);
+
+    // 固定种子，每次生成的场景相同，不同版本的结果才能比较
+    std::mt19937 rng(1234);
+
+    // 细分程度逐个增加的球，顶点数不同
+    std::vector<Mesh*> meshes(meshCount);
+    for (uint32_t i = 0; i < meshCount; i++)
+    {
+        glm::vec3 color = glm::vec3((i * 97) % 256, (i * 57 + 128) % 256, (i * 23 + 64) % 256) / 255.0f;
+
+        Mesh mesh{};
+        mesh.BuildSphere(4 + i, 6 + i * 2, color);
+        uploadMesh(mesh);
+
+        std::string name = "SyntheticMesh" + std::to_string(i);
+        mMeshes[name] = mesh;
+        meshes[i] = GetMesh(name);
+    }
+
+    // 颜色随机的棋盘格
+    const uint32_t texSize = 64;
+    std::vector<Texture*> textures(config.mTextures);
+    std::vector<uint32_t> pixels(texSize * texSize);
+    for (uint32_t i = 0; i < config.mTextures; i++)
+    {
+        uint32_t colorA = rng() | 0xFF000000;
+        uint32_t colorB = rng() | 0xFF000000;
+        for (uint32_t y = 0; y < texSize; y++)
+        {
+            for (uint32_t x = 0; x < texSize; x++)
+            {
+                pixels[y * texSize + x] = ((x / 8 + y / 8) & 1) ? colorA : colorB;
+            }
+        }
+
+        textures[i] = createTexture("SyntheticTexture" + std::to_string(i), std::vector<uint32_t>(pixels), texSize, texSize);
+    }
+
+    VkSamplerCreateInfo samplerCI = VKInit::SamplerCreateInfo(VK_FILTER_NEAREST);
+    VkSampler sampler;
+    vkCreateSampler(mDevice, &samplerCI, nullptr, &sampler);
+
+    mMainDeletionQueue.PushFunction([=]()
+    {
+        vkDestroySampler(mDevice, sampler, nullptr);
+    });
+
+    // 偶数材质只用顶点色，奇数材质带贴图，相邻材质的Pipeline和贴图都不同
+    Material* defaultMat = GetMaterial("DefaultMesh");
+    Material* texturedMat = GetMaterial("TexturedMesh");
+    std::vector<Material*> materials(materialCount);
+    for (uint32_t i = 0; i < materialCount; i++)
+    {
+        bool bTextured = !textures.empty() && (i % 2 == 1);
+        Material* base = bTextured ? texturedMat : defaultMat;
+        Material* mat = CreateMaterial(base->mPipeline, base->mPipelineLayout, "SyntheticMaterial" + std::to_string(i));
+        mat->mMeshletPipeline = base->mMeshletPipeline;
+        materials[i] = mat;
+
+        if (!bTextured) continue;
+
+        bindMaterialTexture(mat, textures[(i / 2) % textures.size()], sampler);
+    }
 
-    VkWriteDescriptorSet textureWriteDescSet = VKInit::WriteDesc(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, texMat->mTexSet, &descImageInfo, nullptr, 0);
-    vkUpdateDescriptorSets(mDevice, 1, &textureWriteDescSet, 0, nullptr);
+    // 和initScene里41x41的网格一样的间距和缩放，边长按物体数扩展
+    // 网格和材质随机分配，绘制顺序就是最差的状态切换顺序
+    uint32_t side = (uint32_t)std::ceil(std::sqrt((double)config.mObjects));
+    std::uniform_int_distribution<uint32_t> meshDist(0, meshCount - 1);
+    std::uniform_int_distribution<uint32_t> materialDist(0, materialCount - 1);
+    mRenderScenes.reserve(config.mObjects);
+    for (uint32_t i = 0; i < config.mObjects; i++)
+    {
+        int x = (int)(i % side) - (int)side / 2;
+        int y = (int)(i / side) - (int)side / 2;
+
+        RenderScene scene{};
+        scene.mMesh = meshes[meshDist(rng)];
+        scene.mMaterial = materials[materialDist(rng)];
+        glm::mat4 translation = glm::translate(glm::mat4{1.0f}, glm::vec3(x, 0, y));
+        glm::mat4 scale = glm::scale(glm::mat4{1.0f}, glm::vec3(0.2, 0.2, 0.2));
+        scene.mTransform = translation * scale;
+
+        mRenderScenes.push_back(scene);
+    }
+
+    std::cout << "Synthetic scene: " << config.mObjects << " objects, " << materialCount << " materials, "
+        << meshCount << " meshes, " << config.mTextures << " textures" << std::endl;
 }
 
-void VulkanEngine::initSyncObjects()
+void VulkanEngine::initGPUDriven()
 {
-    VkFenceCreateInfo fenceCI = VKInit::FenceCreateInfo(VK_FENCE_CREATE_SIGNALED_BIT);
-    VkSemaphoreCreateInfo semCI = VKInit::SemaphoreCreateInfo();
+    ZoneScoped;
+    // 按Pipeline和网格排序，同一批次的物体连续存放，物体在GPU Buffer里的下标就是排序后的位置
+    // 材质下标在物体数据里，Pipeline相同的材质合并成一个批次
+    // 网格在同一块GeometryBuffer里并且索引类型相同时，排序后相邻的不同网格也合并成一个批次
+    std::vector<uint32_t> order(mRenderScenes.size());
+    for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+    {
+        const RenderScene& sa = mRenderScenes[a];
+        const RenderScene& sb = mRenderScenes[b];
+        uint64_t keyA = DrawList::MakeKey(DRAW_PASS_OPAQUE, sa.mMaterial->mPipelineID, 0, 0, 0.0f);
+        uint64_t keyB = DrawList::MakeKey(DRAW_PASS_OPAQUE, sb.mMaterial->mPipelineID, 0, 0, 0.0f);
+        if (keyA != keyB) return keyA < keyB;
+        // 同一个Pipeline里再按块和索引类型分开，批次数最少
+        const GeometryRange& ga = sa.mMesh->mGeometry;
+        const GeometryRange& gb = sb.mMesh->mGeometry;
+        if (ga.mBlock != gb.mBlock) return ga.mBlock < gb.mBlock;
+        if (ga.mIndexType != gb.mIndexType) return ga.mIndexType < gb.mIndexType;
+        return sa.mMesh->mID < sb.mMesh->mID;
+    });
+
+    mGPUObjectCount = (uint32_t)order.size();
+    std::vector<GPUObjectData> objects(mGPUObjectCount);
+    std::vector<GPUObjectInfo> infos(mGPUObjectCount);
+    std::vector<GPUMeshLod> lods;
+    std::unordered_map<const Mesh*, uint32_t> lodOffsets;
+    mIndirectBatches.clear();
+    for (uint32_t i = 0; i < mGPUObjectCount; i++)
+    {
+        const RenderScene& scene = mRenderScenes[order[i]];
+        const GeometryRange& geometry = scene.mMesh->mGeometry;
+        if (mIndirectBatches.empty() ||
+            mIndirectBatches.back().mMaterial->mPipeline != scene.mMaterial->mPipeline ||
+            mIndirectBatches.back().mGeometryBlock != geometry.mBlock ||
+            mIndirectBatches.back().mIndexType != geometry.mIndexType)
+        {
+            mIndirectBatches.push_back({ scene.mMaterial, geometry.mBlock, geometry.mIndexType, i, 0, 0, 0 });
+        }
+        IndirectBatch& batch = mIndirectBatches.back();
+        batch.mMaxCount++;
+
+        objects[i].mModelMatrix = scene.mTransform;
+        objects[i].mMaterialIndex = scene.mMaterial->mID;
+        const Assets::MeshBounds& bounds = scene.mMesh->mBounds;
+        infos[i].mSphere = glm::vec4(bounds.mOrigin[0], bounds.mOrigin[1], bounds.mOrigin[2], bounds.mRadius);
+        infos[i].mBatch = (uint32_t)mIndirectBatches.size() - 1;
+        infos[i].mFirstCommand = batch.mFirstCommand;
+        infos[i].mIndexCount = geometry.mIndexCount;
+        infos[i].mFirstIndex = geometry.mFirstIndex;
+        infos[i].mVertexOffset = (int32_t)geometry.mFirstVertex;
+
+        auto lodIt = lodOffsets.find(scene.mMesh);
+        if (lodIt == lodOffsets.end())
+        {
+            lodIt = lodOffsets.emplace(scene.mMesh, (uint32_t)lods.size()).first;
+            for (const Assets::MeshLod& lod : scene.mMesh->mLods)
+            {
+                lods.push_back({ geometry.mFirstIndex + lod.mFirstIndex, lod.mIndexCount, lod.mError, 0 });
+            }
+        }
+        infos[i].mLodOffset = lodIt->second;
+        infos[i].mLodCount = (uint32_t)scene.mMesh->mLods.size();
+    }
 
+    if (mConfig.mbMeshlets)
+    {
+        initMeshlets(order, infos);
+    }
+
+    // 顶点着色器和剔除都会读物体数据，Mesh Shader路径里是Task和Mesh Shader
+    const VkDeviceSize objectSize = std::max<size_t>(objects.size(), 1) * sizeof(GPUObjectData);
+    const VkDeviceSize infoSize = std::max<size_t>(infos.size(), 1) * sizeof(GPUObjectInfo);
+    mGPUObjectBuffer = CreateBuffer(objectSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryClass::DeviceLocal);
+    mGPUObjectInfoBuffer = CreateBuffer(infoSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryClass::DeviceLocal);
+    mGPULodBuffer = CreateBuffer(std::max<size_t>(lods.size(), 1) * sizeof(GPUMeshLod), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryClass::DeviceLocal);
+    if (mGPUObjectCount > 0)
+    {
+        VkPipelineStageFlags2 objectStages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT;
+        if (mbMeshShading)
+        {
+            objectStages |= VK_PIPELINE_STAGE_2_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT;
+        }
+        mUploadEngine.UploadBuffer(mGPUObjectBuffer.mBuffer, 0, objects.data(), objects.size() * sizeof(GPUObjectData),
+            objectStages, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+        mUploadEngine.UploadBuffer(mGPUObjectInfoBuffer.mBuffer, 0, infos.data(), infos.size() * sizeof(GPUObjectInfo),
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+        mUploadEngine.UploadBuffer(mGPULodBuffer.mBuffer, 0, lods.data(), lods.size() * sizeof(GPUMeshLod),
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+    }
+
+    // 顶点着色器的Set 1指向静态的物体数据，动态偏移为0
+    DescriptorInfo objectInfo(mGPUObjectBuffer.mBuffer, 0, objectSize);
+    mGPUSceneDescSet = mDescSetCache.Get(mSceneDescSetLayout, &objectInfo);
+
+    // 深度金字塔要在剔除的描述符集之前创建
+    initDepthPyramid();
+
+    // 剔除的Pipeline，Compute剔除Meshlet时多出Meshlet数据和压缩后的索引，按物体剔除时多出LOD表
+    const bool bComputeMeshlets = mConfig.mbMeshlets && !mbMeshShading;
+    std::vector<VkDescriptorSetLayoutBinding> cullBindings {
+        VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+        VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+        VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2),
+        VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 3),
+        VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 4),
+        VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 5),
+        VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT, 6)
+    };
+    if (bComputeMeshlets)
+    {
+        for (uint32_t binding = 7; binding < 12; binding++)
+        {
+            cullBindings.push_back(VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, binding));
+        }
+    }
+    else
+    {
+        cullBindings.push_back(VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 7));
+    }
+    mCullDescSetLayout = mDescLayoutCache.CreateLayout(cullBindings.data(), static_cast<uint32_t>(cullBindings.size()));
+
+    VkPushConstantRange cullPushConstant {};
+    cullPushConstant.offset = 0;
+    cullPushConstant.size = sizeof(uint32_t);
+    cullPushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkPipelineLayoutCreateInfo cullPipelineLayoutCI = VKInit::PipelineLayoutCreateInfo();
+    cullPipelineLayoutCI.setLayoutCount = 1;
+    cullPipelineLayoutCI.pSetLayouts = &mCullDescSetLayout;
+    cullPipelineLayoutCI.pushConstantRangeCount = 1;
+    cullPipelineLayoutCI.pPushConstantRanges = &cullPushConstant;
+    VK_CHECK(vkCreatePipelineLayout(mDevice, &cullPipelineLayoutCI, nullptr, &mCullPipelineLayout));
+
+    VkShaderModule cullCS;
+    if (!loadShaderModule(bComputeMeshlets ? "../../Assets/Shaders/CullMeshlets.comp.spv" : "../../Assets/Shaders/CullObjects.comp.spv", &cullCS))
+    {
+        std::cerr << "Error when building shader" << std::endl;
+    }
+
+    VkComputePipelineCreateInfo cullPipelineCI {};
+    cullPipelineCI.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    cullPipelineCI.pNext = nullptr;
+    cullPipelineCI.stage = VKInit::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, cullCS);
+    cullPipelineCI.layout = mCullPipelineLayout;
+    auto pipelineStart = std::chrono::high_resolution_clock::now();
+    VK_CHECK(vkCreateComputePipelines(mDevice, mPipelineCache.GetCache(), 1, &cullPipelineCI, nullptr, &mCullPipeline));
+    mPipelineCreateMs += ElapsedMs(pipelineStart, std::chrono::high_resolution_clock::now());
+    vkDestroyShaderModule(mDevice, cullCS, nullptr);
+
+    // 每帧自己的命令和数量Buffer，在飞的帧之间不会互相覆盖
+    // 两个阶段的命令布局相同，一个物体最多在其中一个阶段里被绘制
+    const VkDeviceSize commandSize = std::max<size_t>(mGPUObjectCount, 1) * sizeof(VkDrawIndexedIndirectCommand);
+    const VkDeviceSize countSize = std::max<size_t>(mIndirectBatches.size(), 1) * sizeof(uint32_t);
+    const VkDeviceSize occlusionSize = std::max<size_t>(mGPUObjectCount, 1) * sizeof(uint32_t);
     for (auto & frame : mFrames)
     {
-        VK_CHECK(vkCreateFence(mDevice, &fenceCI, nullptr, &frame.mRenderFence));
-        mMainDeletionQueue.PushFunction([=]()
+        frame.mOcclusionBuffer = CreateBuffer(occlusionSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MemoryClass::DeviceLocal);
+
+        if (bComputeMeshlets)
         {
-            vkDestroyFence(mDevice, frame.mRenderFence, nullptr);
-        });
+            frame.mMeshletIndexBuffer = CreateBuffer(MESHLET_INDEX_CAPACITY * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, MemoryClass::DeviceLocal);
+            frame.mMeshletIndexCount = CreateBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryClass::DeviceLocal);
+        }
 
-        VK_CHECK(vkCreateSemaphore(mDevice, &semCI, nullptr, &frame.mPresentSem));
-        VK_CHECK(vkCreateSemaphore(mDevice, &semCI, nullptr, &frame.mRenderSem));
+        VkCommandBufferAllocateInfo indirectCmdAI = VKInit::CmdBufferAllocateInfo(frame.mWorkerCmdPools[0], CULL_PHASE_COUNT, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+        VK_CHECK(vkAllocateCommandBuffers(mDevice, &indirectCmdAI, frame.mIndirectCmdBuffers));
 
-        mMainDeletionQueue.PushFunction([=]()
+        for (uint32_t phase = 0; phase < CULL_PHASE_COUNT; phase++)
         {
-            vkDestroySemaphore(mDevice, frame.mPresentSem, nullptr);
-            vkDestroySemaphore(mDevice, frame.mRenderSem, nullptr);
-        });
+            frame.mDrawCommandBuffers[phase] = CreateBuffer(commandSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, MemoryClass::DeviceLocal);
+            frame.mDrawCountBuffers[phase] = CreateBuffer(countSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryClass::DeviceLocal);
+
+            // 按绑定号排列，从binding 7开始的Buffer在按物体剔除时只有LOD表
+            std::vector<DescriptorInfo> cullInfos {
+                DescriptorInfo(mGPUObjectBuffer.mBuffer, 0, VK_WHOLE_SIZE),
+                DescriptorInfo(mGPUObjectInfoBuffer.mBuffer, 0, VK_WHOLE_SIZE),
+                DescriptorInfo(frame.mDrawCommandBuffers[phase].mBuffer, 0, VK_WHOLE_SIZE),
+                DescriptorInfo(frame.mDrawCountBuffers[phase].mBuffer, 0, VK_WHOLE_SIZE),
+                DescriptorInfo(frame.mOcclusionBuffer.mBuffer, 0, VK_WHOLE_SIZE),
+                DescriptorInfo(mDepthPyramidSampler, mDepthPyramidView, VK_IMAGE_LAYOUT_GENERAL),
+                DescriptorInfo(frame.mTransientBuffer.mBuffer.mBuffer, 0, sizeof(GPUCullData))
+            };
+            if (bComputeMeshlets)
+            {
+                cullInfos.emplace_back(mMeshletBuffer.mBuffer, 0, VK_WHOLE_SIZE);
+                cullInfos.emplace_back(mMeshletVertexBuffer.mBuffer, 0, VK_WHOLE_SIZE);
+                cullInfos.emplace_back(mMeshletTriangleBuffer.mBuffer, 0, VK_WHOLE_SIZE);
+                cullInfos.emplace_back(frame.mMeshletIndexBuffer.mBuffer, 0, VK_WHOLE_SIZE);
+                cullInfos.emplace_back(frame.mMeshletIndexCount.mBuffer, 0, VK_WHOLE_SIZE);
+            }
+            else
+            {
+                cullInfos.emplace_back(mGPULodBuffer.mBuffer, 0, VK_WHOLE_SIZE);
+            }
+            frame.mCullDescSets[phase] = mDescSetCache.Get(mCullDescSetLayout, cullInfos.data());
+        }
+    }
+
+    if (mbMeshShading)
+    {
+        initMeshletDescriptors();
     }
-    VkFenceCreateInfo uploadFenceCI = VKInit::FenceCreateInfo();
-    VK_CHECK(vkCreateFence(mDevice, &uploadFenceCI, nullptr, &mUploadContext.mUploadFence));
+
+    std::cout << "GPU driven: " << mGPUObjectCount << " objects in " << mIndirectBatches.size() << " batches"
+        << (mConfig.mbOcclusionCulling ? ", occlusion culling" : "") << std::endl;
+
     mMainDeletionQueue.PushFunction([=]()
     {
-        vkDestroyFence(mDevice, mUploadContext.mUploadFence, nullptr);
+        for (auto & frame : mFrames)
+        {
+            for (uint32_t phase = 0; phase < CULL_PHASE_COUNT; phase++)
+            {
+                vmaDestroyBuffer(mAllocator, frame.mDrawCommandBuffers[phase].mBuffer, frame.mDrawCommandBuffers[phase].mAllocation);
+                vmaDestroyBuffer(mAllocator, frame.mDrawCountBuffers[phase].mBuffer, frame.mDrawCountBuffers[phase].mAllocation);
+            }
+            vmaDestroyBuffer(mAllocator, frame.mOcclusionBuffer.mBuffer, frame.mOcclusionBuffer.mAllocation);
+            if (bComputeMeshlets)
+            {
+                vmaDestroyBuffer(mAllocator, frame.mMeshletIndexBuffer.mBuffer, frame.mMeshletIndexBuffer.mAllocation);
+                vmaDestroyBuffer(mAllocator, frame.mMeshletIndexCount.mBuffer, frame.mMeshletIndexCount.mAllocation);
+            }
+        }
+        vmaDestroyBuffer(mAllocator, mGPUObjectBuffer.mBuffer, mGPUObjectBuffer.mAllocation);
+        vmaDestroyBuffer(mAllocator, mGPUObjectInfoBuffer.mBuffer, mGPUObjectInfoBuffer.mAllocation);
+        vmaDestroyBuffer(mAllocator, mGPULodBuffer.mBuffer, mGPULodBuffer.mAllocation);
+
+        vkDestroyPipeline(mDevice, mCullPipeline, nullptr);
+        vkDestroyPipelineLayout(mDevice, mCullPipelineLayout, nullptr);
     });
 }
 
-void VulkanEngine::initDescriptors()
+void VulkanEngine::initMeshlets(const std::vector<uint32_t>& order, std::vector<GPUObjectInfo>& infos)
+{
+    ZoneScoped;
+    // 同一个网格的Meshlet只存一份，局部顶点换成GeometryBuffer块里的绝对下标，剔除后的索引不需要vertexOffset
+    std::vector<Assets::Meshlet> meshlets;
+    std::vector<uint32_t> meshletVertices;
+    std::vector<uint32_t> meshletTriangles;
+    std::unordered_map<const Mesh*, uint32_t> meshletOffsets;
+    for (uint32_t i = 0; i < infos.size(); i++)
+    {
+        const Mesh* mesh = mRenderScenes[order[i]].mMesh;
+        auto [it, bInserted] = meshletOffsets.try_emplace(mesh, (uint32_t)meshlets.size());
+        if (bInserted)
+        {
+            const uint32_t vertexBase = (uint32_t)meshletVertices.size();
+            const uint32_t triangleBase = (uint32_t)meshletTriangles.size();
+            for (Assets::Meshlet meshlet : mesh->mMeshlets.mMeshlets)
+            {
+                meshlet.mVertexOffset += vertexBase;
+                meshlet.mTriangleOffset += triangleBase;
+                meshlets.push_back(meshlet);
+            }
+            for (uint32_t vertex : mesh->mMeshlets.mVertices)
+            {
+                meshletVertices.push_back(vertex + mesh->mGeometry.mFirstVertex);
+            }
+            meshletTriangles.insert(meshletTriangles.end(), mesh->mMeshlets.mTriangles.begin(), mesh->mMeshlets.mTriangles.end());
+        }
+        infos[i].mMeshletOffset = it->second;
+        infos[i].mMeshletCount = (uint32_t)mesh->mMeshlets.mMeshlets.size();
+    }
+
+    // Mesh Shader路径没有逐物体的Compute剔除，每个批次展开成物体的所有Meshlet，一个Task线程处理一个
+    std::vector<glm::uvec2> entries;
+    if (mbMeshShading)
+    {
+        for (IndirectBatch& batch : mIndirectBatches)
+        {
+            batch.mFirstEntry = (uint32_t)entries.size();
+            for (uint32_t object = batch.mFirstCommand; object < batch.mFirstCommand + batch.mMaxCount; object++)
+            {
+                for (uint32_t m = 0; m < infos[object].mMeshletCount; m++)
+                {
+                    entries.push_back(glm::uvec2(object, infos[object].mMeshletOffset + m));
+                }
+            }
+            batch.mEntryCount = (uint32_t)entries.size() - batch.mFirstEntry;
+        }
+    }
+    mMeshletCount = (uint32_t)meshlets.size();
+    mMeshletEntryCount = (uint32_t)entries.size();
+
+    const VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    mMeshletBuffer = CreateBuffer(std::max<size_t>(meshlets.size(), 1) * sizeof(Assets::Meshlet), usage, MemoryClass::DeviceLocal);
+    mMeshletVertexBuffer = CreateBuffer(std::max<size_t>(meshletVertices.size(), 1) * sizeof(uint32_t), usage, MemoryClass::DeviceLocal);
+    mMeshletTriangleBuffer = CreateBuffer(std::max<size_t>(meshletTriangles.size(), 1) * sizeof(uint32_t), usage, MemoryClass::DeviceLocal);
+    mMeshletEntryBuffer = CreateBuffer(std::max<size_t>(entries.size(), 1) * sizeof(glm::uvec2), usage, MemoryClass::DeviceLocal);
+
+    const VkPipelineStageFlags2 dstStages = mbMeshShading
+        ? VK_PIPELINE_STAGE_2_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT
+        : VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    if (!meshlets.empty())
+    {
+        mUploadEngine.UploadBuffer(mMeshletBuffer.mBuffer, 0, meshlets.data(), meshlets.size() * sizeof(Assets::Meshlet), dstStages, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+        mUploadEngine.UploadBuffer(mMeshletVertexBuffer.mBuffer, 0, meshletVertices.data(), meshletVertices.size() * sizeof(uint32_t), dstStages, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+        mUploadEngine.UploadBuffer(mMeshletTriangleBuffer.mBuffer, 0, meshletTriangles.data(), meshletTriangles.size() * sizeof(uint32_t), dstStages, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+    }
+    if (!entries.empty())
+    {
+        mUploadEngine.UploadBuffer(mMeshletEntryBuffer.mBuffer, 0, entries.data(), entries.size() * sizeof(glm::uvec2), dstStages, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+    }
+
+    std::cout << "Meshlets: " << mMeshletCount << " unique, " << meshletTriangles.size() << " triangles";
+    if (mbMeshShading)
+    {
+        std::cout << ", " << mMeshletEntryCount << " instances";
+    }
+    std::cout << std::endl;
+
+    mMainDeletionQueue.PushFunction([=]()
+    {
+        vmaDestroyBuffer(mAllocator, mMeshletBuffer.mBuffer, mMeshletBuffer.mAllocation);
+        vmaDestroyBuffer(mAllocator, mMeshletVertexBuffer.mBuffer, mMeshletVertexBuffer.mAllocation);
+        vmaDestroyBuffer(mAllocator, mMeshletTriangleBuffer.mBuffer, mMeshletTriangleBuffer.mAllocation);
+        vmaDestroyBuffer(mAllocator, mMeshletEntryBuffer.mBuffer, mMeshletEntryBuffer.mAllocation);
+    });
+}
+
+void VulkanEngine::initMeshletDescriptors()
+{
+    ZoneScoped;
+    // 顶点流按GeometryBuffer分块，每帧每块一个描述符集，块数在加载完网格后才确定
+    const uint32_t blockCount = mGeometryBuffer.GetBlockCount();
+
+    const VkDeviceSize occlusionSize = std::max<size_t>(mMeshletEntryCount, 1) * sizeof(uint32_t);
+    for (auto & frame : mFrames)
+    {
+        frame.mMeshletOcclusionBuffer = CreateBuffer(occlusionSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MemoryClass::DeviceLocal);
+        frame.mMeshletDescSets.resize(blockCount);
+
+        for (uint32_t block = 0; block < blockCount; block++)
+        {
+            std::array<DescriptorInfo, 10> infos {
+                DescriptorInfo(mMeshletBuffer.mBuffer, 0, VK_WHOLE_SIZE),
+                DescriptorInfo(mMeshletVertexBuffer.mBuffer, 0, VK_WHOLE_SIZE),
+                DescriptorInfo(mMeshletTriangleBuffer.mBuffer, 0, VK_WHOLE_SIZE),
+                DescriptorInfo(mGeometryBuffer.GetVertexBuffer(block, VERTEX_STREAM_POSITION), 0, VK_WHOLE_SIZE),
+                DescriptorInfo(mGeometryBuffer.GetVertexBuffer(block, VERTEX_STREAM_ATTRIBUTES), 0, VK_WHOLE_SIZE),
+                DescriptorInfo(mMeshletEntryBuffer.mBuffer, 0, VK_WHOLE_SIZE),
+                DescriptorInfo(mGPUObjectBuffer.mBuffer, 0, VK_WHOLE_SIZE),
+                DescriptorInfo(frame.mMeshletOcclusionBuffer.mBuffer, 0, VK_WHOLE_SIZE),
+                DescriptorInfo(mDepthPyramidSampler, mDepthPyramidView, VK_IMAGE_LAYOUT_GENERAL),
+                DescriptorInfo(frame.mTransientBuffer.mBuffer.mBuffer, 0, sizeof(GPUCullData))
+            };
+            frame.mMeshletDescSets[block] = mDescSetCache.Get(mMeshletDescSetLayout, infos.data());
+        }
+    }
+
+    mMainDeletionQueue.PushFunction([=]()
+    {
+        for (auto & frame : mFrames)
+        {
+            vmaDestroyBuffer(mAllocator, frame.mMeshletOcclusionBuffer.mBuffer, frame.mMeshletOcclusionBuffer.mAllocation);
+        }
+    });
+}
+
+void VulkanEngine::initDepthPyramid()
 {
-    std::vector<VkDescriptorPoolSize> descPoolSize = {
-        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 10},
-        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 10},
-        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 10}
+    ZoneScoped;
+    // 边长取不超过窗口的2的幂，每一级正好是上一级的一半
+    auto previousPow2 = [](uint32_t v)
+    {
+        uint32_t r = 1;
+        while (r * 2 <= v) r *= 2;
+        return r;
     };
+    mDepthPyramidExtent = { previousPow2(mWndExtent.width), previousPow2(mWndExtent.height) };
+    uint32_t mipCount = 1;
+    while ((std::max(mDepthPyramidExtent.width, mDepthPyramidExtent.height) >> mipCount) > 0) mipCount++;
+    mipCount = std::min(mipCount, MAX_PYRAMID_LEVELS);
 
-    VkDescriptorPoolCreateInfo descPoolCI {};
-    descPoolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    descPoolCI.flags = 0;
-    descPoolCI.maxSets = 10;
-    descPoolCI.poolSizeCount = (uint32_t)descPoolSize.size();
-    descPoolCI.pPoolSizes = descPoolSize.data();
+    VkImageCreateInfo pyramidCI = VKInit::ImageCreateInfo(VK_FORMAT_R32_SFLOAT,
+        VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT, { mDepthPyramidExtent.width, mDepthPyramidExtent.height, 1 });
+    pyramidCI.mipLevels = mipCount;
 
-    vkCreateDescriptorPool(mDevice, &descPoolCI, nullptr, &mDescPool);
+    VmaAllocationCreateInfo pyramidAI {};
+    pyramidAI.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    VK_CHECK(vmaCreateImage(mAllocator, &pyramidCI, &pyramidAI, &mDepthPyramid.mImage, &mDepthPyramid.mAllocation, nullptr));
 
-    std::array<VkDescriptorSetLayoutBinding, 2> descBindings {
-        VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0),
-        VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 1)
+    VkImageViewCreateInfo pyramidViewCI = VKInit::ImageViewCreateInfo(VK_FORMAT_R32_SFLOAT, mDepthPyramid.mImage, VK_IMAGE_ASPECT_COLOR_BIT);
+    pyramidViewCI.subresourceRange.levelCount = mipCount;
+    VK_CHECK(vkCreateImageView(mDevice, &pyramidViewCI, nullptr, &mDepthPyramidView));
+
+    mDepthPyramidMips.resize(mipCount);
+    for (uint32_t i = 0; i < mipCount; i++)
+    {
+        VkImageViewCreateInfo mipViewCI = VKInit::ImageViewCreateInfo(VK_FORMAT_R32_SFLOAT, mDepthPyramid.mImage, VK_IMAGE_ASPECT_COLOR_BIT);
+        mipViewCI.subresourceRange.baseMipLevel = i;
+        mipViewCI.subresourceRange.levelCount = 1;
+        VK_CHECK(vkCreateImageView(mDevice, &mipViewCI, nullptr, &mDepthPyramidMips[i]));
+    }
+
+    // MAX归约的线性采样返回2x2里最远的深度，不支持时只做视锥体剔除，这个采样器不会被用到
+    VkSamplerReductionModeCreateInfo reductionCI {};
+    reductionCI.sType = VK_STRUCTURE_TYPE_SAMPLER_REDUCTION_MODE_CREATE_INFO;
+    reductionCI.reductionMode = VK_SAMPLER_REDUCTION_MODE_MAX;
+
+    VkSamplerCreateInfo samplerCI = VKInit::SamplerCreateInfo(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+    samplerCI.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerCI.minLod = 0.0f;
+    samplerCI.maxLod = (float)mipCount;
+    samplerCI.pNext = mConfig.mbOcclusionCulling ? &reductionCI : nullptr;
+    VK_CHECK(vkCreateSampler(mDevice, &samplerCI, nullptr, &mDepthPyramidSampler));
+
+    // 降采样的Pipeline，每一级一个描述符集：第0级读深度图，之后读上一级
+    std::array<VkDescriptorSetLayoutBinding, 2> pyramidBindings {
+        VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+        VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 1)
     };
+    mDepthPyramidDescSetLayout = mDescLayoutCache.CreateLayout(pyramidBindings.data(), static_cast<uint32_t>(pyramidBindings.size()));
+
+    VkPushConstantRange pyramidPushConstant {};
+    pyramidPushConstant.offset = 0;
+    pyramidPushConstant.size = sizeof(GPUDepthPyramidParams);
+    pyramidPushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkPipelineLayoutCreateInfo pyramidPipelineLayoutCI = VKInit::PipelineLayoutCreateInfo();
+    pyramidPipelineLayoutCI.setLayoutCount = 1;
+    pyramidPipelineLayoutCI.pSetLayouts = &mDepthPyramidDescSetLayout;
+    pyramidPipelineLayoutCI.pushConstantRangeCount = 1;
+    pyramidPipelineLayoutCI.pPushConstantRanges = &pyramidPushConstant;
+    VK_CHECK(vkCreatePipelineLayout(mDevice, &pyramidPipelineLayoutCI, nullptr, &mDepthPyramidPipelineLayout));
+
+    VkShaderModule pyramidCS;
+    if (!loadShaderModule("../../Assets/Shaders/DepthPyramid.comp.spv", &pyramidCS))
+    {
+        std::cerr << "Error when building shader" << std::endl;
+    }
 
-    VkDescriptorSetLayoutCreateInfo descSetLayoutCI {};
-    descSetLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    descSetLayoutCI.flags = 0;
-    descSetLayoutCI.pNext = nullptr;
-    descSetLayoutCI.bindingCount = static_cast<uint32_t>(descBindings.size());
-    descSetLayoutCI.pBindings = descBindings.data();
-    vkCreateDescriptorSetLayout(mDevice, &descSetLayoutCI, nullptr, &mGlobalDescSetLayout);
+    VkComputePipelineCreateInfo pyramidPipelineCI {};
+    pyramidPipelineCI.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pyramidPipelineCI.pNext = nullptr;
+    pyramidPipelineCI.stage = VKInit::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, pyramidCS);
+    pyramidPipelineCI.layout = mDepthPyramidPipelineLayout;
+    auto pipelineStart = std::chrono::high_resolution_clock::now();
+    VK_CHECK(vkCreateComputePipelines(mDevice, mPipelineCache.GetCache(), 1, &pyramidPipelineCI, nullptr, &mDepthPyramidPipeline));
+    mPipelineCreateMs += ElapsedMs(pipelineStart, std::chrono::high_resolution_clock::now());
+    vkDestroyShaderModule(mDevice, pyramidCS, nullptr);
+
+    // 深度图由RenderGraph分配，Compile之后View就不再变化
+    mDepthPyramidDescSets.resize(mipCount);
+    for (uint32_t i = 0; i < mipCount; i++)
+    {
+        std::array<DescriptorInfo, 2> pyramidInfos {
+            DescriptorInfo(mDepthPyramidSampler,
+                i == 0 ? mRenderGraph.GetImageView(mDepthTarget) : mDepthPyramidMips[i - 1],
+                i == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL),
+            DescriptorInfo(VK_NULL_HANDLE, mDepthPyramidMips[i], VK_IMAGE_LAYOUT_GENERAL)
+        };
+        mDepthPyramidDescSets[i] = mDescSetCache.Get(mDepthPyramidDescSetLayout, pyramidInfos.data());
+    }
 
-    VkDescriptorSetLayoutBinding sceneBind = VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0);
-    descSetLayoutCI.bindingCount = 1;
-    descSetLayoutCI.pBindings = &sceneBind;
-    vkCreateDescriptorSetLayout(mDevice, &descSetLayoutCI, nullptr, &mSceneDescSetLayout);
+    mMainDeletionQueue.PushFunction([=]()
+    {
+        vkDestroyPipeline(mDevice, mDepthPyramidPipeline, nullptr);
+        vkDestroyPipelineLayout(mDevice, mDepthPyramidPipelineLayout, nullptr);
+        vkDestroySampler(mDevice, mDepthPyramidSampler, nullptr);
+        for (auto view : mDepthPyramidMips)
+        {
+            vkDestroyImageView(mDevice, view, nullptr);
+        }
+        vkDestroyImageView(mDevice, mDepthPyramidView, nullptr);
+        vmaDestroyImage(mAllocator, mDepthPyramid.mImage, mDepthPyramid.mAllocation);
+    });
+}
 
-    VkDescriptorSetLayoutBinding texBind = VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0);
-    descSetLayoutCI.bindingCount = 1;
-    descSetLayoutCI.pBindings = &texBind;
-    vkCreateDescriptorSetLayout(mDevice, &descSetLayoutCI, nullptr, &mTextureDescSetLayout);
+void VulkanEngine::initCulling()
+{
+    ZoneScoped;
+    // 场景里的物体都是静态的，世界空间的包围体只需要算一次
+    mCuller.Clear();
+    mCuller.Reserve(mRenderScenes.size());
+    for (auto & scene : mRenderScenes)
+    {
+        const Assets::MeshBounds& bounds = scene.mMesh->mBounds;
+        mCuller.Add(glm::make_vec3(bounds.mOrigin), bounds.mRadius, glm::make_vec3(bounds.mExtents), scene.mTransform);
+    }
+    mVisibleObjects.resize(mRenderScenes.size());
+}
+
+void VulkanEngine::initResidency()
+{
+    ZoneScoped;
+    mResidency.Init(mAllocator, (VkDeviceSize)mConfig.mMemoryBudgetMB * 1024 * 1024, mbMemoryBudget, (uint32_t)mFrames.size());
+
+    // GPU Driven的物体数据里记下了网格在GeometryBuffer里的位置，不能移动，全部固定，只有CPU路径会驱逐
+    const bool bPinned = mConfig.mbGPUDriven;
+    if (bPinned && mConfig.mMemoryBudgetMB > 0)
+    {
+        std::cout << "Memory budget is ignored in GPU driven mode, all meshes and textures stay resident" << std::endl;
+    }
+    for (auto& it : mMeshes)
+    {
+        Mesh& mesh = it.second;
+        if (mesh.mVertices.empty()) continue;
+
+        VkDeviceSize size = mesh.mVertices.size() * (sizeof(VertexPosition) + sizeof(VertexAttributes))
+            + (VkDeviceSize)mesh.mIndices.size() * GeometryBuffer::GetIndexSize(mesh.GetIndexType());
+        mesh.mResidency = mResidency.Register(ResidentType::Mesh, &mesh, size, bPinned);
+    }
+    for (auto& it : mTextures)
+    {
+        Texture& texture = it.second;
+        // 按VMA实际分配的大小计算，包括对齐和驱动要求的填充
+        VmaAllocationInfo allocInfo {};
+        vmaGetAllocationInfo(mAllocator, texture.mImage.mAllocation, &allocInfo);
+        texture.mResidency = mResidency.Register(ResidentType::Texture, &texture, allocInfo.size, bPinned);
+    }
+}
+
+void VulkanEngine::initUploadEngine()
+{
+    ZoneScoped;
+    mUploadEngine.Init(mDevice, &mBufferAllocator, mTransferQueue, mTransferQueueFamily, mGraphicsQueueFamily, UPLOAD_STAGING_SIZE);
+    mMainDeletionQueue.PushFunction([=]()
+    {
+        std::cout << "Uploaded " << mUploadEngine.mBytesUploaded / 1024 << " KB in "
+            << mUploadEngine.mCopyCount << " copies, " << mUploadEngine.mSubmitCount << " submits" << std::endl;
+        mUploadEngine.Destroy();
+    });
+}
 
-    const size_t sceneParamsBufferSize = FRAME_OVERLAP * PadUniformBufferSize(sizeof(UniformData));
-    mUniformBuffer = CreateBuffer(sceneParamsBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+void VulkanEngine::initGeometryBuffer()
+{
+    ZoneScoped;
+    mGeometryBuffer.Init(&mBufferAllocator, VERTEX_STREAM_STRIDES, VERTEX_STREAM_COUNT, GEOMETRY_BLOCK_VERTICES, GEOMETRY_BLOCK_INDEX_SIZE);
+    mMainDeletionQueue.PushFunction([=]()
+    {
+        mGeometryBuffer.PrintStats();
+        mGeometryBuffer.Destroy();
+    });
+}
+
+void VulkanEngine::initSyncObjects()
+{
+    ZoneScoped;
+    mGraphicsTimeline.Init(mDevice, mGraphicsQueue, mGraphicsQueueFamily);
+    mMainDeletionQueue.PushFunction([=]()
+    {
+        mGraphicsTimeline.Destroy();
+    });
+
+    VkSemaphoreCreateInfo semCI = VKInit::SemaphoreCreateInfo();
+    VkQueryPoolCreateInfo queryPoolCI = VKInit::QueryPoolCreateInfo(VK_QUERY_TYPE_TIMESTAMP, 2);
 
     for (auto & frame : mFrames)
     {
-        frame.mCameraBuffer = CreateBuffer(sizeof(GPUCameraData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-
-        const int MAX_OBJECTS = 10000;
-        frame.mSceneBuffer = CreateBuffer(sizeof(GPUObjectData) * MAX_OBJECTS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-
-        VkDescriptorSetAllocateInfo globalDescSetAI{};
-        globalDescSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        globalDescSetAI.pNext = nullptr;
-        globalDescSetAI.descriptorPool = mDescPool;
-        globalDescSetAI.descriptorSetCount = 1;
-        globalDescSetAI.pSetLayouts = &mGlobalDescSetLayout;
-        vkAllocateDescriptorSets(mDevice, &globalDescSetAI, &frame.mGlobalDescSet);
-
-        VkDescriptorSetAllocateInfo sceneDescSetAI{};
-        sceneDescSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        sceneDescSetAI.pNext = nullptr;
-        sceneDescSetAI.descriptorPool = mDescPool;
-        sceneDescSetAI.descriptorSetCount = 1;
-        sceneDescSetAI.pSetLayouts = &mSceneDescSetLayout;
-        vkAllocateDescriptorSets(mDevice, &sceneDescSetAI, &frame.mSceneDescSet);
-
-        VkDescriptorBufferInfo cameraInfo{};
-        cameraInfo.buffer = frame.mCameraBuffer.mBuffer;
-        cameraInfo.offset = 0;
-        cameraInfo.range = sizeof(GPUCameraData);
-
-        VkDescriptorBufferInfo uniformInfo{};
-        uniformInfo.buffer = mUniformBuffer.mBuffer;
-        uniformInfo.offset = 0;
-        uniformInfo.range = sizeof(UniformData);
-
-        VkDescriptorBufferInfo objectInfo{};
-        objectInfo.buffer = frame.mSceneBuffer.mBuffer;
-        objectInfo.offset = 0;
-        objectInfo.range = sizeof(GPUObjectData) * MAX_OBJECTS;
-
-        std::array<VkWriteDescriptorSet, 3> writeDescSets = {
-            VKInit::WriteDesc(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frame.mGlobalDescSet, nullptr, &cameraInfo, 0),
-            VKInit::WriteDesc(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, frame.mGlobalDescSet, nullptr, &uniformInfo, 1),
-            VKInit::WriteDesc(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.mSceneDescSet, nullptr, &objectInfo, 0),
+        VK_CHECK(vkCreateSemaphore(mDevice, &semCI, nullptr, &frame.mPresentSem));
+        VK_CHECK(vkCreateSemaphore(mDevice, &semCI, nullptr, &frame.mRenderSem));
+        if (mbGPUTimestamps)
+        {
+            VK_CHECK(vkCreateQueryPool(mDevice, &queryPoolCI, nullptr, &frame.mTimestampPool));
+        }
+
+        mMainDeletionQueue.PushFunction([=]()
+        {
+            vkDestroySemaphore(mDevice, frame.mPresentSem, nullptr);
+            vkDestroySemaphore(mDevice, frame.mRenderSem, nullptr);
+            if (frame.mTimestampPool != VK_NULL_HANDLE)
+            {
+                vkDestroyQueryPool(mDevice, frame.mTimestampPool, nullptr);
+            }
+        });
+    }
+}
+
+void VulkanEngine::initDescriptors()
+{
+    ZoneScoped;
+    // Pool用完时自动新建，材质再多也不会分配失败
+    mDescAllocator.Init(mDevice, 64);
+    mDescLayoutCache.Init(mDevice);
+    mDescSetCache.Init(&mDescAllocator, &mDescLayoutCache);
+
+    std::array<VkDescriptorSetLayoutBinding, 2> descBindings {
+        VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT, 0),
+        VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 1)
+    };
+    mGlobalDescSetLayout = mDescLayoutCache.CreateLayout(descBindings.data(), static_cast<uint32_t>(descBindings.size()));
+
+    VkDescriptorSetLayoutBinding sceneBind = VKInit::DescSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT, 0);
+    mSceneDescSetLayout = mDescLayoutCache.CreateLayout(&sceneBind, 1);
+
+    // 组合图片采样器同时占用采样器和图片的UPDATE_AFTER_BIND上限
+    VkPhysicalDeviceVulkan12Properties props12 {};
+    props12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+    VkPhysicalDeviceProperties2 props2 {};
+    props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    props2.pNext = &props12;
+    vkGetPhysicalDeviceProperties2(mGPU, &props2);
+    uint32_t bindlessCapacity = std::min({ MAX_BINDLESS_TEXTURES,
+        props12.maxPerStageDescriptorUpdateAfterBindSamplers, props12.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        props12.maxDescriptorSetUpdateAfterBindSamplers, props12.maxDescriptorSetUpdateAfterBindSampledImages });
+    mBindless.Init(mDevice, mDescLayoutCache, bindlessCapacity);
+
+    // 同一个Buffer既做UBO也做SSBO，分配的对齐取两者的最大值
+    size_t transientAlignment = std::max(
+        mGPUProps.limits.minUniformBufferOffsetAlignment,
+        mGPUProps.limits.minStorageBufferOffsetAlignment);
+    const size_t objectRange = sizeof(GPUObjectData) * MAX_OBJECTS;
+
+    for (auto & frame : mFrames)
+    {
+        frame.mTransientBuffer.Init(
+            mBufferAllocator, FRAME_TRANSIENT_SIZE, objectRange, transientAlignment,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+        // 三个描述符都指向同一个Buffer的起始位置，实际位置由绑定时的动态偏移决定
+        VkBuffer transientBuffer = frame.mTransientBuffer.mBuffer.mBuffer;
+        std::array<DescriptorInfo, 2> globalInfos {
+            DescriptorInfo(transientBuffer, 0, sizeof(GPUCameraData)),
+            DescriptorInfo(transientBuffer, 0, sizeof(UniformData))
         };
-        vkUpdateDescriptorSets(mDevice, static_cast<uint32_t>(writeDescSets.size()), writeDescSets.data(), 0, nullptr);
+        DescriptorInfo objectInfo(transientBuffer, 0, objectRange);
+        frame.mGlobalDescSet = mDescSetCache.Get(mGlobalDescSetLayout, globalInfos.data());
+        frame.mSceneDescSet = mDescSetCache.Get(mSceneDescSetLayout, &objectInfo);
     }
 
+    // 所有描述符集和布局都在这里销毁，使用它们的Pipeline在这之前已经销毁
     mMainDeletionQueue.PushFunction([&]()
     {
-        vmaDestroyBuffer(mAllocator, mUniformBuffer.mBuffer, mUniformBuffer.mAllocation);
-        vkDestroyDescriptorSetLayout(mDevice, mSceneDescSetLayout, nullptr);
-        vkDestroyDescriptorSetLayout(mDevice, mGlobalDescSetLayout, nullptr);
-        vkDestroyDescriptorSetLayout(mDevice, mTextureDescSetLayout, nullptr);
-
-        vkDestroyDescriptorPool(mDevice, mDescPool, nullptr);
+        std::cout << "Descriptors: " << mDescAllocator.mAllocatedSets << " sets in " << mDescAllocator.GetPoolCount() << " pools, "
+            << mDescSetCache.GetSetCount() << " cached sets for " << mDescSetCache.mRequests << " requests, "
+            << mDescLayoutCache.GetLayoutCount() << " layouts for " << mDescLayoutCache.mRequests << " requests, "
+            << mBindless.GetTextureCount() << "/" << mBindless.GetCapacity() << " bindless textures, " << mBindless.mTextureWrites << " texture writes" << std::endl;
+        mBindless.Destroy();
+        mDescSetCache.Destroy();
+        mDescAllocator.Destroy();
+        mDescLayoutCache.Destroy();
 
         for (auto & frame : mFrames)
         {
-            vmaDestroyBuffer(mAllocator, frame.mCameraBuffer.mBuffer, frame.mCameraBuffer.mAllocation);
-            vmaDestroyBuffer(mAllocator, frame.mSceneBuffer.mBuffer, frame.mSceneBuffer.mAllocation);
+            frame.mTransientBuffer.Destroy(mBufferAllocator);
         }
     });
 }
@@ -785,6 +2011,7 @@ bool VulkanEngine::loadShaderModule(const char *filepath, VkShaderModule *outSha
 
 void VulkanEngine::loadMeshes()
 {
+    ZoneScoped;
     Mesh triMesh{}, objMesh{}, empireMesh{};
     //make the array 3 vertices long
     triMesh.mVertices.resize(3);
@@ -811,66 +2038,76 @@ void VulkanEngine::loadMeshes()
     mMeshes["Empire"] = empireMesh;
 }
 
-void VulkanEngine::uploadMesh(Mesh& mesh)
+UploadHandle VulkanEngine::uploadMesh(Mesh& mesh)
 {
-    const size_t bufferSize = mesh.mVertices.size() * sizeof(Vertex);
-
-    VkBufferCreateInfo stagingBufferCI {};
-    stagingBufferCI.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    stagingBufferCI.pNext = nullptr;
-    stagingBufferCI.size = bufferSize;
-    stagingBufferCI.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-
-    VmaAllocationCreateInfo vmaAllocCI = {};
-    vmaAllocCI.usage = VMA_MEMORY_USAGE_CPU_ONLY;
-
-    AllocatedBuffer stagingBuffer{};
-
-    VK_CHECK(vmaCreateBuffer(
-        mAllocator, &stagingBufferCI, &vmaAllocCI,
-        &stagingBuffer.mBuffer,
-        &stagingBuffer.mAllocation,
-        nullptr));
-
-    //copy vertex data
-    void* data;
-    vmaMapMemory(mAllocator, stagingBuffer.mAllocation, &data);
-    memcpy(data, mesh.mVertices.data(), bufferSize);
-    vmaUnmapMemory(mAllocator, stagingBuffer.mAllocation);
-
-    //allocate vertex buffer
-    VkBufferCreateInfo vertexBufferInfo = {};
-    vertexBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    vertexBufferInfo.pNext = nullptr;
-    vertexBufferInfo.size = bufferSize;
-    vertexBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-
-    //let the VMA library know that this data should be writeable by CPU, but also readable by GPU
-    vmaAllocCI.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-
-    //allocate the buffer
-    VK_CHECK(vmaCreateBuffer(
-        mAllocator, &vertexBufferInfo, &vmaAllocCI,
-        &mesh.mVertexBuffer.mBuffer,
-        &mesh.mVertexBuffer.mAllocation,
-        nullptr));
-
-    //add the destruction of triangle mesh buffer to the deletion queue
-    mMainDeletionQueue.PushFunction([=]()
+    ZoneScoped;
+    mesh.mID = mNextMeshID++;
+    // 排序Key的网格字段要放下这个网格的所有LOD
+    if ((uint64_t)mNextMeshID * Assets::MESH_MAX_LODS > DRAW_KEY_MAX_MESHES)
     {
-        vmaDestroyBuffer(mAllocator, mesh.mVertexBuffer.mBuffer, mesh.mVertexBuffer.mAllocation);
-    });
-
-    ImmediateSubmit([=](VkCommandBuffer cmdBuffer)
+        std::cout << "Too many meshes for the draw key: " << mNextMeshID << ", max " << DRAW_KEY_MAX_MESHES / Assets::MESH_MAX_LODS << std::endl;
+        abort();
+    }
+    // 手动填写的三角形列表也合并成带索引的
+    mesh.Weld();
+    mesh.CalculateBounds();
+    if (mConfig.mbMeshlets)
     {
-        VkBufferCopy copy{};
-        copy.dstOffset = 0;
-        copy.srcOffset = 0;
-        copy.size = bufferSize;
-        vkCmdCopyBuffer(cmdBuffer, stagingBuffer.mBuffer, mesh.mVertexBuffer.mBuffer, 1, &copy);
-    });
+        mesh.BuildMeshlets();
+    }
+    // 简化后的LOD接在原始索引后面，和它一起分配和上传
+    if (mConfig.mLodPixelError > 0.0f)
+    {
+        mesh.BuildLods();
+    }
+    else
+    {
+        mesh.SetSingleLod();
+    }
+    return uploadGeometry(mesh);
+}
 
-    vmaDestroyBuffer(mAllocator, stagingBuffer.mBuffer, stagingBuffer.mAllocation);
+UploadHandle VulkanEngine::uploadGeometry(Mesh& mesh)
+{
+    ZoneScoped;
+    const VkIndexType indexType = mesh.GetIndexType();
+
+    // 不再给每个网格单独创建Buffer，顶点放进共用的大Buffer里，随GeometryBuffer一起销毁
+    mesh.mGeometry = mGeometryBuffer.Allocate((uint32_t)mesh.mVertices.size(), (uint32_t)mesh.mIndices.size(), indexType);
+    // 加载失败的空网格不需要上传，画出来也是0个顶点
+    if (mesh.mVertices.empty()) return 0;
+
+    // 数据拷贝进Staging后立即返回，第一次绘制前Graphics队列会等待上传完成
+    std::vector<VertexPosition> positions;
+    std::vector<VertexAttributes> attributes;
+    mesh.SplitStreams(positions, attributes);
+    // Mesh Shader把顶点流当作Storage Buffer读取
+    VkPipelineStageFlags2 vertexStages = VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT;
+    VkAccessFlags2 vertexAccess = VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT;
+    if (mbMeshShading)
+    {
+        vertexStages |= VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT;
+        vertexAccess |= VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+    }
+    mUploadEngine.UploadBuffer(
+        mGeometryBuffer.GetVertexBuffer(mesh.mGeometry.mBlock, VERTEX_STREAM_POSITION), mGeometryBuffer.GetVertexOffset(mesh.mGeometry, VERTEX_STREAM_POSITION),
+        positions.data(), positions.size() * sizeof(VertexPosition),
+        vertexStages, vertexAccess);
+    mUploadEngine.UploadBuffer(
+        mGeometryBuffer.GetVertexBuffer(mesh.mGeometry.mBlock, VERTEX_STREAM_ATTRIBUTES), mGeometryBuffer.GetVertexOffset(mesh.mGeometry, VERTEX_STREAM_ATTRIBUTES),
+        attributes.data(), attributes.size() * sizeof(VertexAttributes),
+        vertexStages, vertexAccess);
+
+    VkBuffer indexBuffer = mGeometryBuffer.GetIndexBuffer(mesh.mGeometry.mBlock);
+    const VkDeviceSize indexOffset = mGeometryBuffer.GetIndexOffset(mesh.mGeometry);
+    if (indexType == VK_INDEX_TYPE_UINT16)
+    {
+        std::vector<uint16_t> indices16(mesh.mIndices.begin(), mesh.mIndices.end());
+        return mUploadEngine.UploadBuffer(indexBuffer, indexOffset, indices16.data(), indices16.size() * sizeof(uint16_t),
+            VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT, VK_ACCESS_2_INDEX_READ_BIT);
+    }
+    return mUploadEngine.UploadBuffer(indexBuffer, indexOffset, mesh.mIndices.data(), mesh.mIndices.size() * sizeof(uint32_t),
+        VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT, VK_ACCESS_2_INDEX_READ_BIT);
 }
 
 Material* VulkanEngine::CreateMaterial(VkPipeline pipeline, VkPipelineLayout pipelineLayout, const std::string& name)
@@ -878,6 +2115,15 @@ Material* VulkanEngine::CreateMaterial(VkPipeline pipeline, VkPipelineLayout pip
     Material mat{};
     mat.mPipeline = pipeline;
     mat.mPipelineLayout = pipelineLayout;
+    // 排序Key里用的ID，使用同一个Pipeline的材质共用Pipeline ID
+    mat.mPipelineID = mPipelineIDs.try_emplace(pipeline, (uint32_t)mPipelineIDs.size()).first->second;
+    mat.mID = mNextMaterialID++;
+    if (mPipelineIDs.size() > DRAW_KEY_MAX_PIPELINES || mNextMaterialID > DRAW_KEY_MAX_MATERIALS)
+    {
+        std::cout << "Too many pipelines or materials for the draw key: " << mPipelineIDs.size() << " pipelines, "
+            << mNextMaterialID << " materials" << std::endl;
+        abort();
+    }
     mMaterials[name] = mat;
 
     return &mMaterials[name];
@@ -897,97 +2143,648 @@ Mesh* VulkanEngine::GetMesh(const std::string& name)
     else return &(*it).second;
 }
 
-void VulkanEngine::DrawObjects(VkCommandBuffer cmdBuffer, RenderScene* first, uint32_t count)
+void VulkanEngine::updateCameraData()
 {
     glm::vec3 camPos = {0.0f, -2.0f, -10.0f};
     glm::mat4 view = glm::translate(glm::mat4(1.0f), camPos);
-    glm::mat4 proj = glm::perspective(glm::radians(70.f), (float)mWndExtent.width / (float)mWndExtent.height, 0.1f, 200.0f);
+    glm::mat4 proj = glm::perspective(glm::radians(70.f), (float)mWndExtent.width / (float)mWndExtent.height, CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE);
     proj[1][1] *= -1;
 
-    GPUCameraData camData{};
-    camData.mProj = proj;
-    camData.mView = view;
-    camData.mVP = proj * view;
-
-    void* data;
-    vmaMapMemory(mAllocator, GetCurrentFrame().mCameraBuffer.mAllocation, &data);
-    memcpy(data, &camData, sizeof(GPUCameraData));
-    vmaUnmapMemory(mAllocator, GetCurrentFrame().mCameraBuffer.mAllocation);
+    mPrevCameraData = mCameraData;
+    mCameraData.mProj = proj;
+    mCameraData.mView = view;
+    mCameraData.mVP = proj * view;
+    mCameraPosition = -camPos;
 
     float frameDelta = ((float)mFrameIndex / 120.0f);
 
     mUniformParams.mAmbientColor = { sin(frameDelta), 0, cos(frameDelta), 1};
 
-    char* uniformData;
-    vmaMapMemory(mAllocator, mUniformBuffer.mAllocation, (void**)&uniformData);
-    uint32_t frameIdx = mFrameIndex % FRAME_OVERLAP;
-    uniformData += PadUniformBufferSize(sizeof(UniformData)) * frameIdx;
-    memcpy(uniformData, &mUniformParams, sizeof(UniformData));
-    vmaUnmapMemory(mAllocator, mUniformBuffer.mAllocation);
+    // 动态偏移按binding顺序排列：Camera在binding 0，Scene参数在binding 1
+    RingBuffer& transient = GetCurrentFrame().mTransientBuffer;
+    mGlobalOffsets[0] = transient.Push(mCameraData);
+    mGlobalOffsets[1] = transient.Push(mUniformParams);
+}
+
+void VulkanEngine::cullScene()
+{
+    ZoneScoped;
+    CullView view = CullView::FromMatrices(mCameraData.mVP, mCameraData.mProj, mCameraPosition,
+        (float)mRenderExtent.height, mConfig.mMinPixelSize);
+    mVisibleCount = mCuller.Cull(view, mVisibleObjects.data());
+    mVisibleStats += mVisibleCount;
+}
 
-    void* objectData;
-    vmaMapMemory(mAllocator, GetCurrentFrame().mSceneBuffer.mAllocation, &objectData);
+void VulkanEngine::updateResidency()
+{
+    ZoneScoped;
+    const uint64_t frame = (uint64_t)mFrameIndex;
+    mResidency.BeginFrame(frame);
 
-    auto objectSSBO = (GPUObjectData*)objectData;
-    for (uint32_t i = 0; i < count; i++)
+    // GPU Driven的资源都固定在显存里，不需要标记
+    if (!mConfig.mbGPUDriven)
     {
-        RenderScene& object = first[i];
-        objectSSBO[i].mModelMatrix = object.mTransform;
+        const bool bCulled = mConfig.mbCPUCulling;
+        const uint32_t count = bCulled ? mVisibleCount : (uint32_t)mRenderScenes.size();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const RenderScene& scene = mRenderScenes[bCulled ? mVisibleObjects[i] : i];
+            Mesh* mesh = scene.mMesh;
+            if (mesh->mResidency != RESIDENCY_INVALID_HANDLE && !mResidency.Touch(mesh->mResidency, frame))
+            {
+                uploadGeometry(*mesh);
+                mResidency.SetResident(mesh->mResidency, true);
+            }
+
+            Texture* texture = scene.mMaterial->mTexture;
+            if (texture != nullptr && texture->mResidency != RESIDENCY_INVALID_HANDLE && !mResidency.Touch(texture->mResidency, frame))
+            {
+                // 新的View写回原来的Bindless槽位，材质里的下标不变
+                uploadTexture(*texture);
+                mResidency.SetResident(texture->mResidency, true);
+            }
+        }
     }
 
-    vmaUnmapMemory(mAllocator, GetCurrentFrame().mSceneBuffer.mAllocation);
+    // 按实际存在的Buffer和Image计算，GeometryBuffer的块里空闲的部分也占着显存
+    // 已经驱逐、还在删除队列里等待销毁的部分不算
+    VkDeviceSize usage = mResidency.GetDeviceUsage();
+    VkDeviceSize pending = mResidency.GetPendingFreeBytes();
+    mResidentBytes = usage > pending ? usage - pending : 0;
 
-    Mesh* lastMesh = nullptr;
-    Material* lastMat = nullptr;
-    for (uint32_t i = 0; i < count; i++)
+    // 和其他运行中删除的对象一样交给延迟删除，在这一帧的Timeline值完成后销毁
+    const uint64_t retireValue = mGraphicsTimeline.mLastSubmitted + 1;
+    auto allocationSize = [&](VmaAllocation allocation)
     {
-        RenderScene& scene = first[i];
+        VmaAllocationInfo allocInfo {};
+        vmaGetAllocationInfo(mAllocator, allocation, &allocInfo);
+        return allocInfo.size;
+    };
 
-        if (scene.mMaterial != lastMat)
+    mResidency.CollectEvictions(mResidentBytes, frame, mEvictions);
+    bool bMeshEvicted = false;
+    for (ResidencyHandle handle : mEvictions)
+    {
+        if (mResidency.GetType(handle) == ResidentType::Mesh)
+        {
+            Mesh* mesh = static_cast<Mesh*>(mResidency.GetResource(handle));
+            mGeometryBuffer.Free(mesh->mGeometry);
+            mesh->mGeometry = GeometryRange {};
+            bMeshEvicted = true;
+        }
+        else
         {
-            vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.mMaterial->mPipeline);
-            lastMat = scene.mMaterial;
+            Texture* texture = static_cast<Texture*>(mResidency.GetResource(handle));
+            mResidency.AddPendingFree(allocationSize(texture->mImage.mAllocation), retireValue);
+            evictTexture(*texture);
+        }
+        mResidency.SetResident(handle, false);
+    }
+
+    // 网格只是把范围还给空闲链表，整块都空了才真正释放显存
+    if (bMeshEvicted)
+    {
+        mReleasedBuffers.clear();
+        mGeometryBuffer.ReleaseEmptyBlocks(mReleasedBuffers);
+        for (const AllocatedBuffer& buffer : mReleasedBuffers)
+        {
+            mResidency.AddPendingFree(allocationSize(buffer.mAllocation), retireValue);
+            DeferDestroy(buffer);
+        }
+    }
+}
+
+void VulkanEngine::DrawObjects(VkCommandBuffer cmdBuffer, const VkCommandBufferInheritanceInfo& inheritance, RenderScene* first, uint32_t count, const uint32_t* indices)
+{
+    ZoneScoped;
+    RingBuffer& transient = GetCurrentFrame().mTransientBuffer;
+    const glm::mat4& view = mCameraData.mView;
+    const uint32_t* globalOffsets = mGlobalOffsets;
 
-            uint32_t uniformOffset = PadUniformBufferSize((uint32_t)sizeof(UniformData)) * frameIdx;
-            vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.mMaterial->mPipelineLayout, 0, 1, &GetCurrentFrame().mGlobalDescSet, 1, &uniformOffset);
-            vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.mMaterial->mPipelineLayout, 1, 1, &GetCurrentFrame().mSceneDescSet, 0, nullptr);
+    if (count > MAX_OBJECTS)
+    {
+        if (!mbObjectLimitWarned)
+        {
+            std::cout << "Too many objects: " << count << ", only draw " << MAX_OBJECTS << std::endl;
+            mbObjectLimitWarned = true;
+        }
+        count = MAX_OBJECTS;
+    }
 
-            if (scene.mMaterial->mTexSet != VK_NULL_HANDLE)
+    // 每个物体一个排序Key，排序后按Key的顺序录制，和场景里物体的顺序无关
+    {
+        ZoneScopedN("BuildDrawList");
+        mDrawList.Clear();
+        mDrawList.Reserve(count);
+        // 世界空间里1单位在距离1处投影到屏幕上的像素数
+        const float projScale = std::abs(mCameraData.mProj[1][1]) * (float)mRenderExtent.height * 0.5f;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint32_t object = indices ? indices[i] : i;
+            const RenderScene& scene = first[object];
+            const Mesh* mesh = scene.mMesh;
+            // 相机看向-Z，物体原点在View空间里的-z就是深度
+            float depth = -(view * scene.mTransform[3]).z / CAMERA_FAR_PLANE;
+
+            uint32_t lod = 0;
+            if (mesh->mLods.size() > 1)
             {
-                vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.mMaterial->mPipelineLayout, 2, 1, &scene.mMaterial->mTexSet, 0, nullptr);
+                // 和剔除一样用最大的轴向缩放放大包围球，距离取到球面最近的点
+                glm::vec3 center = glm::vec3(scene.mTransform * glm::vec4(mesh->mBounds.mOrigin[0], mesh->mBounds.mOrigin[1], mesh->mBounds.mOrigin[2], 1.0f));
+                float scale = std::max({ glm::length(glm::vec3(scene.mTransform[0])), glm::length(glm::vec3(scene.mTransform[1])), glm::length(glm::vec3(scene.mTransform[2])) });
+                float radius = mesh->mBounds.mRadius * scale;
+                float distance = std::max(glm::length(center - mCameraPosition) - radius, CAMERA_NEAR_PLANE);
+                lod = mesh->SelectLod(radius * projScale / distance, mConfig.mLodPixelError);
             }
+            uint32_t meshKey = mesh->mID * Assets::MESH_MAX_LODS + lod;
+            mDrawList.Add(DrawList::MakeKey(DRAW_PASS_OPAQUE, scene.mMaterial->mPipelineID, meshKey, scene.mMaterial->mID, depth), object, lod);
+        }
+    }
+    mDrawList.Sort();
+    const DrawItem* items = mDrawList.GetItems();
+
+    GPUObjectData* objectSSBO;
+    uint32_t objectOffset = transient.Allocate(sizeof(GPUObjectData) * count, (void**)&objectSSBO);
+
+    // 按线程数把排好序的Draw列表切成连续的几段，每段录制到自己的Secondary Command Buffer
+    FrameData& frame = GetCurrentFrame();
+    uint32_t chunkCount = std::clamp(count / MIN_DRAWS_PER_WORKER, 1u, (uint32_t)frame.mWorkerCmdBuffers.size());
+    uint32_t chunkSize = (count + chunkCount - 1) / chunkCount;
+    // 每段单独统计，录制完再合并，线程之间不共享计数器
+    std::vector<DrawStats> chunkStats(chunkCount);
+
+    mWorkerPool.ParallelFor(chunkCount, [&](uint32_t chunk)
+    {
+        ZoneScopedN("RecordChunk");
+        uint32_t begin = chunk * chunkSize;
+        uint32_t end = std::min(begin + chunkSize, count);
+
+        // 每段的物体矩阵也由录制它的线程写入，不同线程写的范围不重叠
+        // 物体数据按排序后的顺序存放
+        for (uint32_t i = begin; i < end; i++)
+        {
+            const RenderScene& scene = first[items[i].mObject];
+            objectSSBO[i].mModelMatrix = scene.mTransform;
+            objectSSBO[i].mMaterialIndex = scene.mMaterial->mID;
         }
 
-        glm::mat4 model = scene.mTransform;
-        //final render matrix, that we are calculating on the cpu
-        glm::mat4 meshMatrix = model;
+        VkCommandBuffer secondary = frame.mWorkerCmdBuffers[chunk];
+        VkCommandBufferBeginInfo secondaryBI = VKInit::CmdBufferBeginInfo(
+            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT);
+        secondaryBI.pInheritanceInfo = &inheritance;
+
+        VK_CHECK(vkBeginCommandBuffer(secondary, &secondaryBI));
+        recordDraws(secondary, first, items, begin, end, globalOffsets, objectOffset, chunkStats[chunk]);
+        VK_CHECK(vkEndCommandBuffer(secondary));
+    });
+
+    vkCmdExecuteCommands(cmdBuffer, chunkCount, frame.mWorkerCmdBuffers.data());
+
+    for (uint32_t i = 0; i < chunkCount; i++)
+    {
+        mDrawStats.Add(chunkStats[i]);
+    }
+    mDrawStatsFrames++;
+}
 
-        MeshPushConstants constants{};
-        constants.mMatrix = meshMatrix;
+void VulkanEngine::recordDraws(VkCommandBuffer cmdBuffer, RenderScene* scenes, const DrawItem* items, uint32_t begin, uint32_t end, const uint32_t* globalOffsets, uint32_t objectOffset, DrawStats& stats)
+{
+    // Secondary Command Buffer不继承任何绑定状态和动态状态，每段都要重新设置
+    VkViewport viewport { 0.0f, 0.0f, (float)mRenderExtent.width, (float)mRenderExtent.height, 0.0f, 1.0f };
+    VkRect2D scissor { {0, 0}, mRenderExtent };
+    vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+
+    // 所有材质共用一个Layout，三个描述符集在开头绑定一次，之后换Pipeline也不会失效
+    VkDescriptorSet bindlessSet = mBindless.GetSet();
+    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mMeshPipelineLayout, 0, 1, &GetCurrentFrame().mGlobalDescSet, 2, globalOffsets);
+    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mMeshPipelineLayout, 1, 1, &GetCurrentFrame().mSceneDescSet, 1, &objectOffset);
+    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mMeshPipelineLayout, 2, 1, &bindlessSet, 0, nullptr);
+    stats.mDescSetBinds += 3;
+
+    // 列表按Pipeline、网格排好序，只在值变化时绑定
+    VkPipeline lastPipeline = VK_NULL_HANDLE;
+    uint32_t lastBlock = UINT32_MAX;
+    VkIndexType lastIndexType = VK_INDEX_TYPE_MAX_ENUM;
+    uint32_t i = begin;
+    while (i < end)
+    {
+        RenderScene& scene = scenes[items[i].mObject];
+        Material* material = scene.mMaterial;
+
+        // Pipeline和网格都相同的物体在排序后相邻，合并成一次Instanced Draw，材质下标在每个物体的数据里
+        uint32_t runEnd = i + 1;
+        while (runEnd < end)
+        {
+            const RenderScene& next = scenes[items[runEnd].mObject];
+            if (next.mMesh != scene.mMesh || next.mMaterial->mPipeline != material->mPipeline || items[runEnd].mLod != items[i].mLod) break;
+            runEnd++;
+        }
 
-        vkCmdPushConstants(cmdBuffer, scene.mMaterial->mPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(MeshPushConstants), &constants);
+        if (material->mPipeline != lastPipeline)
+        {
+            vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, material->mPipeline);
+            lastPipeline = material->mPipeline;
+            stats.mPipelineBinds++;
+        }
 
-        if (scene.mMesh != lastMesh)
+        // 网格共用顶点和索引Buffer，只有换块或索引类型时才需要重新绑定，网格之间用firstIndex和vertexOffset区分
+        const GeometryRange& geometry = scene.mMesh->mGeometry;
+        if (geometry.mBlock != lastBlock)
         {
-            VkDeviceSize offset = 0;
-            vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &scene.mMesh->mVertexBuffer.mBuffer, &offset);
-            lastMesh = scene.mMesh;
+            mGeometryBuffer.BindVertexBuffers(cmdBuffer, geometry.mBlock, VERTEX_STREAM_COUNT);
+            stats.mVertexBufferBinds++;
+        }
+        if (geometry.mBlock != lastBlock || geometry.mIndexType != lastIndexType)
+        {
+            vkCmdBindIndexBuffer(cmdBuffer, mGeometryBuffer.GetIndexBuffer(geometry.mBlock), 0, geometry.mIndexType);
+            lastBlock = geometry.mBlock;
+            lastIndexType = geometry.mIndexType;
+            stats.mIndexBufferBinds++;
+        }
+        // Object SSBO按排序后的顺序存放，firstInstance就是这一组在里面的起始下标
+        // 所有LOD共用顶点，只是索引范围不同
+        const Assets::MeshLod& lod = scene.mMesh->mLods[items[i].mLod];
+        uint32_t instanceCount = runEnd - i;
+        vkCmdDrawIndexed(cmdBuffer, lod.mIndexCount, instanceCount, geometry.mFirstIndex + lod.mFirstIndex, (int32_t)geometry.mFirstVertex, i);
+        stats.mDraws++;
+        stats.mInstances += instanceCount;
+        stats.mTriangles += (uint64_t)lod.mIndexCount / 3 * instanceCount;
+
+        i = runEnd;
+    }
+}
+
+// 全局的内存Barrier，用于剔除前后Buffer的同步
+static void RecordMemoryBarrier(VkCommandBuffer cmdBuffer, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess)
+{
+    VkMemoryBarrier2 barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    barrier.pNext = nullptr;
+    barrier.srcStageMask = srcStage;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstStageMask = dstStage;
+    barrier.dstAccessMask = dstAccess;
+
+    VkDependencyInfo depInfo {};
+    depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    depInfo.pNext = nullptr;
+    depInfo.memoryBarrierCount = 1;
+    depInfo.pMemoryBarriers = &barrier;
+
+    vkCmdPipelineBarrier2(cmdBuffer, &depInfo);
+}
+
+void VulkanEngine::cullObjects(VkCommandBuffer cmdBuffer, uint32_t phase)
+{
+    ZoneScoped;
+    FrameData& frame = GetCurrentFrame();
+
+    // 剔除参数每帧写一次，两个阶段共用
+    if (phase == 0)
+    {
+        // 金字塔第一次使用前从UNDEFINED转换，之后每一级的读写都在GENERAL
+        if (!mbDepthPyramidInitialized)
+        {
+            VKUtil::TransitionImage(cmdBuffer, mDepthPyramid.mImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+            mbDepthPyramidInitialized = true;
+        }
+
+        CullView view = CullView::FromMatrices(mCameraData.mVP, mCameraData.mProj, mCameraPosition, 0.0f, 0.0f);
+        auto projParams = [](const glm::mat4& proj)
+        {
+            return glm::vec4(proj[0][0], proj[1][1], proj[2][2], proj[3][2]);
+        };
+
+        GPUCullData cullData {};
+        cullData.mView = mCameraData.mView;
+        cullData.mPrevView = mPrevCameraData.mView;
+        for (int i = 0; i < 6; i++)
+        {
+            cullData.mPlanes[i] = view.mPlanes[i];
+        }
+        cullData.mProj = projParams(mCameraData.mProj);
+        cullData.mPrevProj = projParams(mPrevCameraData.mProj);
+        cullData.mPyramid = glm::vec4((float)mDepthPyramidExtent.width, (float)mDepthPyramidExtent.height, CAMERA_NEAR_PLANE, 0.0f);
+        cullData.mObjectCount = mGPUObjectCount;
+        cullData.mbOcclusion = mConfig.mbOcclusionCulling ? 1 : 0;
+        cullData.mbPrevValid = mbDepthPyramidValid ? 1 : 0;
+        cullData.mCameraPos = glm::vec4(mCameraPosition, 1.0f);
+        cullData.mViewProj = mCameraData.mVP;
+        cullData.mLod = glm::vec4(std::abs(mCameraData.mProj[1][1]) * (float)mRenderExtent.height * 0.5f, mConfig.mLodPixelError, 0.0f, 0.0f);
+        mCullDataOffset = frame.mTransientBuffer.Push(cullData);
+    }
+
+    // Mesh Shader路径在Task Shader里剔除，这里只需要让第一阶段写的遮挡标记对第二阶段可见
+    if (mbMeshShading)
+    {
+        if (phase == 1)
+        {
+            RecordMemoryBarrier(cmdBuffer,
+                VK_PIPELINE_STAGE_2_TASK_SHADER_BIT_EXT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                VK_PIPELINE_STAGE_2_TASK_SHADER_BIT_EXT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+        }
+        return;
+    }
+
+    // 每个批次的数量从0开始，由Compute原子累加
+    vkCmdFillBuffer(cmdBuffer, frame.mDrawCountBuffers[phase].mBuffer, 0, VK_WHOLE_SIZE, 0);
+    // 压缩的索引两个阶段接着写，只在第一阶段清零
+    const bool bComputeMeshlets = mConfig.mbMeshlets;
+    if (bComputeMeshlets && phase == 0)
+    {
+        vkCmdFillBuffer(cmdBuffer, frame.mMeshletIndexCount.mBuffer, 0, VK_WHOLE_SIZE, 0);
+    }
+    RecordMemoryBarrier(cmdBuffer,
+        VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mCullPipeline);
+    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mCullPipelineLayout, 0, 1, &frame.mCullDescSets[phase], 1, &mCullDataOffset);
+    vkCmdPushConstants(cmdBuffer, mCullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &phase);
+    // Meshlet剔除一个工作组处理一个物体
+    vkCmdDispatch(cmdBuffer, bComputeMeshlets ? mGPUObjectCount : (mGPUObjectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+    // 第一阶段写的遮挡标记在第二阶段的剔除里读，压缩的索引在绘制时读
+    VkPipelineStageFlags2 dstStages = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    VkAccessFlags2 dstAccess = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+    if (bComputeMeshlets)
+    {
+        dstStages |= VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT;
+        dstAccess |= VK_ACCESS_2_INDEX_READ_BIT;
+    }
+    RecordMemoryBarrier(cmdBuffer,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+        dstStages, dstAccess);
+}
+
+void VulkanEngine::buildDepthPyramid(VkCommandBuffer cmdBuffer)
+{
+    ZoneScoped;
+    // Mesh Shader路径在Task Shader里读金字塔
+    const VkPipelineStageFlags2 cullStages = mbMeshShading ? VK_PIPELINE_STAGE_2_TASK_SHADER_BIT_EXT : VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+
+    // 第一阶段的剔除还在读上一帧的金字塔，写之前要等它完成
+    RecordMemoryBarrier(cmdBuffer,
+        cullStages, VK_ACCESS_2_NONE,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mDepthPyramidPipeline);
+    for (uint32_t i = 0; i < mDepthPyramidMips.size(); i++)
+    {
+        GPUDepthPyramidParams params {};
+        params.mDstSize = glm::vec2(std::max(mDepthPyramidExtent.width >> i, 1u), std::max(mDepthPyramidExtent.height >> i, 1u));
+        params.mUVScale = glm::vec2(1.0f);
+        params.mUVMax = glm::vec2(1.0f);
+        if (i == 0)
+        {
+            // 深度图按窗口大小分配，只有左上角的渲染区域有效，不能采样到区域外的像素
+            glm::vec2 depthSize((float)mWndExtent.width, (float)mWndExtent.height);
+            glm::vec2 renderSize((float)mRenderExtent.width, (float)mRenderExtent.height);
+            params.mUVScale = renderSize / depthSize;
+            params.mUVMax = (renderSize - 0.5f) / depthSize;
+        }
+
+        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mDepthPyramidPipelineLayout, 0, 1, &mDepthPyramidDescSets[i], 0, nullptr);
+        vkCmdPushConstants(cmdBuffer, mDepthPyramidPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GPUDepthPyramidParams), &params);
+        vkCmdDispatch(cmdBuffer, ((uint32_t)params.mDstSize.x + 7) / 8, ((uint32_t)params.mDstSize.y + 7) / 8, 1);
+
+        // 下一级读这一级，最后一级之后是第二阶段的剔除和下一帧的第一阶段
+        RecordMemoryBarrier(cmdBuffer,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | cullStages, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+    }
+
+    mbDepthPyramidValid = true;
+}
+
+void VulkanEngine::drawObjectsIndirect(VkCommandBuffer cmdBuffer, const VkCommandBufferInheritanceInfo& inheritance, uint32_t phase)
+{
+    ZoneScoped;
+    FrameData& frame = GetCurrentFrame();
+
+    // 每个批次只有一次调用，一个线程录制就够了
+    VkCommandBuffer secondary = frame.mIndirectCmdBuffers[phase];
+    VkCommandBufferBeginInfo secondaryBI = VKInit::CmdBufferBeginInfo(
+        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT);
+    secondaryBI.pInheritanceInfo = &inheritance;
+    VK_CHECK(vkBeginCommandBuffer(secondary, &secondaryBI));
+
+    VkViewport viewport { 0.0f, 0.0f, (float)mRenderExtent.width, (float)mRenderExtent.height, 0.0f, 1.0f };
+    VkRect2D scissor { {0, 0}, mRenderExtent };
+    vkCmdSetViewport(secondary, 0, 1, &viewport);
+    vkCmdSetScissor(secondary, 0, 1, &scissor);
+
+    // Mesh Shader路径不用间接绘制命令
+    DrawStats stats {};
+    uint32_t indirectBatchCount = (uint32_t)mIndirectBatches.size();
+    if (mbMeshShading)
+    {
+        drawMeshTasks(secondary, phase, stats);
+        indirectBatchCount = 0;
+    }
+
+    // 批次已经按Pipeline、网格排好序，描述符集在第一个批次之前绑定一次
+    const uint32_t objectOffset = 0;
+    if (indirectBatchCount > 0)
+    {
+        VkDescriptorSet bindlessSet = mBindless.GetSet();
+        vkCmdBindDescriptorSets(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, mMeshPipelineLayout, 0, 1, &frame.mGlobalDescSet, 2, mGlobalOffsets);
+        vkCmdBindDescriptorSets(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, mMeshPipelineLayout, 1, 1, &mGPUSceneDescSet, 1, &objectOffset);
+        vkCmdBindDescriptorSets(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, mMeshPipelineLayout, 2, 1, &bindlessSet, 0, nullptr);
+        stats.mDescSetBinds += 3;
+    }
+    VkPipeline lastPipeline = VK_NULL_HANDLE;
+    uint32_t lastBlock = UINT32_MAX;
+    VkBuffer lastIndexBuffer = VK_NULL_HANDLE;
+    VkIndexType lastIndexType = VK_INDEX_TYPE_MAX_ENUM;
+    for (uint32_t i = 0; i < indirectBatchCount; i++)
+    {
+        const IndirectBatch& batch = mIndirectBatches[i];
+        Material* material = batch.mMaterial;
+
+        if (material->mPipeline != lastPipeline)
+        {
+            vkCmdBindPipeline(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, material->mPipeline);
+            lastPipeline = material->mPipeline;
+            stats.mPipelineBinds++;
+        }
+
+        if (batch.mGeometryBlock != lastBlock)
+        {
+            mGeometryBuffer.BindVertexBuffers(secondary, batch.mGeometryBlock, VERTEX_STREAM_COUNT);
+            lastBlock = batch.mGeometryBlock;
+            stats.mVertexBufferBinds++;
+        }
+        // Meshlet剔除后所有批次的索引都在这一帧的压缩索引Buffer里，统一是32位
+        VkBuffer indexBuffer = mConfig.mbMeshlets ? frame.mMeshletIndexBuffer.mBuffer : mGeometryBuffer.GetIndexBuffer(batch.mGeometryBlock);
+        VkIndexType indexType = mConfig.mbMeshlets ? VK_INDEX_TYPE_UINT32 : batch.mIndexType;
+        if (indexBuffer != lastIndexBuffer || indexType != lastIndexType)
+        {
+            vkCmdBindIndexBuffer(secondary, indexBuffer, 0, indexType);
+            lastIndexBuffer = indexBuffer;
+            lastIndexType = indexType;
+            stats.mIndexBufferBinds++;
+        }
+
+        vkCmdDrawIndexedIndirectCount(secondary,
+            frame.mDrawCommandBuffers[phase].mBuffer, batch.mFirstCommand * sizeof(VkDrawIndexedIndirectCommand),
+            frame.mDrawCountBuffers[phase].mBuffer, i * sizeof(uint32_t),
+            batch.mMaxCount, sizeof(VkDrawIndexedIndirectCommand));
+        stats.mDraws++;
+    }
+
+    VK_CHECK(vkEndCommandBuffer(secondary));
+    vkCmdExecuteCommands(cmdBuffer, 1, &secondary);
+
+    mDrawStats.Add(stats);
+    if (phase == 0)
+    {
+        mDrawStatsFrames++;
+    }
+}
+
+void VulkanEngine::drawMeshTasks(VkCommandBuffer cmdBuffer, uint32_t phase, DrawStats& stats)
+{
+    FrameData& frame = GetCurrentFrame();
+
+    // 所有材质共用一个Pipeline Layout，Set 0和Bindless的Set 2只绑定一次，Set 3按块切换
+    VkDescriptorSet bindlessSet = mBindless.GetSet();
+    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mMeshletPipelineLayout, 0, 1, &frame.mGlobalDescSet, 2, mGlobalOffsets);
+    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mMeshletPipelineLayout, 2, 1, &bindlessSet, 0, nullptr);
+    stats.mDescSetBinds += 2;
+
+    VkPipeline lastPipeline = VK_NULL_HANDLE;
+    uint32_t lastBlock = UINT32_MAX;
+    for (const IndirectBatch& batch : mIndirectBatches)
+    {
+        if (batch.mEntryCount == 0) continue;
+        Material* material = batch.mMaterial;
+
+        if (material->mMeshletPipeline != lastPipeline)
+        {
+            vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, material->mMeshletPipeline);
+            lastPipeline = material->mMeshletPipeline;
+            stats.mPipelineBinds++;
+        }
+
+        if (batch.mGeometryBlock != lastBlock)
+        {
+            vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mMeshletPipelineLayout, 3, 1, &frame.mMeshletDescSets[batch.mGeometryBlock], 1, &mCullDataOffset);
+            lastBlock = batch.mGeometryBlock;
+            stats.mDescSetBinds++;
+        }
+
+        // 一个Task工作组处理MESHLET_TASK_GROUP_SIZE个Meshlet，工作组数超过设备下限时分几次提交
+        const uint32_t maxEntriesPerDraw = 65535 * MESHLET_TASK_GROUP_SIZE;
+        for (uint32_t first = 0; first < batch.mEntryCount; first += maxEntriesPerDraw)
+        {
+            GPUMeshletDrawParams params {};
+            params.mFirstEntry = batch.mFirstEntry + first;
+            params.mEntryCount = std::min(batch.mEntryCount - first, maxEntriesPerDraw);
+            params.mPhase = phase;
+            vkCmdPushConstants(cmdBuffer, mMeshletPipelineLayout, VK_SHADER_STAGE_TASK_BIT_EXT, 0, sizeof(GPUMeshletDrawParams), &params);
+            mCmdDrawMeshTasks(cmdBuffer, (params.mEntryCount + MESHLET_TASK_GROUP_SIZE - 1) / MESHLET_TASK_GROUP_SIZE, 1, 1);
+            stats.mDraws++;
         }
-        vkCmdDraw(cmdBuffer, (uint32_t)scene.mMesh->mVertices.size(), 1, 0, 0);
     }
 }
 
 void VulkanEngine::loadImages()
 {
-    Texture tex{};
-    VKUtil::LoadImageFromFile(*this, "../../Assets/Textures/lost_empire-RGBA.png", tex.mImage);
+    ZoneScoped;
+    // 被驱逐的贴图已经销毁过，只销毁还在显存里的
+    mMainDeletionQueue.PushFunction([&]()
+    {
+        for (auto& it : mTextures)
+        {
+            evictTexture(it.second);
+        }
+    });
+
+    std::vector<uint32_t> pixels;
+    uint32_t width = 0, height = 0;
+    if (VKUtil::LoadPixelsFromFile("../../Assets/Textures/lost_empire-RGBA.png", pixels, width, height))
+    {
+        createTexture("EmpireDiffuse", std::move(pixels), width, height);
+    }
+}
+
+Texture* VulkanEngine::createTexture(const std::string& name, std::vector<uint32_t>&& pixels, uint32_t width, uint32_t height)
+{
+    Texture& texture = mTextures[name];
+    texture.mPixels = std::move(pixels);
+    texture.mWidth = width;
+    texture.mHeight = height;
+    uploadTexture(texture);
+    return &texture;
+}
+
+void VulkanEngine::uploadTexture(Texture& texture)
+{
+    ZoneScoped;
+    VKUtil::LoadImageFromPixels(*this, texture.mPixels.data(), texture.mWidth, texture.mHeight, texture.mImage);
+
+    VkImageViewCreateInfo imageCI = VKInit::ImageViewCreateInfo(VK_FORMAT_R8G8B8A8_SRGB, texture.mImage.mImage, VK_IMAGE_ASPECT_COLOR_BIT);
+    VK_CHECK(vkCreateImageView(mDevice, &imageCI, nullptr, &texture.mImageView));
+
+    // 驱逐之后重新加载，用这张贴图的物体在驱逐后都没有画过，在飞的帧不会采样这个槽位，可以直接重写
+    if (texture.mBindlessIndex != BINDLESS_INVALID_INDEX)
+    {
+        mBindless.WriteTexture(texture.mBindlessIndex, texture.mSampler, texture.mImageView);
+    }
+}
+
+void VulkanEngine::evictTexture(Texture& texture)
+{
+    if (texture.mImage.mImage == VK_NULL_HANDLE) return;
+
+    DeferDestroy(DeletionType::ImageView, texture.mImageView);
+    DeferDestroy(texture.mImage);
+    texture.mImageView = VK_NULL_HANDLE;
+    texture.mImage = AllocatedImage {};
+}
+
+void VulkanEngine::bindMaterialTexture(Material* material, Texture* texture, VkSampler sampler)
+{
+    material->mTexture = texture;
+
+    // 一个槽位是贴图和采样器的组合，同一张贴图再用别的采样器绑定时沿用第一次的
+    if (texture->mBindlessIndex == BINDLESS_INVALID_INDEX)
+    {
+        texture->mBindlessIndex = mBindless.AllocateTexture();
+        texture->mSampler = sampler;
+        mBindless.WriteTexture(texture->mBindlessIndex, sampler, texture->mImageView);
+    }
+}
+
+void VulkanEngine::uploadMaterials()
+{
+    ZoneScoped;
+    // 下标就是Material::mID，没有贴图的材质写入无效下标，它们的片元着色器不采样
+    std::vector<GPUMaterialData> materials(std::max(mNextMaterialID, 1u));
+    for (GPUMaterialData& data : materials)
+    {
+        data = GPUMaterialData {};
+        data.mTextureIndex = BINDLESS_INVALID_INDEX;
+    }
+    for (const auto& it : mMaterials)
+    {
+        const Material& material = it.second;
+        if (material.mTexture != nullptr)
+        {
+            materials[material.mID].mTextureIndex = material.mTexture->mBindlessIndex;
+        }
+    }
 
-    VkImageViewCreateInfo imageCI = VKInit::ImageViewCreateInfo(VK_FORMAT_R8G8B8A8_SRGB, tex.mImage.mImage, VK_IMAGE_ASPECT_COLOR_BIT);
-    vkCreateImageView(mDevice, &imageCI, nullptr, &tex.mImageView);
+    const VkDeviceSize size = materials.size() * sizeof(GPUMaterialData);
+    mMaterialBuffer = CreateBuffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryClass::DeviceLocal);
+    mUploadEngine.UploadBuffer(mMaterialBuffer.mBuffer, 0, materials.data(), size,
+        VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+    mBindless.WriteMaterials(mMaterialBuffer.mBuffer, size);
 
     mMainDeletionQueue.PushFunction([=]()
     {
-        vkDestroyImageView(mDevice, tex.mImageView, nullptr);
+        vmaDestroyBuffer(mAllocator, mMaterialBuffer.mBuffer, mMaterialBuffer.mAllocation);
     });
-    mTextures["EmpireDiffuse"] = tex;
 }
\ No newline at end of file
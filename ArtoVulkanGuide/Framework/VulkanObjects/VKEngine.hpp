@@ -2,34 +2,125 @@
 
 #include <vector>
 #include <deque>
+#include <chrono>
 #include <iostream>
 #include <functional>
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 
 #include "VKTypes.hpp"
+#include "VKAllocator.hpp"
 #include "VKPipeline.hpp"
 #include "VKMesh.hpp"
+#include "VKRingBuffer.hpp"
+#include "VKTimeline.hpp"
+#include "VKWorkerPool.hpp"
+#include "VKUpload.hpp"
+#include "VKGeometryBuffer.hpp"
+#include "VKRenderGraph.hpp"
+#include "VKDynamicResolution.hpp"
+#include "VKDrawList.hpp"
+#include "VKCulling.hpp"
+#include "VKResidency.hpp"
+#include "VKDeletion.hpp"
+#include "VKDescriptors.hpp"
+#include "VKBindless.hpp"
+#include "VKPipelineCache.hpp"
+
+#include <TracyVulkan.hpp>
+
+constexpr uint32_t MAX_FRAME_OVERLAP = 4;
+constexpr uint32_t MAX_OBJECTS = 50000;
+// GPU Driven的两阶段剔除：先画没有被上一帧金字塔遮挡的物体，再用新的金字塔重新测试被遮挡的物体
+constexpr uint32_t CULL_PHASE_COUNT = 2;
+// 深度金字塔最多的级数，32768以内的窗口都够用
+constexpr uint32_t MAX_PYRAMID_LEVELS = 16;
+// 每帧临时数据(相机、场景参数、物体矩阵)的容量
+constexpr size_t FRAME_TRANSIENT_SIZE = 4 * 1024 * 1024;
+// Buffer Pool每一块显存的大小，不超过1/4块大小的Buffer从块里子分配
+constexpr size_t BUFFER_POOL_BLOCK_SIZE = 64 * 1024 * 1024;
+// 上传用的环形Staging大小，更大的数据会单独创建Staging
+constexpr size_t UPLOAD_STAGING_SIZE = 32 * 1024 * 1024;
+// 共用顶点/索引Buffer每一块的容量，顶点是个数，索引是字节数
+constexpr uint32_t GEOMETRY_BLOCK_VERTICES = 1024 * 1024;
+constexpr uint32_t GEOMETRY_BLOCK_INDEX_SIZE = 16 * 1024 * 1024;
+// Meshlet剔除后每帧写出的索引个数上限，放不下的物体这一帧不画
+constexpr uint32_t MESHLET_INDEX_CAPACITY = 4 * 1024 * 1024;
+// 和Meshlet.task里的TASK_GROUP_SIZE一致
+constexpr uint32_t MESHLET_TASK_GROUP_SIZE = 32;
+
+// Benchmark用的合成场景：N个物体排成网格，随机使用M个材质和K个网格，带贴图的材质从T张生成的贴图里选
+struct SyntheticSceneConfig
+{
+    uint32_t mObjects = 0;
+    uint32_t mMaterials = 2;
+    uint32_t mMeshes = 1;
+    uint32_t mTextures = 1;
+};
 
-constexpr unsigned int FRAME_OVERLAP = 2;
+struct EngineConfig
+{
+    static EngineConfig FromCommandLine(int argc, char* argv[]);
+
+    // 同时在飞的帧数，范围1~MAX_FRAME_OVERLAP
+    uint32_t mFrameOverlap = 2;
+    VkPresentModeKHR mPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+    // 录制Draw Call的工作线程数(不含主线程)，0表示按CPU核数自动选择
+    uint32_t mRecordThreads = 0;
+    // 不创建窗口和SwapChain，渲染到离屏Image，可以在lavapipe这类软件驱动上运行
+    bool mbHeadless = false;
+    // 保存每一帧的计时，由调用者导出
+    bool mbRecordTimings = false;
+    // 物体数为0时使用默认场景
+    SyntheticSceneConfig mScene;
+    // 动态分辨率的目标GPU时间，0表示固定使用窗口分辨率
+    double mTargetGPUMs = 0.0;
+    float mMinResolutionScale = 0.5f;
+    // 场景数据只上传一次，每帧由Compute剔除，用vkCmdDrawIndirectCount绘制
+    bool mbGPUDriven = false;
+    // GPU Driven时用深度金字塔做两阶段的遮挡剔除
+    bool mbOcclusionCulling = true;
+    // 非GPU Driven时每帧在CPU上做视锥体和尺寸剔除，只把可见物体交给DrawObjects
+    bool mbCPUCulling = true;
+    // 投影直径小于这么多像素的物体被剔除
+    float mMinPixelSize = 1.0f;
+    // GPU Driven时按Meshlet剔除，用Compute压缩出可见三角形的索引
+    bool mbMeshlets = false;
+    // 设备支持VK_EXT_mesh_shader时Meshlet改用Task/Mesh Shader剔除和绘制
+    bool mbMeshShaders = true;
+    // 选择LOD时允许的屏幕误差(像素)，0表示不生成LOD，总是画原始网格
+    float mLodPixelError = 1.0f;
+    // 网格和贴图占用的显存预算(MB)，超过时驱逐最久没用的，0表示使用VK_EXT_memory_budget报告的预算
+    uint32_t mMemoryBudgetMB = 0;
+    // Pipeline缓存文件的路径前缀，后面加上Vendor和Device ID，为空时不读写文件，每次都是冷启动
+    std::string mPipelineCachePath = "PipelineCache";
+};
 
-struct MeshPushConstants
+struct Texture
 {
-    glm::vec4 mData;
-    glm::mat4 mMatrix;
+    AllocatedImage mImage {};
+    VkImageView mImageView = VK_NULL_HANDLE;
+    // CPU上保留一份像素，被驱逐后从这里重新上传
+    std::vector<uint32_t> mPixels;
+    uint32_t mWidth = 0;
+    uint32_t mHeight = 0;
+    ResidencyHandle mResidency = RESIDENCY_INVALID_HANDLE;
+    // 在BindlessTable贴图数组里的槽位，第一次绑定到材质时分配，和第一次绑定的采样器组合在一起
+    uint32_t mBindlessIndex = BINDLESS_INVALID_INDEX;
+    VkSampler mSampler = VK_NULL_HANDLE;
 };
 
 struct Material
 {
-    VkDescriptorSet mTexSet = VK_NULL_HANDLE;
     VkPipeline mPipeline = VK_NULL_HANDLE;;
     VkPipelineLayout  mPipelineLayout = VK_NULL_HANDLE;;
-};
-
-struct Texture
-{
-    AllocatedImage mImage;
-    VkImageView mImageView;
+    // 同一个片元着色器的Task/Mesh Pipeline，所有材质共用VulkanEngine::mMeshletPipelineLayout
+    VkPipeline mMeshletPipeline = VK_NULL_HANDLE;
+    // 材质用到的贴图，可见时标记贴图被使用
+    Texture* mTexture = nullptr;
+    uint32_t mPipelineID = 0;
+    // 也是材质Buffer里的下标
+    uint32_t mID = 0;
 };
 
 struct RenderScene
@@ -42,25 +133,43 @@ struct RenderScene
 struct FrameData
 {
     VkSemaphore mPresentSem, mRenderSem;
-    VkFence mRenderFence;
+    // 这一帧最后一次提交在Graphics Timeline上signal的值
+    uint64_t mTimelineValue = 0;
 
-    DeletionQueue mFrameDeletionQueue;
+    // 记录这一帧CPU开始的时间，Timeline到达后用于统计延迟
+    std::chrono::high_resolution_clock::time_point mCPUStartTime;
+    bool mbLatencyPending = false;
+    // 主Command Buffer首尾的两个时间戳，Timeline到达后读回
+    VkQueryPool mTimestampPool = VK_NULL_HANDLE;
+    uint32_t mFrameNumber = 0;
 
     VkCommandPool mCmdPool;
     VkCommandBuffer mCmdBuffer;
 
-    AllocatedBuffer mCameraBuffer;
-    VkDescriptorSet mGlobalDescSet;
+    // 每个录制线程一个Command Pool和Secondary Command Buffer，Pool不能跨线程同时使用
+    std::vector<VkCommandPool> mWorkerCmdPools;
+    std::vector<VkCommandBuffer> mWorkerCmdBuffers;
 
-    AllocatedBuffer mSceneBuffer;
+    // 常驻映射的线性分配器，Camera/Scene/Object数据都从这里分配
+    RingBuffer mTransientBuffer;
+    VkDescriptorSet mGlobalDescSet;
     VkDescriptorSet mSceneDescSet;
-};
 
-struct UploadContext
-{
-    VkFence mUploadFence;
-    VkCommandPool mCmdPool;
-    VkCommandBuffer mCmdBuffer;
+    // GPU Driven：每个剔除阶段写出的间接绘制命令和每个批次的数量
+    AllocatedBuffer mDrawCommandBuffers[CULL_PHASE_COUNT] {};
+    AllocatedBuffer mDrawCountBuffers[CULL_PHASE_COUNT] {};
+    VkDescriptorSet mCullDescSets[CULL_PHASE_COUNT] {};
+    // 每个阶段的绘制录制在自己的Secondary里，从mWorkerCmdPools[0]分配
+    VkCommandBuffer mIndirectCmdBuffers[CULL_PHASE_COUNT] {};
+    // 第一阶段被遮挡、需要在第二阶段重新测试的物体
+    AllocatedBuffer mOcclusionBuffer {};
+
+    // Meshlet剔除压缩出的索引和已经写出的个数，两个阶段共用
+    AllocatedBuffer mMeshletIndexBuffer {};
+    AllocatedBuffer mMeshletIndexCount {};
+    // Mesh Shader路径：每个(物体, Meshlet)的遮挡标记，以及每块GeometryBuffer一个描述符集
+    AllocatedBuffer mMeshletOcclusionBuffer {};
+    std::vector<VkDescriptorSet> mMeshletDescSets;
 };
 
 struct GPUCameraData
@@ -79,9 +188,131 @@ struct UniformData
     glm::vec4 mSunLightColor;
 };
 
+// 和着色器里的ObjectData一致，材质下标之后补齐到16字节
 struct GPUObjectData
 {
     glm::mat4 mModelMatrix;
+    uint32_t mMaterialIndex;
+    uint32_t mPad[3];
+};
+
+// 和TextureLit.frag里的MaterialData一致，按Material::mID存放
+struct GPUMaterialData
+{
+    uint32_t mTextureIndex;
+    uint32_t mPad[3];
+};
+
+// 和CullObjects.comp里的ObjectInfo一致
+struct GPUObjectInfo
+{
+    glm::vec4 mSphere;
+    uint32_t mBatch;
+    uint32_t mFirstCommand;
+    uint32_t mIndexCount;
+    uint32_t mFirstIndex;
+    int32_t mVertexOffset;
+    // 网格的Meshlet在全局Meshlet Buffer里的范围
+    uint32_t mMeshletOffset;
+    uint32_t mMeshletCount;
+    // 网格的LOD在mGPULodBuffer里的范围
+    uint32_t mLodOffset;
+    uint32_t mLodCount;
+    uint32_t mPad[2];
+};
+
+// 和CullObjects.comp里的MeshLod一致
+struct GPUMeshLod
+{
+    // 已经加上网格在GeometryBuffer里的起始索引
+    uint32_t mFirstIndex;
+    uint32_t mIndexCount;
+    float mError;
+    uint32_t mPad;
+};
+
+// 和CullObjects.comp里的CullData一致，std140
+struct GPUCullData
+{
+    glm::mat4 mView;
+    glm::mat4 mPrevView;
+    glm::vec4 mPlanes[6];
+    // P00, P11, P22, P32
+    glm::vec4 mProj;
+    glm::vec4 mPrevProj;
+    // 金字塔宽、高，近平面
+    glm::vec4 mPyramid;
+    uint32_t mObjectCount;
+    uint32_t mbOcclusion;
+    uint32_t mbPrevValid;
+    uint32_t mPad;
+    // Meshlet的法线锥剔除和Mesh Shader用
+    glm::vec4 mCameraPos;
+    glm::mat4 mViewProj;
+    // 距离1处每单位的像素数，允许的LOD屏幕误差
+    glm::vec4 mLod;
+};
+
+// 和Meshlet.task里的MeshletDraw一致
+struct GPUMeshletDrawParams
+{
+    uint32_t mFirstEntry;
+    uint32_t mEntryCount;
+    uint32_t mPhase;
+};
+
+// 和DepthPyramid.comp里的PyramidParams一致
+struct GPUDepthPyramidParams
+{
+    glm::vec2 mDstSize;
+    glm::vec2 mUVScale;
+    glm::vec2 mUVMax;
+};
+
+// 同一个材质、在同一块GeometryBuffer里、索引类型相同的物体共用一段间接绘制命令，每个批次一次vkCmdDrawIndexedIndirectCount
+// 每条命令自带firstIndex和vertexOffset，不同网格也可以在同一个批次里
+struct IndirectBatch
+{
+    // 批次里第一个物体的材质，Pipeline相同的材质在一个批次里，只用它的Pipeline
+    Material* mMaterial;
+    uint32_t mGeometryBlock;
+    VkIndexType mIndexType;
+    uint32_t mFirstCommand;
+    uint32_t mMaxCount;
+    // Mesh Shader路径里这个批次的(物体, Meshlet)列表
+    uint32_t mFirstEntry;
+    uint32_t mEntryCount;
+};
+
+struct LatencyStats
+{
+    void AddSample(double ms)
+    {
+        mTotalMs += ms;
+        mMaxMs = ms > mMaxMs ? ms : mMaxMs;
+        mSamples++;
+    }
+    double GetAverage() const { return mSamples > 0 ? mTotalMs / mSamples : 0.0; }
+    void Reset() { *this = LatencyStats{}; }
+
+    double mTotalMs = 0.0;
+    double mMaxMs = 0.0;
+    uint32_t mSamples = 0;
+};
+
+// 一帧的计时，单位ms
+struct FrameTimings
+{
+    uint32_t mFrame;
+    // Draw的总时间，包括等待在飞帧
+    double mCPUMs;
+    // vkBeginCommandBuffer到vkEndCommandBuffer
+    double mRecordMs;
+    // 提交和Present
+    double mSubmitMs;
+    // 时间戳的差值，设备不支持时为0
+    double mGPUMs;
+    float mRenderScale;
 };
 
 class VulkanEngine
@@ -98,33 +329,92 @@ public:
     Material* CreateMaterial(VkPipeline pipeline, VkPipelineLayout pipelineLayout, const std::string& name);
     Material* GetMaterial(const std::string& name);
     Mesh* GetMesh(const std::string& name);
-    void DrawObjects(VkCommandBuffer cmdBuffer, RenderScene* first, uint32_t count);
+    // 在已经开始的RenderPass里调用，RenderPass需要用SECONDARY_COMMAND_BUFFERS开始
+    // indices不为空时只绘制first[indices[0..count)]，否则绘制first[0..count)
+    void DrawObjects(VkCommandBuffer cmdBuffer, const VkCommandBufferInheritanceInfo& inheritance, RenderScene* first, uint32_t count, const uint32_t* indices = nullptr);
 
-    AllocatedBuffer CreateBuffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage);
+    AllocatedBuffer CreateBuffer(size_t allocSize, VkBufferUsageFlags usage, MemoryClass memoryClass);
     size_t PadUniformBufferSize(size_t originalSize);
 
-    void ImmediateSubmit(std::function<void(VkCommandBuffer cmdBuffer)>&& function);
+    // 等这一帧的Graphics Timeline值完成后再销毁，运行中删除对象不需要等设备空闲
+    template<typename T>
+    void DeferDestroy(DeletionType type, T handle, VmaAllocation allocation = VK_NULL_HANDLE)
+    {
+        mDeletionQueue.Push(type, handle, mGraphicsTimeline.mLastSubmitted + 1, allocation);
+    }
+    void DeferDestroy(const AllocatedBuffer& buffer) { mDeletionQueue.Push(buffer, mGraphicsTimeline.mLastSubmitted + 1); }
+    void DeferDestroy(const AllocatedImage& image) { mDeletionQueue.Push(image, mGraphicsTimeline.mLastSubmitted + 1); }
 
 private:
     void initVulkan();
     void initSwapChain();
-    void initDefaultRenderPass();
-    void initFrameBuffers();
+    // 每帧的Pass和Attachment，SwapChain和深度的Layout转换都在这里声明
+    void initRenderGraph();
     void initCommands();
     void initPipelines();
     void initScene();
-    // 创建同步对象，一个Fence用于控制GPU合适完成渲染
-    // 两个信号量来同步渲染和SwapChain
+    // 按mConfig.mScene生成网格、贴图、材质和物体
+    void initSyntheticScene();
+    // 场景确定后上传物体数据，创建剔除的Pipeline和每帧的间接绘制Buffer
+    void initGPUDriven();
+    // 合并所有网格的Meshlet并上传，返回每个物体在Meshlet Buffer里的范围，Mesh Shader路径还要生成(物体, Meshlet)列表
+    void initMeshlets(const std::vector<uint32_t>& order, std::vector<GPUObjectInfo>& infos);
+    // Mesh Shader路径每帧每块GeometryBuffer的描述符集，要在金字塔创建之后
+    void initMeshletDescriptors();
+    // 深度金字塔的Image、每个Mip的View和降采样的Pipeline
+    void initDepthPyramid();
+    // 场景确定后计算所有物体世界空间的包围体
+    void initCulling();
+    // 创建同步对象，Graphics队列的Timeline Semaphore用于控制GPU何时完成渲染
+    // 两个二值信号量来同步渲染和SwapChain
     void initSyncObjects();
     void initDescriptors();
+    // 上传走Transfer队列，有专用Transfer Queue Family时优先使用
+    void initUploadEngine();
+    // 所有网格的顶点从这里分配，必须在加载网格之前
+    void initGeometryBuffer();
+    // 检查在飞帧的Timeline值，统计CPU开始录制到GPU完成这一帧的延迟
+    void pollFrameLatency();
+    void reportFrameStats(bool bFinal);
 
     bool loadShaderModule(const char* filepath, VkShaderModule* outShaderModule);
     void loadMeshes();
-    void uploadMesh(Mesh& mesh);
+    // 生成LOD和Meshlet，再上传顶点和索引
+    UploadHandle uploadMesh(Mesh& mesh);
+    // 从GeometryBuffer分配空间并上传，驱逐后重新加载也走这里
+    UploadHandle uploadGeometry(Mesh& mesh);
     void loadImages();
+    // 像素拷贝进Texture后上传，销毁由loadImages里注册的删除函数统一处理
+    Texture* createTexture(const std::string& name, std::vector<uint32_t>&& pixels, uint32_t width, uint32_t height);
+    void uploadTexture(Texture& texture);
+    void evictTexture(Texture& texture);
+    // 贴图第一次绑定时分配Bindless槽位
+    void bindMaterialTexture(Material* material, Texture* texture, VkSampler sampler);
+    // 场景确定后按材质ID上传每个材质的贴图下标
+    void uploadMaterials();
+
+    // 场景确定后登记所有网格和贴图，GPU Driven时都固定在显存里
+    void initResidency();
+    // 标记这一帧可见物体用到的网格和贴图，重新加载不在显存里的，超过预算时驱逐最久没用的
+    void updateResidency();
+
+    // 每帧录制Pass之前写入相机和场景参数
+    void updateCameraData();
+    // CPU剔除，结果写进mVisibleObjects
+    void cullScene();
+    // phase 0用上一帧的深度金字塔，phase 1只重新测试第一阶段被遮挡的物体
+    void cullObjects(VkCommandBuffer cmdBuffer, uint32_t phase);
+    void drawObjectsIndirect(VkCommandBuffer cmdBuffer, const VkCommandBufferInheritanceInfo& inheritance, uint32_t phase);
+    // 每个批次一次vkCmdDrawMeshTasksEXT，剔除在Task Shader里
+    void drawMeshTasks(VkCommandBuffer cmdBuffer, uint32_t phase, DrawStats& stats);
+    // 从这一帧的深度生成金字塔，供第二阶段和下一帧的第一阶段使用
+    void buildDepthPyramid(VkCommandBuffer cmdBuffer);
+    // 录制items[begin, end)，items已经按Key排好序，scenes是items里下标对应的场景数组
+    void recordDraws(VkCommandBuffer cmdBuffer, RenderScene* scenes, const DrawItem* items, uint32_t begin, uint32_t end, const uint32_t* globalOffsets, uint32_t objectOffset, DrawStats& stats);
 
 public:
     bool mb_Initialized {false};
+    EngineConfig mConfig;
     int mFrameIndex {0};
     int mSelectedShader {0};
 
@@ -137,41 +427,148 @@ public:
     VkDevice mDevice;
     VkPhysicalDeviceProperties mGPUProps;
 
-    FrameData mFrames[FRAME_OVERLAP];
+    std::vector<FrameData> mFrames;
 
     VkQueue mGraphicsQueue;
     uint32_t mGraphicsQueueFamily;
+    QueueTimeline mGraphicsTimeline;
 
-    VkRenderPass mRenderPass;
+    VkQueue mTransferQueue;
+    uint32_t mTransferQueueFamily;
 
     VkSurfaceKHR mSurface;
     VkSwapchainKHR mSwapChain;
     VkFormat mSwapChainFormat;
+    VkPresentModeKHR mPresentMode;
 
-    std::vector<VkFramebuffer> mFrameBuffers;
     std::vector<VkImage> mSwapChainImages;
     std::vector<VkImageView> mSwapChainImageViews;
+    // Headless模式下代替SwapChain的Image
+    AllocatedImage mOffscreenImage {};
 
     DeletionQueue mMainDeletionQueue;
+    // 运行中释放的对象，每帧按Graphics Timeline完成的值销毁
+    TypedDeletionQueue mDeletionQueue;
 
     VmaAllocator mAllocator;
+    // 所有Buffer都从这里分配，图片仍然直接用VMA
+    BufferAllocator mBufferAllocator;
 
-    VkImageView mDSView;
-    AllocatedImage mDSImage;
     VkFormat mDSFormat;
 
+    RenderGraph mRenderGraph;
+    RGHandle mSwapChainTarget;
+    RGHandle mSceneColorTarget;
+    RGHandle mDepthTarget;
+
+    // 场景先渲染到按窗口大小分配的SceneColor里的mRenderExtent区域，再放大到SwapChain
+    DynamicResolution mDynamicResolution;
+    VkExtent2D mRenderExtent;
+
     std::vector<RenderScene> mRenderScenes;
     std::unordered_map<std::string, Material> mMaterials;
     std::unordered_map<std::string, Mesh> mMeshes;
     std::unordered_map<std::string, Texture> mTextures;
 
-    VkDescriptorPool mDescPool;
+    // 排序Key用的小整数ID
+    std::unordered_map<VkPipeline, uint32_t> mPipelineIDs;
+    uint32_t mNextMaterialID = 0;
+    uint32_t mNextMeshID = 0;
+    DrawList mDrawList;
+    DrawStats mDrawStats;
+    uint32_t mDrawStatsFrames = 0;
+    // 物体数超过MAX_OBJECTS时只提示一次，不在每帧刷屏
+    bool mbObjectLimitWarned = false;
+
+    // 所有描述符集都从这里分配，内容不变的描述符集由缓存去重，布局也只创建一次
+    DescriptorAllocator mDescAllocator;
+    DescriptorLayoutCache mDescLayoutCache;
+    DescriptorSetCache mDescSetCache;
     VkDescriptorSetLayout mGlobalDescSetLayout;
     VkDescriptorSetLayout mSceneDescSetLayout;
-    VkDescriptorSetLayout mTextureDescSetLayout;
+    // 所有材质共用的贴图数组和材质Buffer，每个Command Buffer只绑定一次
+    BindlessTable mBindless;
+    AllocatedBuffer mMaterialBuffer {};
+    // 顶点着色器路径的所有材质共用这个Layout
+    VkPipelineLayout mMeshPipelineLayout = VK_NULL_HANDLE;
 
-    UniformData mUniformParams;
-    AllocatedBuffer mUniformBuffer;
+    // 所有Pipeline都通过它创建，退出时写回文件
+    PipelineCache mPipelineCache;
+    // 启动时创建Pipeline花的时间，比较有无缓存的冷热启动
+    double mPipelineCreateMs = 0.0;
 
-    UploadContext mUploadContext;
+    UniformData mUniformParams;
+    GPUCameraData mCameraData;
+    // 上一帧的相机，遮挡剔除的第一阶段用它把物体投影到上一帧的金字塔上
+    GPUCameraData mPrevCameraData;
+    uint32_t mGlobalOffsets[2];
+    glm::vec3 mCameraPosition {};
+
+    SceneCuller mCuller;
+    std::vector<uint32_t> mVisibleObjects;
+    uint32_t mVisibleCount = 0;
+    uint64_t mVisibleStats = 0;
+
+    std::vector<IndirectBatch> mIndirectBatches;
+    uint32_t mGPUObjectCount = 0;
+    AllocatedBuffer mGPUObjectBuffer {};
+    AllocatedBuffer mGPUObjectInfoBuffer {};
+    // 所有网格的LOD表，每个网格只存一份
+    AllocatedBuffer mGPULodBuffer {};
+    VkDescriptorSet mGPUSceneDescSet = VK_NULL_HANDLE;
+    VkDescriptorSetLayout mCullDescSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout mCullPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline mCullPipeline = VK_NULL_HANDLE;
+    // 这一帧剔除参数在RingBuffer里的动态偏移
+    uint32_t mCullDataOffset = 0;
+
+    // Meshlet剔除，所有网格的Meshlet合并在一起
+    bool mbMeshShading = false;
+    PFN_vkCmdDrawMeshTasksEXT mCmdDrawMeshTasks = nullptr;
+    uint32_t mMeshletCount = 0;
+    uint32_t mMeshletEntryCount = 0;
+    AllocatedBuffer mMeshletBuffer {};
+    AllocatedBuffer mMeshletVertexBuffer {};
+    AllocatedBuffer mMeshletTriangleBuffer {};
+    AllocatedBuffer mMeshletEntryBuffer {};
+    VkDescriptorSetLayout mMeshletDescSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout mMeshletPipelineLayout = VK_NULL_HANDLE;
+
+    AllocatedImage mDepthPyramid {};
+    VkImageView mDepthPyramidView = VK_NULL_HANDLE;
+    std::vector<VkImageView> mDepthPyramidMips;
+    std::vector<VkDescriptorSet> mDepthPyramidDescSets;
+    VkExtent2D mDepthPyramidExtent {};
+    VkSampler mDepthPyramidSampler = VK_NULL_HANDLE;
+    VkDescriptorSetLayout mDepthPyramidDescSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout mDepthPyramidPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline mDepthPyramidPipeline = VK_NULL_HANDLE;
+    // 金字塔第一次使用前要从UNDEFINED转换，之后一直在GENERAL
+    bool mbDepthPyramidInitialized = false;
+    // 上一帧生成过金字塔，第一阶段可以做遮挡测试
+    bool mbDepthPyramidValid = false;
+
+    UploadEngine mUploadEngine;
+    GeometryBuffer mGeometryBuffer;
+    // 设备支持VK_EXT_memory_budget时VMA从扩展读取每个堆的预算
+    bool mbMemoryBudget = false;
+    ResidencyManager mResidency;
+    std::vector<ResidencyHandle> mEvictions;
+    // 这一帧整块释放的GeometryBuffer块，交给延迟删除
+    std::vector<AllocatedBuffer> mReleasedBuffers;
+    // 上一次updateResidency时网格和贴图等资源实际占用的显存
+    VkDeviceSize mResidentBytes = 0;
+    WorkerPool mWorkerPool;
+
+    // 没有开启Tracy时是空指针，GPU Zone的宏也是空的
+    TracyVkCtx mTracyCtx = nullptr;
+    VkCommandPool mTracyCmdPool = VK_NULL_HANDLE;
+
+    LatencyStats mLatencyStats;
+    LatencyStats mFrameTimeStats;
+    LatencyStats mGPUTimeStats;
+    std::chrono::high_resolution_clock::time_point mLastFrameTime;
+
+    bool mbGPUTimestamps = false;
+    std::vector<FrameTimings> mFrameTimings;
 };
\ No newline at end of file
@@ -0,0 +1,246 @@
+#include <algorithm>
+
+#include "VKGeometryBuffer.hpp"
+
+void FreeListAllocator::Init(uint32_t capacity)
+{
+    mCapacity = capacity;
+    mUsed = 0;
+    mFreeBlocks.clear();
+    if (capacity > 0)
+    {
+        mFreeBlocks[0] = capacity;
+    }
+}
+
+uint32_t FreeListAllocator::Allocate(uint32_t count, uint32_t alignment)
+{
+    if (count == 0) return INVALID_OFFSET;
+
+    for (auto it = mFreeBlocks.begin(); it != mFreeBlocks.end(); it++)
+    {
+        uint32_t blockStart = it->first;
+        uint32_t blockSize = it->second;
+        uint32_t offset = (blockStart + alignment - 1) / alignment * alignment;
+        uint32_t padding = offset - blockStart;
+        if (blockSize < padding || blockSize - padding < count) continue;
+
+        // 从空闲块里切出去，前面对齐跳过的和后面剩下的部分还是空闲块
+        uint32_t remain = blockSize - padding - count;
+        if (padding > 0)
+        {
+            it->second = padding;
+        }
+        else
+        {
+            mFreeBlocks.erase(it);
+        }
+        if (remain > 0)
+        {
+            mFreeBlocks[offset + count] = remain;
+        }
+        mUsed += count;
+        return offset;
+    }
+    return INVALID_OFFSET;
+}
+
+void FreeListAllocator::Free(uint32_t offset, uint32_t count)
+{
+    if (count == 0) return;
+
+    auto next = mFreeBlocks.lower_bound(offset);
+    uint32_t size = count;
+
+    // 和后面紧挨着的空闲块合并
+    if (next != mFreeBlocks.end() && offset + size == next->first)
+    {
+        size += next->second;
+        next = mFreeBlocks.erase(next);
+    }
+
+    // 和前面紧挨着的空闲块合并
+    if (next != mFreeBlocks.begin())
+    {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset)
+        {
+            prev->second += size;
+            mUsed -= count;
+            return;
+        }
+    }
+
+    mFreeBlocks[offset] = size;
+    mUsed -= count;
+}
+
+void GeometryBuffer::Init(BufferAllocator* allocator, const uint32_t* streamStrides, uint32_t streamCount, uint32_t blockVertices, uint32_t blockIndexBytes)
+{
+    if (streamCount == 0 || streamCount > MAX_VERTEX_STREAMS)
+    {
+        std::cout << "Invalid vertex stream count " << streamCount << std::endl;
+        abort();
+    }
+
+    mAllocator = allocator;
+    mStreamCount = streamCount;
+    for (uint32_t i = 0; i < streamCount; i++)
+    {
+        mStreamStrides[i] = streamStrides[i];
+    }
+    mBlockVertices = blockVertices;
+    mBlockIndices = blockIndexBytes / sizeof(uint16_t);
+}
+
+void GeometryBuffer::Destroy()
+{
+    for (auto & block : mBlocks)
+    {
+        if (block.mbReleased) continue;
+        for (uint32_t i = 0; i < mStreamCount; i++)
+        {
+            mAllocator->DestroyBuffer(block.mVertexBuffers[i]);
+        }
+        mAllocator->DestroyBuffer(block.mIndexBuffer);
+    }
+    mBlocks.clear();
+}
+
+uint32_t GeometryBuffer::createBlock(uint32_t vertexCapacity, uint32_t indexCapacity)
+{
+    Block block {};
+
+    // 剔除和Meshlet的Compute也会直接读顶点和索引
+    const VkBufferUsageFlags vertexUsage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    for (uint32_t i = 0; i < mStreamCount; i++)
+    {
+        block.mVertexBuffers[i] = mAllocator->CreateDedicatedBuffer((VkDeviceSize)vertexCapacity * mStreamStrides[i], vertexUsage, MemoryClass::DeviceLocal);
+    }
+
+    // 索引Buffer不能是空的，还没有索引数据时也留一点
+    const VkBufferUsageFlags indexUsage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    block.mIndexBuffer = mAllocator->CreateDedicatedBuffer((VkDeviceSize)std::max(indexCapacity, 2u) * sizeof(uint16_t), indexUsage, MemoryClass::DeviceLocal);
+
+    block.mVertices.Init(vertexCapacity);
+    block.mIndices.Init(indexCapacity);
+
+    // 优先使用已经释放的位置，其他网格记下的块下标不会变
+    for (uint32_t i = 0; i < mBlocks.size(); i++)
+    {
+        if (mBlocks[i].mbReleased)
+        {
+            mBlocks[i] = block;
+            return i;
+        }
+    }
+    mBlocks.push_back(block);
+    return static_cast<uint32_t>(mBlocks.size()) - 1;
+}
+
+GeometryRange GeometryBuffer::Allocate(uint32_t vertexCount, uint32_t indexCount, VkIndexType indexType)
+{
+    GeometryRange range {};
+    range.mVertexCount = vertexCount;
+    range.mIndexCount = indexCount;
+    range.mIndexType = indexType;
+
+    // 索引的空闲链表以16位为单位
+    const uint32_t indexUnits = GetIndexSize(indexType) / sizeof(uint16_t);
+    const uint32_t indexSlots = indexCount * indexUnits;
+
+    // 顶点和索引必须在同一块里，先在已有的块里找
+    for (uint32_t i = 0; i < mBlocks.size(); i++)
+    {
+        Block& block = mBlocks[i];
+        if (block.mbReleased) continue;
+        uint32_t firstVertex = block.mVertices.Allocate(vertexCount);
+        if (vertexCount > 0 && firstVertex == FreeListAllocator::INVALID_OFFSET) continue;
+
+        uint32_t firstIndex = block.mIndices.Allocate(indexSlots, indexUnits);
+        if (indexCount > 0 && firstIndex == FreeListAllocator::INVALID_OFFSET)
+        {
+            if (vertexCount > 0) block.mVertices.Free(firstVertex, vertexCount);
+            continue;
+        }
+
+        range.mBlock = i;
+        range.mFirstVertex = vertexCount > 0 ? firstVertex : 0;
+        range.mFirstIndex = indexCount > 0 ? firstIndex / indexUnits : 0;
+        return range;
+    }
+
+    // 超过块大小的网格单独创建一块刚好放下它的
+    uint32_t block = createBlock(std::max(vertexCount, mBlockVertices), std::max(indexSlots, mBlockIndices));
+    range.mBlock = block;
+    range.mFirstVertex = vertexCount > 0 ? mBlocks[block].mVertices.Allocate(vertexCount) : 0;
+    range.mFirstIndex = indexCount > 0 ? mBlocks[block].mIndices.Allocate(indexSlots, indexUnits) / indexUnits : 0;
+    return range;
+}
+
+void GeometryBuffer::Free(const GeometryRange& range)
+{
+    if (range.mBlock >= mBlocks.size() || mBlocks[range.mBlock].mbReleased) return;
+
+    Block& block = mBlocks[range.mBlock];
+    block.mVertices.Free(range.mFirstVertex, range.mVertexCount);
+    const uint32_t indexUnits = GetIndexSize(range.mIndexType) / sizeof(uint16_t);
+    block.mIndices.Free(range.mFirstIndex * indexUnits, range.mIndexCount * indexUnits);
+}
+
+void GeometryBuffer::BindVertexBuffers(VkCommandBuffer cmdBuffer, uint32_t block, uint32_t streamCount) const
+{
+    VkBuffer buffers[MAX_VERTEX_STREAMS];
+    VkDeviceSize offsets[MAX_VERTEX_STREAMS] {};
+    for (uint32_t i = 0; i < streamCount; i++)
+    {
+        buffers[i] = mBlocks[block].mVertexBuffers[i].mBuffer;
+    }
+    vkCmdBindVertexBuffers(cmdBuffer, 0, streamCount, buffers, offsets);
+}
+
+void GeometryBuffer::ReleaseEmptyBlocks(std::vector<AllocatedBuffer>& outBuffers)
+{
+    for (Block& block : mBlocks)
+    {
+        if (block.mbReleased || block.mVertices.GetUsed() > 0 || block.mIndices.GetUsed() > 0) continue;
+
+        for (uint32_t i = 0; i < mStreamCount; i++)
+        {
+            outBuffers.push_back(block.mVertexBuffers[i]);
+            block.mVertexBuffers[i] = AllocatedBuffer {};
+        }
+        outBuffers.push_back(block.mIndexBuffer);
+        block.mIndexBuffer = AllocatedBuffer {};
+
+        block.mVertices.Init(0);
+        block.mIndices.Init(0);
+        block.mbReleased = true;
+    }
+}
+
+void GeometryBuffer::PrintStats() const
+{
+    uint32_t vertexStride = 0;
+    for (uint32_t i = 0; i < mStreamCount; i++)
+    {
+        vertexStride += mStreamStrides[i];
+    }
+
+    for (uint32_t i = 0; i < mBlocks.size(); i++)
+    {
+        const Block& block = mBlocks[i];
+        if (block.mbReleased)
+        {
+            std::cout << "Geometry block " << i << " | released" << std::endl;
+            continue;
+        }
+        std::cout << "Geometry block " << i
+            << " | vertices " << block.mVertices.GetUsed() << "/" << block.mVertices.GetCapacity()
+            << " (" << (uint64_t)block.mVertices.GetUsed() * vertexStride / 1024 << "KB)"
+            << " | index " << (uint64_t)block.mIndices.GetUsed() * sizeof(uint16_t) / 1024 << "/"
+            << (uint64_t)block.mIndices.GetCapacity() * sizeof(uint16_t) / 1024 << "KB"
+            << " | free blocks " << block.mVertices.GetFreeBlockCount() << "/" << block.mIndices.GetFreeBlockCount()
+            << std::endl;
+    }
+}
\ No newline at end of file
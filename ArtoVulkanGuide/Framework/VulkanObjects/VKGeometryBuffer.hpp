@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "VKTypes.hpp"
+#include "VKAllocator.hpp"
+
+// First-Fit的空闲链表，单位由调用者决定(顶点或索引的个数)
+// 空闲块按起始位置排序，释放时和相邻的空闲块合并
+class FreeListAllocator
+{
+public:
+    static constexpr uint32_t INVALID_OFFSET = UINT32_MAX;
+
+    void Init(uint32_t capacity);
+    // 起始位置按alignment对齐，对齐跳过的部分留在空闲链表里，放不下时返回INVALID_OFFSET
+    uint32_t Allocate(uint32_t count, uint32_t alignment = 1);
+    void Free(uint32_t offset, uint32_t count);
+
+    uint32_t GetCapacity() const { return mCapacity; }
+    uint32_t GetUsed() const { return mUsed; }
+    uint32_t GetFreeBlockCount() const { return static_cast<uint32_t>(mFreeBlocks.size()); }
+
+private:
+    // 起始位置 -> 长度
+    std::map<uint32_t, uint32_t> mFreeBlocks;
+    uint32_t mCapacity = 0;
+    uint32_t mUsed = 0;
+};
+
+// 网格在GeometryBuffer里的位置，单位是顶点和索引的个数
+// mFirstIndex按mIndexType的大小计算，索引Buffer从头绑定时可以直接作为firstIndex
+struct GeometryRange
+{
+    uint32_t mBlock = UINT32_MAX;
+    uint32_t mFirstVertex = 0;
+    uint32_t mVertexCount = 0;
+    uint32_t mFirstIndex = 0;
+    uint32_t mIndexCount = 0;
+    VkIndexType mIndexType = VK_INDEX_TYPE_UINT32;
+};
+
+// 所有静态网格共用的大顶点Buffer和索引Buffer
+// 顶点可以分成几路流，每路一个Buffer，同一个顶点在每路里的下标相同
+// 每一块里的顶点和索引各自用空闲链表分配，放不下时再创建新的一块，超过块大小的网格单独占一块
+// 16位和32位索引放在同一个索引Buffer里，空闲链表以16位为单位，32位索引按两个单位对齐
+// 绘制时只在块或索引类型变化时重新绑定，通常整个场景只有一块
+// 每一块的Buffer都单独分配显存，驱逐后整块为空时释放，显存直接还给驱动
+class GeometryBuffer
+{
+public:
+    static constexpr uint32_t MAX_VERTEX_STREAMS = 4;
+
+    // streamStrides是每路流一个顶点的字节数，blockIndexBytes是每一块索引Buffer的字节数
+    void Init(BufferAllocator* allocator, const uint32_t* streamStrides, uint32_t streamCount, uint32_t blockVertices, uint32_t blockIndexBytes);
+    void Destroy();
+
+    // 数量为0的部分不分配
+    GeometryRange Allocate(uint32_t vertexCount, uint32_t indexCount, VkIndexType indexType);
+    void Free(const GeometryRange& range);
+
+    // 绑定前streamCount路流到Binding 0开始的位置，只需要位置的Pass只绑定第一路
+    void BindVertexBuffers(VkCommandBuffer cmdBuffer, uint32_t block, uint32_t streamCount) const;
+
+    VkBuffer GetVertexBuffer(uint32_t block, uint32_t stream) const { return mBlocks[block].mVertexBuffers[stream].mBuffer; }
+    VkBuffer GetIndexBuffer(uint32_t block) const { return mBlocks[block].mIndexBuffer.mBuffer; }
+    VkDeviceSize GetVertexOffset(const GeometryRange& range, uint32_t stream) const { return (VkDeviceSize)range.mFirstVertex * mStreamStrides[stream]; }
+    VkDeviceSize GetIndexOffset(const GeometryRange& range) const { return (VkDeviceSize)range.mFirstIndex * GetIndexSize(range.mIndexType); }
+    static uint32_t GetIndexSize(VkIndexType indexType) { return indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4; }
+    uint32_t GetBlockCount() const { return static_cast<uint32_t>(mBlocks.size()); }
+    uint32_t GetStreamCount() const { return mStreamCount; }
+
+    // 把没有任何网格的块的Buffer移到outBuffers，由调用者延迟销毁
+    // 块的下标不变，释放的位置在下次创建块时重新使用
+    void ReleaseEmptyBlocks(std::vector<AllocatedBuffer>& outBuffers);
+    void PrintStats() const;
+
+private:
+    struct Block
+    {
+        AllocatedBuffer mVertexBuffers[MAX_VERTEX_STREAMS] {};
+        AllocatedBuffer mIndexBuffer {};
+        FreeListAllocator mVertices;
+        FreeListAllocator mIndices;
+        bool mbReleased = false;
+    };
+
+    // indexCapacity的单位是16位
+    uint32_t createBlock(uint32_t vertexCapacity, uint32_t indexCapacity);
+
+private:
+    BufferAllocator* mAllocator = nullptr;
+    uint32_t mStreamStrides[MAX_VERTEX_STREAMS] {};
+    uint32_t mStreamCount = 0;
+    uint32_t mBlockVertices = 0;
+    // 以16位为单位
+    uint32_t mBlockIndices = 0;
+    std::vector<Block> mBlocks;
+};
\ No newline at end of file
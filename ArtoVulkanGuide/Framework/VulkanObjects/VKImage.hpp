@@ -5,4 +5,6 @@ namespace VKUtil
 {
     void TransitionImage(VkCommandBuffer cmdBuffer, VkImage image, VkImageLayout currentLayout, VkImageLayout newLayout);
     void CopyImageToImage(VkCommandBuffer cmdBuffer, VkImage source, VkImage dest, VkExtent3D imageExtent);
+    // 尺寸可以不同，线性过滤缩放，source在TRANSFER_SRC，dest在TRANSFER_DST
+    void BlitImageToImage(VkCommandBuffer cmdBuffer, VkImage source, VkImage dest, VkExtent2D srcSize, VkExtent2D dstSize);
 }
\ No newline at end of file
@@ -8,6 +8,7 @@ namespace VKInit
         info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         info.pNext = nullptr;
 
+        info.queueFamilyIndex = queueFamilyIndex;
         info.flags = flags;
         return info;
     }
@@ -35,6 +36,33 @@ namespace VKInit
         return info;
     }
 
+    VkCommandBufferInheritanceInfo CmdBufferInheritanceInfo(VkRenderPass renderPass, VkFramebuffer frameBuffer, uint32_t subpass)
+    {
+        VkCommandBufferInheritanceInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        info.pNext = nullptr;
+
+        info.renderPass = renderPass;
+        info.subpass = subpass;
+        info.framebuffer = frameBuffer;
+        info.occlusionQueryEnable = VK_FALSE;
+        return info;
+    }
+
+    VkCommandBufferInheritanceRenderingInfo CmdBufferInheritanceRenderingInfo(uint32_t colorCount, const VkFormat* colorFormats, VkFormat depthFormat)
+    {
+        VkCommandBufferInheritanceRenderingInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+        info.pNext = nullptr;
+
+        info.colorAttachmentCount = colorCount;
+        info.pColorAttachmentFormats = colorFormats;
+        info.depthAttachmentFormat = depthFormat;
+        info.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+        info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+        return info;
+    }
+
     VkCommandBufferSubmitInfo CmdBufferSubmitInfo(VkCommandBuffer cmdBuffer)
     {
         VkCommandBufferSubmitInfo cmdInfo{};
@@ -81,6 +109,26 @@ namespace VKInit
         return info;
     }
 
+    VkSemaphoreTypeCreateInfo SemaphoreTypeCreateInfo(VkSemaphoreType type, uint64_t initialValue)
+    {
+        VkSemaphoreTypeCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        info.pNext = nullptr;
+        info.semaphoreType = type;
+        info.initialValue = initialValue;
+        return info;
+    }
+
+    VkQueryPoolCreateInfo QueryPoolCreateInfo(VkQueryType type, uint32_t count)
+    {
+        VkQueryPoolCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        info.pNext = nullptr;
+        info.queryType = type;
+        info.queryCount = count;
+        return info;
+    }
+
     VkSubmitInfo SubmitInfo(VkCommandBuffer *cmdBuffer)
     {
         VkSubmitInfo info = {};
@@ -280,7 +328,22 @@ namespace VKInit
         return colorAttachment;
     }
 
-    VkRenderingInfo RenderingInfo(VkExtent2D renderExtent, VkRenderingAttachmentInfo *colorAttachment)
+    VkRenderingAttachmentInfo DepthAttachmentInfo(VkImageView view, VkImageLayout layout)
+    {
+        VkRenderingAttachmentInfo depthAttachment{};
+        depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+        depthAttachment.pNext = nullptr;
+
+        depthAttachment.imageView = view;
+        depthAttachment.imageLayout = layout;
+        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        depthAttachment.clearValue.depthStencil.depth = 1.0f;
+
+        return depthAttachment;
+    }
+
+    VkRenderingInfo RenderingInfo(VkExtent2D renderExtent, VkRenderingAttachmentInfo *colorAttachment, VkRenderingAttachmentInfo *depthAttachment)
     {
         VkRenderingInfo renderInfo{};
         renderInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
@@ -288,9 +351,9 @@ namespace VKInit
 
         renderInfo.renderArea = VkRect2D{VkOffset2D{0, 0}, renderExtent};
         renderInfo.layerCount = 1;
-        renderInfo.colorAttachmentCount = 1;
+        renderInfo.colorAttachmentCount = colorAttachment ? 1 : 0;
         renderInfo.pColorAttachments = colorAttachment;
-        renderInfo.pDepthAttachment = nullptr;
+        renderInfo.pDepthAttachment = depthAttachment;
         renderInfo.pStencilAttachment = nullptr;
 
         return renderInfo;
@@ -308,7 +371,7 @@ namespace VKInit
         return subImage;
     }
 
-    VkSemaphoreSubmitInfo SemaphoreSubmitInfo(VkPipelineStageFlags2 stageMask, VkSemaphore semaphore)
+    VkSemaphoreSubmitInfo SemaphoreSubmitInfo(VkPipelineStageFlags2 stageMask, VkSemaphore semaphore, uint64_t value)
     {
         VkSemaphoreSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
@@ -316,7 +379,8 @@ namespace VKInit
         submitInfo.semaphore = semaphore;
         submitInfo.stageMask = stageMask;
         submitInfo.deviceIndex = 0;
-        submitInfo.value = 1;
+        // 二值信号量会忽略这个值，Timeline Semaphore用它作为signal/wait的目标值
+        submitInfo.value = value;
 
         return submitInfo;
     }
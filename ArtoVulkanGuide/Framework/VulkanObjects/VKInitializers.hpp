@@ -9,12 +9,16 @@ namespace VKInit
     VkCommandPoolCreateInfo CmdPoolCreateInfo(uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags = 0);
     VkCommandBufferAllocateInfo CmdBufferAllocateInfo(VkCommandPool pool, uint32_t count = 1, VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
     VkCommandBufferBeginInfo CmdBufferBeginInfo(VkCommandBufferUsageFlags flags = 0);
+    VkCommandBufferInheritanceInfo CmdBufferInheritanceInfo(VkRenderPass renderPass, VkFramebuffer frameBuffer, uint32_t subpass = 0);
+    VkCommandBufferInheritanceRenderingInfo CmdBufferInheritanceRenderingInfo(uint32_t colorCount, const VkFormat* colorFormats, VkFormat depthFormat);
     VkCommandBufferSubmitInfo CmdBufferSubmitInfo(VkCommandBuffer cmdBuffer);
 
     VkFramebufferCreateInfo FrameBufferCreateInfo(VkRenderPass renderPass, VkExtent2D extent);
 
     VkFenceCreateInfo FenceCreateInfo(VkFenceCreateFlags flags = 0);
     VkSemaphoreCreateInfo SemaphoreCreateInfo(VkSemaphoreCreateFlags flags = 0);
+    VkSemaphoreTypeCreateInfo SemaphoreTypeCreateInfo(VkSemaphoreType type, uint64_t initialValue = 0);
+    VkQueryPoolCreateInfo QueryPoolCreateInfo(VkQueryType type, uint32_t count);
 
     VkSubmitInfo SubmitInfo(VkCommandBuffer* cmdBuffer);
     VkSubmitInfo2 SubmitInfo2(VkCommandBufferSubmitInfo* cmdSubmit, VkSemaphoreSubmitInfo* signal, VkSemaphoreSubmitInfo* wait);
@@ -33,10 +37,11 @@ namespace VKInit
     VkPipelineLayoutCreateInfo PipelineLayoutCreateInfo();
 
     VkRenderingAttachmentInfo ColorAttachmentInfo(VkImageView view, VkClearValue clearValue, VkImageLayout layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-    VkRenderingInfo RenderingInfo(VkExtent2D renderExtent, VkRenderingAttachmentInfo* colorAttachment);
+    VkRenderingAttachmentInfo DepthAttachmentInfo(VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+    VkRenderingInfo RenderingInfo(VkExtent2D renderExtent, VkRenderingAttachmentInfo* colorAttachment, VkRenderingAttachmentInfo* depthAttachment = nullptr);
 
     VkImageSubresourceRange ImageSubresourceRange(VkImageAspectFlags aspectMask);
-    VkSemaphoreSubmitInfo SemaphoreSubmitInfo(VkPipelineStageFlags2 stageMask, VkSemaphore semaphore);
+    VkSemaphoreSubmitInfo SemaphoreSubmitInfo(VkPipelineStageFlags2 stageMask, VkSemaphore semaphore, uint64_t value = 0);
 
     VkDescriptorSetLayoutBinding DescSetLayoutBinding(VkDescriptorType type, VkShaderStageFlags stageFlags, uint32_t binding);
 
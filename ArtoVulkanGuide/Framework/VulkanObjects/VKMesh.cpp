@@ -1,55 +1,11 @@
 #include <iostream>
+#include <cmath>
+#include <cstring>
 #include <tiny_obj_loader.h>
+#include <glm/gtc/constants.hpp>
 
 #include "VKMesh.hpp"
 
-VertexInputDesc Vertex::GetVertexDesc()
-{
-    VertexInputDesc viDesc;
-
-    VkVertexInputBindingDescription mainBinding = {};
-    mainBinding.binding = 0;
-    mainBinding.stride = sizeof(Vertex);
-    mainBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-    viDesc.mBindings.push_back(mainBinding);
-
-    //Position will be stored at Location 0
-    VkVertexInputAttributeDescription positionAttribute = {};
-    positionAttribute.binding = 0;
-    positionAttribute.location = 0;
-    positionAttribute.format = VK_FORMAT_R32G32B32_SFLOAT;
-    positionAttribute.offset = offsetof(Vertex, mPosition);
-
-    // Normal will be stored at Location 1
-    VkVertexInputAttributeDescription normalAttribute = {};
-    normalAttribute.binding = 0;
-    normalAttribute.location = 1;
-    normalAttribute.format = VK_FORMAT_R32G32B32_SFLOAT;
-    normalAttribute.offset = offsetof(Vertex, mNormal);
-
-    // Position will be stored at Location 2
-    VkVertexInputAttributeDescription colorAttribute = {};
-    colorAttribute.binding = 0;
-    colorAttribute.location = 2;
-    colorAttribute.format = VK_FORMAT_R32G32B32_SFLOAT;
-    colorAttribute.offset = offsetof(Vertex, mColor);
-
-    // UV will be stored at Location 3
-    VkVertexInputAttributeDescription uvAttribute = {};
-    uvAttribute.binding = 0;
-    uvAttribute.location = 3;
-    uvAttribute.format = VK_FORMAT_R32G32_SFLOAT;
-    uvAttribute.offset = offsetof(Vertex, mUV);
-
-    viDesc.mAttributes.push_back(positionAttribute);
-    viDesc.mAttributes.push_back(normalAttribute);
-    viDesc.mAttributes.push_back(colorAttribute);
-    viDesc.mAttributes.push_back(uvAttribute);
-
-    return viDesc;
-}
-
 bool Mesh::LoadFromOBJ(const char* filename)
 {
     tinyobj::attrib_t attrib;
@@ -105,5 +61,111 @@ bool Mesh::LoadFromOBJ(const char* filename)
             indexOffset += fv;
         }
     }
+
+    size_t soupVertices = mVertices.size();
+    Weld();
+    std::cout << "Loaded " << filename << ": " << soupVertices << " -> " << mVertices.size() << " vertices, "
+        << soupVertices * sizeof(Vertex) / 1024 << "KB -> "
+        << (mVertices.size() * sizeof(Vertex) + mIndices.size() * (GetIndexType() == VK_INDEX_TYPE_UINT16 ? 2 : 4)) / 1024
+        << "KB with " << (GetIndexType() == VK_INDEX_TYPE_UINT16 ? 16 : 32) << " bit indices" << std::endl;
     return true;
+}
+
+void Mesh::BuildSphere(uint32_t rings, uint32_t segments, const glm::vec3& color)
+{
+    auto pointAt = [&](uint32_t ring, uint32_t segment)
+    {
+        float theta = glm::pi<float>() * (float)ring / (float)rings;
+        float phi = glm::two_pi<float>() * (float)segment / (float)segments;
+
+        Vertex vert{};
+        vert.mNormal = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+        vert.mPosition = vert.mNormal;
+        vert.mColor = color;
+        vert.mUV = glm::vec2((float)segment / (float)segments, (float)ring / (float)rings);
+        return vert;
+    };
+
+    // 每个格子两个三角形，先生成三角形列表，最后合并共享的顶点
+    mVertices.clear();
+    mVertices.reserve(rings * segments * 6);
+    for (uint32_t r = 0; r < rings; r++)
+    {
+        for (uint32_t s = 0; s < segments; s++)
+        {
+            Vertex v00 = pointAt(r, s);
+            Vertex v01 = pointAt(r, s + 1);
+            Vertex v10 = pointAt(r + 1, s);
+            Vertex v11 = pointAt(r + 1, s + 1);
+
+            mVertices.push_back(v00);
+            mVertices.push_back(v10);
+            mVertices.push_back(v11);
+            mVertices.push_back(v00);
+            mVertices.push_back(v11);
+            mVertices.push_back(v01);
+        }
+    }
+    Weld();
+}
+
+void Mesh::Weld()
+{
+    // Vertex和资源里的VertexF32PNCV都是11个float，布局相同，和烘焙时用同一份合并
+    static_assert(sizeof(Vertex) == sizeof(Assets::VertexF32PNCV), "Vertex layout must match VertexF32PNCV");
+    if (!mIndices.empty()) return;
+
+    mIndices.resize(mVertices.size());
+    size_t uniqueCount = Assets::WeldVertices(reinterpret_cast<Assets::VertexF32PNCV*>(mVertices.data()), mVertices.size(), mIndices.data());
+    mVertices.resize(uniqueCount);
+    mVertices.shrink_to_fit();
+}
+
+void Mesh::SplitStreams(std::vector<VertexPosition>& outPositions, std::vector<VertexAttributes>& outAttributes) const
+{
+    outPositions.resize(mVertices.size());
+    outAttributes.resize(mVertices.size());
+    for (size_t i = 0; i < mVertices.size(); i++)
+    {
+        const Vertex& vertex = mVertices[i];
+        outPositions[i].mPosition = vertex.mPosition;
+        outAttributes[i].mNormal = vertex.mNormal;
+        outAttributes[i].mColor = vertex.mColor;
+        outAttributes[i].mUV = vertex.mUV;
+    }
+}
+
+void Mesh::CalculateBounds()
+{
+    // Vertex和资源里的VertexF32PNCV都是11个float，布局相同
+    static_assert(sizeof(Vertex) == sizeof(Assets::VertexF32PNCV), "Vertex layout must match VertexF32PNCV");
+    mBounds = Assets::CalculateBounds(reinterpret_cast<Assets::VertexF32PNCV*>(mVertices.data()), mVertices.size());
+}
+
+void Mesh::BuildMeshlets()
+{
+    size_t indexCount = mLods.empty() ? mIndices.size() : mLods[0].mIndexCount;
+    mMeshlets = Assets::BuildMeshlets(reinterpret_cast<const Assets::VertexF32PNCV*>(mVertices.data()), mVertices.size(), mIndices.data(), indexCount);
+}
+
+void Mesh::BuildLods()
+{
+    mLods = Assets::BuildLods(reinterpret_cast<const Assets::VertexF32PNCV*>(mVertices.data()), mVertices.size(), mIndices);
+    std::cout << "LOD chain: " << mLods.size() << " levels, " << mLods.front().mIndexCount / 3 << " -> " << mLods.back().mIndexCount / 3 << " triangles" << std::endl;
+}
+
+uint32_t Mesh::SelectLod(float projectedRadius, float maxPixelError) const
+{
+    if (mLods.size() <= 1 || maxPixelError <= 0.0f || mBounds.mRadius <= 0.0f)
+    {
+        return 0;
+    }
+    // 误差是模型空间的距离，按包围球半径换算成屏幕像素
+    float pixelsPerUnit = projectedRadius / mBounds.mRadius;
+    uint32_t lod = 0;
+    while (lod + 1 < mLods.size() && mLods[lod + 1].mError * pixelsPerUnit <= maxPixelError)
+    {
+        lod++;
+    }
+    return lod;
 }
\ No newline at end of file
@@ -1,33 +1,140 @@
 #pragma once
 
+#include <array>
 #include <vector>
+#include <cstddef>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 
 #include "VKTypes.hpp"
+#include "VKGeometryBuffer.hpp"
+#include "AssetsLoader/MeshAsset.hpp"
 
-struct VertexInputDesc
+// CPU端加载、合并和计算包围盒用的交错顶点，上传时拆成下面的两路流
+struct Vertex
 {
-    std::vector<VkVertexInputBindingDescription> mBindings;
-    std::vector<VkVertexInputAttributeDescription> mAttributes;
-
-    VkPipelineVertexInputStateCreateFlags mFlags = 0;
+    glm::vec3 mPosition;
+    glm::vec3 mNormal;
+    glm::vec3 mColor;
+    glm::vec2 mUV;
 };
 
-struct Vertex
+// 第0路流只有位置，深度、阴影和剔除每个顶点只读12字节
+struct VertexPosition
 {
-    static VertexInputDesc GetVertexDesc();
-
     glm::vec3 mPosition;
+};
+
+// 第1路流是着色用的其他属性
+struct VertexAttributes
+{
     glm::vec3 mNormal;
     glm::vec3 mColor;
     glm::vec2 mUV;
 };
 
+enum VertexStream : uint32_t
+{
+    VERTEX_STREAM_POSITION = 0,
+    VERTEX_STREAM_ATTRIBUTES = 1,
+    VERTEX_STREAM_COUNT = 2,
+};
+
+constexpr uint32_t VERTEX_STREAM_STRIDES[VERTEX_STREAM_COUNT] = { sizeof(VertexPosition), sizeof(VertexAttributes) };
+
+// 属性类型对应的顶点格式
+template<typename T> struct VertexFormatOf;
+template<> struct VertexFormatOf<float> { static constexpr VkFormat value = VK_FORMAT_R32_SFLOAT; };
+template<> struct VertexFormatOf<glm::vec2> { static constexpr VkFormat value = VK_FORMAT_R32G32_SFLOAT; };
+template<> struct VertexFormatOf<glm::vec3> { static constexpr VkFormat value = VK_FORMAT_R32G32B32_SFLOAT; };
+template<> struct VertexFormatOf<glm::vec4> { static constexpr VkFormat value = VK_FORMAT_R32G32B32A32_SFLOAT; };
+
+template<typename Stream>
+constexpr VkVertexInputBindingDescription VertexBinding(uint32_t binding)
+{
+    return { binding, sizeof(Stream), VK_VERTEX_INPUT_RATE_VERTEX };
+}
+
+template<typename T>
+constexpr VkVertexInputAttributeDescription VertexAttribute(uint32_t location, uint32_t binding, uint32_t offset)
+{
+    return { location, binding, VertexFormatOf<T>::value, offset };
+}
+
+// 编译期生成的顶点布局，数组是常量，创建Pipeline时直接指向它们
+template<size_t BindingCount, size_t AttributeCount>
+struct VertexLayout
+{
+    std::array<VkVertexInputBindingDescription, BindingCount> mBindings;
+    std::array<VkVertexInputAttributeDescription, AttributeCount> mAttributes;
+
+    VkPipelineVertexInputStateCreateInfo GetVIState() const
+    {
+        VkPipelineVertexInputStateCreateInfo viState = {};
+        viState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        viState.pNext = nullptr;
+        viState.vertexBindingDescriptionCount = (uint32_t)BindingCount;
+        viState.pVertexBindingDescriptions = mBindings.data();
+        viState.vertexAttributeDescriptionCount = (uint32_t)AttributeCount;
+        viState.pVertexAttributeDescriptions = mAttributes.data();
+        return viState;
+    }
+};
+
+// Shader里的location：0位置，1法线，2颜色，3UV
+namespace VertexLayouts
+{
+    inline constexpr VertexLayout<2, 4> Full {
+        {{ VertexBinding<VertexPosition>(VERTEX_STREAM_POSITION), VertexBinding<VertexAttributes>(VERTEX_STREAM_ATTRIBUTES) }},
+        {{
+            VertexAttribute<glm::vec3>(0, VERTEX_STREAM_POSITION, offsetof(VertexPosition, mPosition)),
+            VertexAttribute<glm::vec3>(1, VERTEX_STREAM_ATTRIBUTES, offsetof(VertexAttributes, mNormal)),
+            VertexAttribute<glm::vec3>(2, VERTEX_STREAM_ATTRIBUTES, offsetof(VertexAttributes, mColor)),
+            VertexAttribute<glm::vec2>(3, VERTEX_STREAM_ATTRIBUTES, offsetof(VertexAttributes, mUV)),
+        }}
+    };
+
+    // 深度和阴影Pass只绑定位置流
+    inline constexpr VertexLayout<1, 1> PositionOnly {
+        {{ VertexBinding<VertexPosition>(VERTEX_STREAM_POSITION) }},
+        {{ VertexAttribute<glm::vec3>(0, VERTEX_STREAM_POSITION, offsetof(VertexPosition, mPosition)) }}
+    };
+}
+
 struct Mesh
 {
     bool LoadFromOBJ(const char* filename);
+    // 生成单位球，rings是纬度方向的段数，segments是经度方向的段数
+    void BuildSphere(uint32_t rings, uint32_t segments, const glm::vec3& color);
+    // 用顶点计算局部空间的包围球和AABB，顶点变化后需要重新调用
+    void CalculateBounds();
+    // 把索引后的三角形分成Meshlet，需要在Weld之后
+    void BuildMeshlets();
+    // 用简化生成LOD链，简化后的索引接在mIndices后面，需要在Weld之后
+    void BuildLods();
+    // 没有简化时整个索引就是唯一的LOD
+    void SetSingleLod() { mLods = { { 0, static_cast<uint32_t>(mIndices.size()), 0.0f } }; }
+    // 屏幕上误差不超过maxPixelError的最粗的LOD，projectedRadius是包围球投影到屏幕上的像素半径
+    uint32_t SelectLod(float projectedRadius, float maxPixelError) const;
+    // 把没有索引的三角形列表合并相同的顶点，生成索引
+    void Weld();
+    // 把交错的顶点拆成位置流和属性流
+    void SplitStreams(std::vector<VertexPosition>& outPositions, std::vector<VertexAttributes>& outAttributes) const;
+    // 顶点数在16位范围内时用16位索引
+    VkIndexType GetIndexType() const { return mVertices.size() < UINT16_MAX ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32; }
 
     std::vector<Vertex> mVertices;
-    AllocatedBuffer mVertexBuffer;
+    // 三个一组的三角形，上传时按GetIndexType转换
+    std::vector<uint32_t> mIndices;
+    // 在共用的GeometryBuffer里的位置，上传时分配
+    GeometryRange mGeometry {};
+    Assets::MeshBounds mBounds {};
+    // 只在开启Meshlet剔除时生成，下标是mVertices里的顶点，只覆盖LOD0
+    Assets::MeshletData mMeshlets;
+    // mIndices里每一级LOD的范围，第0级是原始网格
+    std::vector<Assets::MeshLod> mLods;
+    // 上传时分配，用于排序Key
+    uint32_t mID = 0;
+    // 在ResidencyManager里的句柄，没有登记时是RESIDENCY_INVALID_HANDLE
+    uint32_t mResidency = UINT32_MAX;
 };
\ No newline at end of file
@@ -2,8 +2,16 @@
 
 #include "VKPipeline.hpp"
 
-VkPipeline PipelineBuilder::BuildPipeline(VkDevice device, VkRenderPass renderPass)
+VkPipeline PipelineBuilder::BuildPipeline(VkDevice device, VkPipelineCache cache)
 {
+    VkPipelineRenderingCreateInfo renderingCI {};
+    renderingCI.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingCI.pNext = nullptr;
+    renderingCI.colorAttachmentCount = mColorFormat != VK_FORMAT_UNDEFINED ? 1 : 0;
+    renderingCI.pColorAttachmentFormats = &mColorFormat;
+    renderingCI.depthAttachmentFormat = mDepthFormat;
+    renderingCI.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+
     VkPipelineViewportStateCreateInfo vpStateCI {};
     vpStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     vpStateCI.pNext = nullptr;
@@ -12,18 +20,24 @@ VkPipeline PipelineBuilder::BuildPipeline(VkDevice device, VkRenderPass renderPa
     vpStateCI.scissorCount = 1;
     vpStateCI.pScissors = &mScissor;
 
+    VkPipelineDynamicStateCreateInfo dynStateCI {};
+    dynStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynStateCI.pNext = nullptr;
+    dynStateCI.dynamicStateCount = static_cast<uint32_t>(mDynamicStates.size());
+    dynStateCI.pDynamicStates = mDynamicStates.data();
+
     // 暂时不用Color Blending，设一个占位
     VkPipelineColorBlendStateCreateInfo cbStateCI {};
     cbStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
     cbStateCI.pNext = nullptr;
     cbStateCI.logicOpEnable = VK_FALSE;
     cbStateCI.logicOp = VK_LOGIC_OP_COPY;
-    cbStateCI.attachmentCount = 1;
+    cbStateCI.attachmentCount = renderingCI.colorAttachmentCount;
     cbStateCI.pAttachments = &mCBAttach;
 
     VkGraphicsPipelineCreateInfo pipelineCI{};
     pipelineCI.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineCI.pNext = nullptr;
+    pipelineCI.pNext = &renderingCI;
     pipelineCI.stageCount = static_cast<uint32_t>(mShaderStageCIs.size());
     pipelineCI.pStages = mShaderStageCIs.data();
     pipelineCI.pVertexInputState = &mVIState;
@@ -33,14 +47,15 @@ VkPipeline PipelineBuilder::BuildPipeline(VkDevice device, VkRenderPass renderPa
     pipelineCI.pMultisampleState = &mMSState;
     pipelineCI.pColorBlendState = &cbStateCI;
     pipelineCI.pDepthStencilState = &mDSState;
+    pipelineCI.pDynamicState = mDynamicStates.empty() ? nullptr : &dynStateCI;
     pipelineCI.layout = mPipelineLayout;
-    pipelineCI.renderPass = renderPass;
+    pipelineCI.renderPass = VK_NULL_HANDLE;
     pipelineCI.subpass = 0;
     pipelineCI.basePipelineHandle = VK_NULL_HANDLE;
 
     VkPipeline newPipeline;
     if (vkCreateGraphicsPipelines(
-        device, VK_NULL_HANDLE, 1, &pipelineCI, nullptr, &newPipeline) != VK_SUCCESS)
+        device, cache, 1, &pipelineCI, nullptr, &newPipeline) != VK_SUCCESS)
     {
         std::cout << "Fail to create pipeline\n";
         return VK_NULL_HANDLE;
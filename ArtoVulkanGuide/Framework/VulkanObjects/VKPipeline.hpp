@@ -7,7 +7,9 @@
 class PipelineBuilder
 {
 public:
-    VkPipeline BuildPipeline(VkDevice device, VkRenderPass renderPass);
+    // 使用Dynamic Rendering，不需要RenderPass，只需要Attachment的格式
+    // cache不为空时先查缓存，命中就不需要重新编译着色器
+    VkPipeline BuildPipeline(VkDevice device, VkPipelineCache cache = VK_NULL_HANDLE);
 
 public:
     std::vector<VkPipelineShaderStageCreateInfo> mShaderStageCIs;
@@ -20,4 +22,8 @@ public:
     VkPipelineMultisampleStateCreateInfo         mMSState;
     VkPipelineDepthStencilStateCreateInfo        mDSState;
     VkPipelineLayout                             mPipelineLayout;
+    VkFormat                                     mColorFormat = VK_FORMAT_UNDEFINED;
+    VkFormat                                     mDepthFormat = VK_FORMAT_UNDEFINED;
+    // 动态状态里的Viewport/Scissor会忽略上面的值
+    std::vector<VkDynamicState>                  mDynamicStates;
 };
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "VKPipelineCache.hpp"
+
+#include <Tracy.hpp>
+
+void PipelineCache::Init(VkDevice device, const VkPhysicalDeviceProperties& props, const std::string& pathPrefix)
+{
+    ZoneScoped;
+    mDevice = device;
+    mProps = props;
+    mLoadedBytes = 0;
+
+    std::vector<char> data;
+    if (!pathPrefix.empty())
+    {
+        char ids[32];
+        snprintf(ids, sizeof(ids), "_%04x_%04x.bin", mProps.vendorID, mProps.deviceID);
+        mPath = pathPrefix + ids;
+
+        std::ifstream file(mPath, std::ios::binary | std::ios::ate);
+        const size_t fileSize = file.is_open() ? (size_t)file.tellg() : 0;
+        FileHeader header {};
+        if (fileSize >= sizeof(header) && file.seekg(0) && file.read((char*)&header, sizeof(header)))
+        {
+            // 先确认长度和文件一致，损坏的头不会分配过大的内存
+            if (header.mDataSize == fileSize - sizeof(header))
+            {
+                data.resize(header.mDataSize);
+            }
+            if (data.empty() || !file.read(data.data(), (std::streamsize)data.size()) || !isValid(header, data))
+            {
+                std::cout << "Pipeline cache " << mPath << " is stale or corrupted, starting from an empty cache" << std::endl;
+                data.clear();
+            }
+        }
+    }
+
+    VkPipelineCacheCreateInfo cacheCI {};
+    cacheCI.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheCI.pNext = nullptr;
+    cacheCI.flags = 0;
+    cacheCI.initialDataSize = data.size();
+    cacheCI.pInitialData = data.empty() ? nullptr : data.data();
+    // 驱动仍然可能拒绝数据，这时退回空缓存
+    if (vkCreatePipelineCache(mDevice, &cacheCI, nullptr, &mCache) != VK_SUCCESS)
+    {
+        cacheCI.initialDataSize = 0;
+        cacheCI.pInitialData = nullptr;
+        data.clear();
+        VK_CHECK(vkCreatePipelineCache(mDevice, &cacheCI, nullptr, &mCache));
+    }
+    mLoadedBytes = data.size();
+}
+
+void PipelineCache::Destroy()
+{
+    vkDestroyPipelineCache(mDevice, mCache, nullptr);
+    mCache = VK_NULL_HANDLE;
+}
+
+bool PipelineCache::Save()
+{
+    ZoneScoped;
+    if (mPath.empty() || mCache == VK_NULL_HANDLE) return false;
+
+    size_t dataSize = 0;
+    VK_CHECK(vkGetPipelineCacheData(mDevice, mCache, &dataSize, nullptr));
+    std::vector<char> data(dataSize);
+    VK_CHECK(vkGetPipelineCacheData(mDevice, mCache, &dataSize, data.data()));
+
+    FileHeader header {};
+    fillHeader(header, (uint32_t)dataSize);
+
+    // 先写临时文件再改名，写到一半退出也不会留下损坏的缓存
+    std::string tempPath = mPath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open() ||
+            !file.write((const char*)&header, sizeof(header)) ||
+            !file.write(data.data(), (std::streamsize)dataSize))
+        {
+            std::cout << "Fail to write pipeline cache " << tempPath << std::endl;
+            return false;
+        }
+    }
+    std::remove(mPath.c_str());
+    if (std::rename(tempPath.c_str(), mPath.c_str()) != 0)
+    {
+        std::cout << "Fail to rename pipeline cache to " << mPath << std::endl;
+        return false;
+    }
+
+    std::cout << "Pipeline cache: saved " << dataSize << " bytes to " << mPath << std::endl;
+    return true;
+}
+
+void PipelineCache::fillHeader(FileHeader& header, uint32_t dataSize) const
+{
+    header.mMagic = FILE_MAGIC;
+    header.mDataSize = dataSize;
+    header.mVendorID = mProps.vendorID;
+    header.mDeviceID = mProps.deviceID;
+    header.mDriverVersion = mProps.driverVersion;
+    memcpy(header.mUUID, mProps.pipelineCacheUUID, VK_UUID_SIZE);
+}
+
+bool PipelineCache::isValid(const FileHeader& header, const std::vector<char>& data) const
+{
+    FileHeader expected {};
+    fillHeader(expected, header.mDataSize);
+    if (memcmp(&header, &expected, sizeof(FileHeader)) != 0) return false;
+
+    // 数据本身以VkPipelineCacheHeaderVersionOne开头，驱动升级后UUID会变
+    VkPipelineCacheHeaderVersionOne cacheHeader {};
+    if (data.size() < sizeof(cacheHeader)) return false;
+    memcpy(&cacheHeader, data.data(), sizeof(cacheHeader));
+    return cacheHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        cacheHeader.vendorID == mProps.vendorID &&
+        cacheHeader.deviceID == mProps.deviceID &&
+        memcmp(cacheHeader.pipelineCacheUUID, mProps.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "VKTypes.hpp"
+
+// 启动时从文件读取VkPipelineCache的数据，退出时写回，第二次启动不需要重新编译Pipeline
+// 文件名里带Vendor和Device ID，不同显卡的缓存互不覆盖
+// 文件头记录设备、驱动版本和pipelineCacheUUID，任何一项不同都丢弃旧数据，从空缓存开始
+class PipelineCache
+{
+public:
+    // pathPrefix为空时只在内存里缓存，不读也不写文件
+    void Init(VkDevice device, const VkPhysicalDeviceProperties& props, const std::string& pathPrefix);
+    void Destroy();
+    // 设备空闲时调用，把这次运行新增的Pipeline一起写回文件
+    bool Save();
+
+    VkPipelineCache GetCache() const { return mCache; }
+    // 从文件读到了有效数据
+    bool IsWarm() const { return mLoadedBytes > 0; }
+    size_t GetLoadedBytes() const { return mLoadedBytes; }
+    const std::string& GetPath() const { return mPath; }
+
+private:
+    // 文件开头，后面紧跟vkGetPipelineCacheData的数据
+    struct FileHeader
+    {
+        uint32_t mMagic;
+        uint32_t mDataSize;
+        uint32_t mVendorID;
+        uint32_t mDeviceID;
+        uint32_t mDriverVersion;
+        uint8_t mUUID[VK_UUID_SIZE];
+    };
+
+    static constexpr uint32_t FILE_MAGIC = 0x48435041; // "APCH"
+
+    void fillHeader(FileHeader& header, uint32_t dataSize) const;
+    // 检查文件头和数据里Vulkan自己的头，都和当前设备一致才使用
+    bool isValid(const FileHeader& header, const std::vector<char>& data) const;
+
+private:
+    VkDevice mDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties mProps {};
+    VkPipelineCache mCache = VK_NULL_HANDLE;
+    std::string mPath;
+    size_t mLoadedBytes = 0;
+};
\ No newline at end of file
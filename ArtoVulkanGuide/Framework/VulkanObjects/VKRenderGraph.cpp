@@ -0,0 +1,587 @@
+#include <algorithm>
+
+#include "VKRenderGraph.hpp"
+#include "VKInitializers.hpp"
+
+#include <Tracy.hpp>
+
+constexpr uint32_t MAX_COLOR_ATTACHMENTS = 8;
+
+struct RGAccessInfo
+{
+    VkPipelineStageFlags2 mStage;
+    VkAccessFlags2 mAccess;
+    // 只有写的Access，为0表示只读
+    VkAccessFlags2 mWriteAccess;
+    VkImageLayout mLayout;
+};
+
+static RGAccessInfo GetAccessInfo(RGAccess access)
+{
+    switch (access)
+    {
+    case RGAccess::ColorAttachment:
+        return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                 VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                 VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                 VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+    case RGAccess::DepthAttachment:
+        return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                 VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                 VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                 VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL };
+    case RGAccess::DepthRead:
+        return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                 VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                 VK_ACCESS_2_NONE,
+                 VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL };
+    case RGAccess::FragmentSampled:
+        return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+                 VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+                 VK_ACCESS_2_NONE,
+                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    case RGAccess::ComputeSampled:
+        return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                 VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+                 VK_ACCESS_2_NONE,
+                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    case RGAccess::ComputeStorageRead:
+        return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                 VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+                 VK_ACCESS_2_NONE,
+                 VK_IMAGE_LAYOUT_GENERAL };
+    case RGAccess::ComputeStorageWrite:
+        return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                 VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                 VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                 VK_IMAGE_LAYOUT_GENERAL };
+    case RGAccess::TransferSrc:
+        return { VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_BLIT_BIT,
+                 VK_ACCESS_2_TRANSFER_READ_BIT,
+                 VK_ACCESS_2_NONE,
+                 VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+    case RGAccess::TransferDst:
+        return { VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_BLIT_BIT | VK_PIPELINE_STAGE_2_CLEAR_BIT,
+                 VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                 VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL };
+    }
+    return { VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT, VK_ACCESS_2_MEMORY_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL };
+}
+
+static bool IsAttachment(RGAccess access)
+{
+    return access == RGAccess::ColorAttachment || access == RGAccess::DepthAttachment || access == RGAccess::DepthRead;
+}
+
+RGPass& RGPass::Color(RGHandle image)
+{
+    mUses.push_back({ image, RGAccess::ColorAttachment });
+    return *this;
+}
+
+RGPass& RGPass::Depth(RGHandle image, bool bWrite)
+{
+    mUses.push_back({ image, bWrite ? RGAccess::DepthAttachment : RGAccess::DepthRead });
+    return *this;
+}
+
+RGPass& RGPass::Read(RGHandle image, RGAccess access)
+{
+    mUses.push_back({ image, access });
+    return *this;
+}
+
+RGPass& RGPass::Write(RGHandle image, RGAccess access)
+{
+    mUses.push_back({ image, access });
+    return *this;
+}
+
+RGPass& RGPass::Secondary()
+{
+    mbSecondary = true;
+    return *this;
+}
+
+void RenderGraph::Init(VkDevice device, VmaAllocator allocator)
+{
+    mDevice = device;
+    mAllocator = allocator;
+}
+
+void RenderGraph::Destroy()
+{
+    destroyTransients();
+    mImages.clear();
+    mPasses.clear();
+}
+
+RGHandle RenderGraph::ImportImage(const std::string& name, VkFormat format, VkExtent2D extent, VkImageAspectFlags aspect, const RGImageState& initialState, const RGImageState& finalState)
+{
+    Image image {};
+    image.mName = name;
+    image.mFormat = format;
+    image.mExtent = extent;
+    image.mRenderExtent = extent;
+    image.mUsage = 0;
+    image.mAspect = aspect;
+    image.mbImported = true;
+    image.mInitialState = initialState;
+    image.mFinalState = finalState;
+
+    mImages.push_back(image);
+    return static_cast<RGHandle>(mImages.size() - 1);
+}
+
+void RenderGraph::SetImportedImage(RGHandle handle, VkImage image, VkImageView view)
+{
+    mImages[handle].mImage = image;
+    mImages[handle].mView = view;
+}
+
+RGHandle RenderGraph::CreateImage(const std::string& name, VkFormat format, VkExtent2D extent, VkImageUsageFlags usage, VkImageAspectFlags aspect)
+{
+    Image image {};
+    image.mName = name;
+    image.mFormat = format;
+    image.mExtent = extent;
+    image.mRenderExtent = extent;
+    image.mUsage = usage;
+    image.mAspect = aspect;
+    image.mbImported = false;
+
+    mImages.push_back(image);
+    return static_cast<RGHandle>(mImages.size() - 1);
+}
+
+void RenderGraph::SetClearValue(RGHandle handle, VkClearValue clearValue)
+{
+    mImages[handle].mbClear = true;
+    mImages[handle].mClearValue = clearValue;
+}
+
+void RenderGraph::SetRenderExtent(RGHandle handle, VkExtent2D extent)
+{
+    mImages[handle].mRenderExtent = extent;
+}
+
+RGPass& RenderGraph::AddPass(const std::string& name, std::function<void(const RGPassContext&)>&& execute)
+{
+    RGPass pass {};
+    pass.mName = name;
+    pass.mExecute = std::move(execute);
+
+    mPasses.push_back(std::move(pass));
+    return mPasses.back();
+}
+
+void RenderGraph::Compile()
+{
+    ZoneScoped;
+    computeLifetimes();
+    allocateTransients();
+    computeBarriers();
+}
+
+void RenderGraph::Execute(VkCommandBuffer cmdBuffer)
+{
+    mBarrierCount = 0;
+
+    for (auto & pass : mPasses)
+    {
+        recordBarriers(cmdBuffer, pass.mBarriers);
+
+        if (pass.mColorAttachments.empty() && pass.mDepthAttachment.mImage == RG_INVALID_HANDLE)
+        {
+            RGPassContext context { cmdBuffer, nullptr };
+            pass.mExecute(context);
+            continue;
+        }
+
+        VkRenderingAttachmentInfo colorInfos[MAX_COLOR_ATTACHMENTS];
+        uint32_t colorCount = static_cast<uint32_t>(pass.mColorAttachments.size());
+        VkExtent2D extent {};
+        for (uint32_t i = 0; i < colorCount; i++)
+        {
+            const RGPass::Attachment& attachment = pass.mColorAttachments[i];
+            const Image& image = mImages[attachment.mImage];
+
+            colorInfos[i] = VKInit::ColorAttachmentInfo(image.mView, image.mClearValue, attachment.mLayout);
+            colorInfos[i].loadOp = attachment.mLoadOp;
+            colorInfos[i].storeOp = attachment.mStoreOp;
+            extent = image.mRenderExtent;
+        }
+
+        VkRenderingAttachmentInfo depthInfo {};
+        bool bHasDepth = pass.mDepthAttachment.mImage != RG_INVALID_HANDLE;
+        if (bHasDepth)
+        {
+            const RGPass::Attachment& attachment = pass.mDepthAttachment;
+            const Image& image = mImages[attachment.mImage];
+
+            depthInfo = VKInit::DepthAttachmentInfo(image.mView, attachment.mLayout);
+            depthInfo.loadOp = attachment.mLoadOp;
+            depthInfo.storeOp = attachment.mStoreOp;
+            depthInfo.clearValue = image.mClearValue;
+            if (colorCount == 0) extent = image.mRenderExtent;
+        }
+
+        VkRenderingInfo renderingInfo = VKInit::RenderingInfo(extent, colorCount > 0 ? colorInfos : nullptr, bHasDepth ? &depthInfo : nullptr);
+        renderingInfo.colorAttachmentCount = colorCount;
+
+        VkCommandBufferInheritanceRenderingInfo inheritanceRendering {};
+        VkCommandBufferInheritanceInfo inheritance {};
+        if (pass.mbSecondary)
+        {
+            renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+
+            inheritanceRendering = VKInit::CmdBufferInheritanceRenderingInfo(
+                colorCount, pass.mColorFormats.data(),
+                bHasDepth ? mImages[pass.mDepthAttachment.mImage].mFormat : VK_FORMAT_UNDEFINED);
+            inheritance = VKInit::CmdBufferInheritanceInfo(VK_NULL_HANDLE, VK_NULL_HANDLE);
+            inheritance.pNext = &inheritanceRendering;
+        }
+
+        vkCmdBeginRendering(cmdBuffer, &renderingInfo);
+
+        RGPassContext context { cmdBuffer, pass.mbSecondary ? &inheritance : nullptr };
+        pass.mExecute(context);
+
+        vkCmdEndRendering(cmdBuffer);
+    }
+
+    recordBarriers(cmdBuffer, mFinalBarriers);
+}
+
+void RenderGraph::computeLifetimes()
+{
+    for (auto & image : mImages)
+    {
+        image.mFirstPass = UINT32_MAX;
+        image.mLastPass = 0;
+    }
+
+    for (uint32_t i = 0; i < mPasses.size(); i++)
+    {
+        for (auto & use : mPasses[i].mUses)
+        {
+            Image& image = mImages[use.mImage];
+            image.mFirstPass = std::min(image.mFirstPass, i);
+            image.mLastPass = std::max(image.mLastPass, i);
+        }
+    }
+}
+
+void RenderGraph::allocateTransients()
+{
+    destroyTransients();
+
+    mTransientMemory = 0;
+    mTransientMemoryUnaliased = 0;
+
+    std::vector<VkMemoryRequirements> requirements(mImages.size());
+    std::vector<RGHandle> transients;
+    for (RGHandle handle = 0; handle < mImages.size(); handle++)
+    {
+        Image& image = mImages[handle];
+        // 没有Pass使用的内部Image不分配
+        if (image.mbImported || image.mFirstPass == UINT32_MAX) continue;
+
+        VkExtent3D extent = { image.mExtent.width, image.mExtent.height, 1 };
+        VkImageCreateInfo imageCI = VKInit::ImageCreateInfo(image.mFormat, image.mUsage, extent);
+        VK_CHECK(vkCreateImage(mDevice, &imageCI, nullptr, &image.mImage));
+
+        vkGetImageMemoryRequirements(mDevice, image.mImage, &requirements[handle]);
+        mTransientMemoryUnaliased += requirements[handle].size;
+        transients.push_back(handle);
+    }
+
+    // 从大到小放进显存块，生命周期不重叠并且内存类型兼容的Image共用一块
+    std::sort(transients.begin(), transients.end(), [&](RGHandle a, RGHandle b)
+    {
+        return requirements[a].size > requirements[b].size;
+    });
+
+    for (RGHandle handle : transients)
+    {
+        Image& image = mImages[handle];
+        const VkMemoryRequirements& req = requirements[handle];
+
+        for (uint32_t b = 0; b < mMemoryBlocks.size() && image.mMemoryBlock == UINT32_MAX; b++)
+        {
+            MemoryBlock& block = mMemoryBlocks[b];
+            if ((block.mRequirements.memoryTypeBits & req.memoryTypeBits) == 0) continue;
+
+            bool bOverlap = false;
+            for (RGHandle other : block.mImages)
+            {
+                const Image& otherImage = mImages[other];
+                if (image.mFirstPass <= otherImage.mLastPass && otherImage.mFirstPass <= image.mLastPass)
+                {
+                    bOverlap = true;
+                    break;
+                }
+            }
+            if (bOverlap) continue;
+
+            block.mRequirements.size = std::max(block.mRequirements.size, req.size);
+            block.mRequirements.alignment = std::max(block.mRequirements.alignment, req.alignment);
+            block.mRequirements.memoryTypeBits &= req.memoryTypeBits;
+            block.mImages.push_back(handle);
+            image.mMemoryBlock = b;
+        }
+
+        if (image.mMemoryBlock == UINT32_MAX)
+        {
+            MemoryBlock block {};
+            block.mRequirements = req;
+            block.mImages.push_back(handle);
+            image.mMemoryBlock = static_cast<uint32_t>(mMemoryBlocks.size());
+            mMemoryBlocks.push_back(block);
+        }
+    }
+
+    VmaAllocationCreateInfo vmaAllocCI {};
+    vmaAllocCI.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    vmaAllocCI.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    for (auto & block : mMemoryBlocks)
+    {
+        VK_CHECK(vmaAllocateMemory(mAllocator, &block.mRequirements, &vmaAllocCI, &block.mAllocation, nullptr));
+        mTransientMemory += block.mRequirements.size;
+
+        // 同一块里按使用顺序串起来，第一个Image接在上一帧最后一个后面
+        std::sort(block.mImages.begin(), block.mImages.end(), [&](RGHandle a, RGHandle b)
+        {
+            return mImages[a].mFirstPass < mImages[b].mFirstPass;
+        });
+
+        for (size_t i = 0; i < block.mImages.size(); i++)
+        {
+            Image& image = mImages[block.mImages[i]];
+            image.mAliasPrev = block.mImages[i == 0 ? block.mImages.size() - 1 : i - 1];
+
+            VK_CHECK(vmaBindImageMemory(mAllocator, block.mAllocation, image.mImage));
+
+            VkImageViewCreateInfo viewCI = VKInit::ImageViewCreateInfo(image.mFormat, image.mImage, image.mAspect);
+            VK_CHECK(vkCreateImageView(mDevice, &viewCI, nullptr, &image.mView));
+        }
+    }
+
+    std::cout << "Render graph transient memory: " << mTransientMemory / 1024 << " KB ("
+        << mTransientMemoryUnaliased / 1024 << " KB without aliasing)" << std::endl;
+}
+
+void RenderGraph::destroyTransients()
+{
+    for (auto & image : mImages)
+    {
+        if (image.mbImported) continue;
+
+        if (image.mView != VK_NULL_HANDLE) vkDestroyImageView(mDevice, image.mView, nullptr);
+        if (image.mImage != VK_NULL_HANDLE) vkDestroyImage(mDevice, image.mImage, nullptr);
+        image.mView = VK_NULL_HANDLE;
+        image.mImage = VK_NULL_HANDLE;
+        image.mMemoryBlock = UINT32_MAX;
+        image.mAliasPrev = RG_INVALID_HANDLE;
+    }
+
+    for (auto & block : mMemoryBlocks)
+    {
+        vmaFreeMemory(mAllocator, block.mAllocation);
+    }
+    mMemoryBlocks.clear();
+}
+
+bool RenderGraph::transition(SyncState& state, RGAccess access, RGPass::Barrier& outBarrier)
+{
+    RGAccessInfo info = GetAccessInfo(access);
+    bool bWrite = info.mWriteAccess != VK_ACCESS_2_NONE;
+
+    if (bWrite || state.mLayout != info.mLayout)
+    {
+        // 写或者Layout转换要等之前所有的读写完成，读只需要执行依赖
+        outBarrier.mSrcStage = state.mWriteStage | state.mReadStage;
+        outBarrier.mSrcAccess = state.mWriteAccess;
+        outBarrier.mDstStage = info.mStage;
+        outBarrier.mDstAccess = info.mAccess;
+        outBarrier.mOldLayout = state.mLayout;
+        outBarrier.mNewLayout = info.mLayout;
+
+        bool bNeeded = state.mLayout != info.mLayout || outBarrier.mSrcStage != VK_PIPELINE_STAGE_2_NONE;
+
+        // Layout转换本身也算一次写，之后其它Stage的读要等它
+        state.mLayout = info.mLayout;
+        state.mWriteStage = info.mStage;
+        state.mWriteAccess = info.mWriteAccess;
+        state.mVisibleStage = info.mStage;
+        state.mVisibleAccess = info.mAccess;
+        state.mReadStage = bWrite ? VK_PIPELINE_STAGE_2_NONE : info.mStage;
+        return bNeeded;
+    }
+
+    // 读之前的写已经对这个Stage可见时不需要Barrier
+    bool bNeeded = state.mWriteStage != VK_PIPELINE_STAGE_2_NONE &&
+        ((info.mStage & ~state.mVisibleStage) != 0 || (info.mAccess & ~state.mVisibleAccess) != 0);
+    if (bNeeded)
+    {
+        outBarrier.mSrcStage = state.mWriteStage;
+        outBarrier.mSrcAccess = state.mWriteAccess;
+        outBarrier.mDstStage = info.mStage;
+        outBarrier.mDstAccess = info.mAccess;
+        outBarrier.mOldLayout = state.mLayout;
+        outBarrier.mNewLayout = info.mLayout;
+
+        state.mVisibleStage |= info.mStage;
+        state.mVisibleAccess |= info.mAccess;
+    }
+    state.mReadStage |= info.mStage;
+    return bNeeded;
+}
+
+void RenderGraph::computeBarriers()
+{
+    // 第一遍只为了得到每个Image在一帧结束时的状态
+    // 内部Image下一帧(或者共用显存的下一个Image)第一次使用时要等它
+    std::vector<SyncState> finalStates(mImages.size());
+    RGPass::Barrier unused {};
+    for (auto & pass : mPasses)
+    {
+        for (auto & use : pass.mUses)
+        {
+            transition(finalStates[use.mImage], use.mAccess, unused);
+        }
+    }
+
+    std::vector<SyncState> states(mImages.size());
+    for (RGHandle handle = 0; handle < mImages.size(); handle++)
+    {
+        const Image& image = mImages[handle];
+        SyncState& state = states[handle];
+        if (image.mbImported)
+        {
+            state.mLayout = image.mInitialState.mLayout;
+            state.mWriteStage = image.mInitialState.mStage;
+            state.mWriteAccess = image.mInitialState.mAccess;
+        }
+        else if (image.mAliasPrev != RG_INVALID_HANDLE)
+        {
+            // 内容不需要保留，从UNDEFINED开始
+            const SyncState& prev = finalStates[image.mAliasPrev];
+            state.mLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            state.mWriteStage = prev.mWriteStage | prev.mReadStage;
+            state.mWriteAccess = prev.mWriteAccess;
+        }
+    }
+
+    for (uint32_t i = 0; i < mPasses.size(); i++)
+    {
+        RGPass& pass = mPasses[i];
+        pass.mBarriers.clear();
+        pass.mColorAttachments.clear();
+        pass.mColorFormats.clear();
+        pass.mDepthAttachment = { RG_INVALID_HANDLE };
+
+        for (auto & use : pass.mUses)
+        {
+            const Image& image = mImages[use.mImage];
+            bool bFirstUse = image.mFirstPass == i;
+            bool bDiscardContents = bFirstUse && (!image.mbImported || image.mInitialState.mLayout == VK_IMAGE_LAYOUT_UNDEFINED);
+
+            RGPass::Barrier barrier {};
+            barrier.mImage = use.mImage;
+            if (transition(states[use.mImage], use.mAccess, barrier))
+            {
+                if (bDiscardContents) barrier.mOldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                pass.mBarriers.push_back(barrier);
+            }
+
+            if (!IsAttachment(use.mAccess)) continue;
+
+            RGPass::Attachment attachment {};
+            attachment.mImage = use.mImage;
+            attachment.mLayout = GetAccessInfo(use.mAccess).mLayout;
+
+            if (bFirstUse && image.mbClear) attachment.mLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+            else if (bDiscardContents) attachment.mLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            else attachment.mLoadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+
+            // 之后没有Pass再用的内部Image不需要写回显存
+            if (use.mAccess == RGAccess::DepthRead) attachment.mStoreOp = VK_ATTACHMENT_STORE_OP_NONE;
+            else if (image.mbImported || image.mLastPass > i) attachment.mStoreOp = VK_ATTACHMENT_STORE_OP_STORE;
+            else attachment.mStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+            if (use.mAccess == RGAccess::ColorAttachment)
+            {
+                if (pass.mColorAttachments.size() >= MAX_COLOR_ATTACHMENTS)
+                {
+                    std::cout << "Too many color attachments in pass " << pass.mName << std::endl;
+                    abort();
+                }
+                pass.mColorAttachments.push_back(attachment);
+                pass.mColorFormats.push_back(image.mFormat);
+            }
+            else
+            {
+                pass.mDepthAttachment = attachment;
+            }
+        }
+    }
+
+    mFinalBarriers.clear();
+    for (RGHandle handle = 0; handle < mImages.size(); handle++)
+    {
+        const Image& image = mImages[handle];
+        if (!image.mbImported || image.mFirstPass == UINT32_MAX) continue;
+
+        const SyncState& state = states[handle];
+        if (state.mLayout == image.mFinalState.mLayout && image.mFinalState.mStage == VK_PIPELINE_STAGE_2_NONE) continue;
+
+        RGPass::Barrier barrier {};
+        barrier.mImage = handle;
+        barrier.mSrcStage = state.mWriteStage | state.mReadStage;
+        barrier.mSrcAccess = state.mWriteAccess;
+        barrier.mDstStage = image.mFinalState.mStage;
+        barrier.mDstAccess = image.mFinalState.mAccess;
+        barrier.mOldLayout = state.mLayout;
+        barrier.mNewLayout = image.mFinalState.mLayout;
+        mFinalBarriers.push_back(barrier);
+    }
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer cmdBuffer, const std::vector<RGPass::Barrier>& barriers)
+{
+    if (barriers.empty()) return;
+
+    // 一个Pass的所有Barrier合并成一次调用
+    mBarrierScratch.clear();
+    for (auto & barrier : barriers)
+    {
+        const Image& image = mImages[barrier.mImage];
+
+        VkImageMemoryBarrier2 imageBarrier {};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        imageBarrier.pNext = nullptr;
+        imageBarrier.srcStageMask = barrier.mSrcStage;
+        imageBarrier.srcAccessMask = barrier.mSrcAccess;
+        imageBarrier.dstStageMask = barrier.mDstStage;
+        imageBarrier.dstAccessMask = barrier.mDstAccess;
+        imageBarrier.oldLayout = barrier.mOldLayout;
+        imageBarrier.newLayout = barrier.mNewLayout;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = image.mImage;
+        imageBarrier.subresourceRange = VKInit::ImageSubresourceRange(image.mAspect);
+        mBarrierScratch.push_back(imageBarrier);
+    }
+
+    VkDependencyInfo depInfo {};
+    depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    depInfo.pNext = nullptr;
+    depInfo.imageMemoryBarrierCount = static_cast<uint32_t>(mBarrierScratch.size());
+    depInfo.pImageMemoryBarriers = mBarrierScratch.data();
+
+    vkCmdPipelineBarrier2(cmdBuffer, &depInfo);
+    mBarrierCount += static_cast<uint32_t>(mBarrierScratch.size());
+}
\ No newline at end of file
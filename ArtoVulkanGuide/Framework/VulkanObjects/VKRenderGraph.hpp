@@ -0,0 +1,194 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "VKTypes.hpp"
+
+// Render Graph里资源的句柄，就是资源数组的下标
+using RGHandle = uint32_t;
+constexpr RGHandle RG_INVALID_HANDLE = UINT32_MAX;
+
+// Pass使用资源的方式，决定Barrier的Stage/Access和Image Layout
+enum class RGAccess
+{
+    ColorAttachment,
+    DepthAttachment,
+    DepthRead,
+    FragmentSampled,
+    ComputeSampled,
+    ComputeStorageRead,
+    ComputeStorageWrite,
+    TransferSrc,
+    TransferDst,
+};
+
+// 资源在Graph之外的同步状态，导入的资源用它描述进入和离开Graph时的状态
+struct RGImageState
+{
+    VkImageLayout mLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags2 mStage = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 mAccess = VK_ACCESS_2_NONE;
+};
+
+struct RGPassContext
+{
+    VkCommandBuffer mCmdBuffer;
+    // 只有设置了Secondary的Pass有效，用于开始Secondary Command Buffer
+    const VkCommandBufferInheritanceInfo* mInheritance;
+};
+
+class RenderGraph;
+
+class RGPass
+{
+public:
+    RGPass& Color(RGHandle image);
+    RGPass& Depth(RGHandle image, bool bWrite = true);
+    RGPass& Read(RGHandle image, RGAccess access);
+    RGPass& Write(RGHandle image, RGAccess access);
+    // Pass的内容录制在Secondary Command Buffer里，主Command Buffer里只执行它们
+    RGPass& Secondary();
+
+private:
+    friend class RenderGraph;
+
+    struct Use
+    {
+        RGHandle mImage;
+        RGAccess mAccess;
+    };
+
+    struct Barrier
+    {
+        RGHandle mImage;
+        VkPipelineStageFlags2 mSrcStage;
+        VkAccessFlags2 mSrcAccess;
+        VkPipelineStageFlags2 mDstStage;
+        VkAccessFlags2 mDstAccess;
+        VkImageLayout mOldLayout;
+        VkImageLayout mNewLayout;
+    };
+
+    struct Attachment
+    {
+        RGHandle mImage;
+        VkImageLayout mLayout;
+        VkAttachmentLoadOp mLoadOp;
+        VkAttachmentStoreOp mStoreOp;
+    };
+
+    std::string mName;
+    std::function<void(const RGPassContext&)> mExecute;
+    std::vector<Use> mUses;
+    bool mbSecondary = false;
+
+    // Compile的结果
+    std::vector<Barrier> mBarriers;
+    std::vector<Attachment> mColorAttachments;
+    Attachment mDepthAttachment { RG_INVALID_HANDLE };
+    std::vector<VkFormat> mColorFormats;
+};
+
+// 一帧的渲染流程，Pass按添加的顺序执行
+// Pass声明读写的资源，Compile时算出每个Pass前最少的Barrier和Attachment的Load/Store
+// Graph内部创建的Image生命周期不重叠时共用同一块显存
+class RenderGraph
+{
+public:
+    void Init(VkDevice device, VmaAllocator allocator);
+    void Destroy();
+
+    // 外部的Image，每帧可以用SetImportedImage替换，比如SwapChain
+    RGHandle ImportImage(const std::string& name, VkFormat format, VkExtent2D extent, VkImageAspectFlags aspect, const RGImageState& initialState, const RGImageState& finalState);
+    void SetImportedImage(RGHandle handle, VkImage image, VkImageView view);
+
+    // Graph内部的Image，只在一帧内使用，Compile时分配
+    RGHandle CreateImage(const std::string& name, VkFormat format, VkExtent2D extent, VkImageUsageFlags usage, VkImageAspectFlags aspect);
+    // 第一次使用时Clear，不设置的话内容是未定义的
+    void SetClearValue(RGHandle handle, VkClearValue clearValue);
+    // 作为Attachment时的渲染区域，默认是整张Image，每帧可以改变，不需要重新Compile
+    void SetRenderExtent(RGHandle handle, VkExtent2D extent);
+
+    RGPass& AddPass(const std::string& name, std::function<void(const RGPassContext&)>&& execute);
+
+    // 所有Pass添加完后调用一次，资源或者尺寸变化后需要重新调用
+    void Compile();
+    void Execute(VkCommandBuffer cmdBuffer);
+
+    VkImage GetImage(RGHandle handle) const { return mImages[handle].mImage; }
+    VkImageView GetImageView(RGHandle handle) const { return mImages[handle].mView; }
+
+    // 统计信息
+    uint32_t mBarrierCount = 0;
+    VkDeviceSize mTransientMemory = 0;
+    VkDeviceSize mTransientMemoryUnaliased = 0;
+
+private:
+    struct Image
+    {
+        std::string mName;
+        VkFormat mFormat;
+        VkExtent2D mExtent;
+        VkImageUsageFlags mUsage;
+        VkImageAspectFlags mAspect;
+        bool mbImported;
+        RGImageState mInitialState;
+        RGImageState mFinalState;
+
+        bool mbClear = false;
+        VkClearValue mClearValue {};
+        VkExtent2D mRenderExtent;
+
+        VkImage mImage = VK_NULL_HANDLE;
+        VkImageView mView = VK_NULL_HANDLE;
+
+        // 第一个和最后一个使用它的Pass
+        uint32_t mFirstPass = UINT32_MAX;
+        uint32_t mLastPass = 0;
+        // 内部Image所在的显存块，以及同一块里的上一个Image
+        uint32_t mMemoryBlock = UINT32_MAX;
+        RGHandle mAliasPrev = RG_INVALID_HANDLE;
+    };
+
+    // 记录资源当前的同步状态，用来决定下一次使用前需要什么Barrier
+    struct SyncState
+    {
+        VkImageLayout mLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags2 mWriteStage = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 mWriteAccess = VK_ACCESS_2_NONE;
+        // 上一次写之后已经可见的Stage/Access
+        VkPipelineStageFlags2 mVisibleStage = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 mVisibleAccess = VK_ACCESS_2_NONE;
+        // 上一次写之后的读
+        VkPipelineStageFlags2 mReadStage = VK_PIPELINE_STAGE_2_NONE;
+    };
+
+    struct MemoryBlock
+    {
+        VmaAllocation mAllocation;
+        VkMemoryRequirements mRequirements;
+        std::vector<RGHandle> mImages;
+    };
+
+    void computeLifetimes();
+    void allocateTransients();
+    void destroyTransients();
+    void computeBarriers();
+    // 根据资源当前的状态和这次的使用方式更新状态，返回是否需要Barrier
+    static bool transition(SyncState& state, RGAccess access, RGPass::Barrier& outBarrier);
+    void recordBarriers(VkCommandBuffer cmdBuffer, const std::vector<RGPass::Barrier>& barriers);
+
+private:
+    VkDevice mDevice = VK_NULL_HANDLE;
+    VmaAllocator mAllocator = VK_NULL_HANDLE;
+
+    std::vector<Image> mImages;
+    std::vector<RGPass> mPasses;
+    std::vector<MemoryBlock> mMemoryBlocks;
+
+    // 所有Pass结束后把导入的Image转换到最终状态
+    std::vector<RGPass::Barrier> mFinalBarriers;
+    std::vector<VkImageMemoryBarrier2> mBarrierScratch;
+};
\ No newline at end of file
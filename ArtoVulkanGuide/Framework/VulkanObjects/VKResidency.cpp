@@ -0,0 +1,163 @@
+#include <algorithm>
+
+#include "VKResidency.hpp"
+
+void ResidencyManager::Init(VmaAllocator allocator, VkDeviceSize budget, bool bMemoryBudgetExt, uint32_t framesInFlight)
+{
+    mAllocator = allocator;
+    mBudget = budget;
+    mbMemoryBudgetExt = bMemoryBudgetExt;
+    mFramesInFlight = std::max(framesInFlight, 1u);
+
+    const VkPhysicalDeviceMemoryProperties* memoryProps = nullptr;
+    vmaGetMemoryProperties(mAllocator, &memoryProps);
+    mDeviceHeaps = 0;
+    for (uint32_t i = 0; i < memoryProps->memoryHeapCount; i++)
+    {
+        if (memoryProps->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+        {
+            mDeviceHeaps |= 1u << i;
+        }
+    }
+}
+
+void ResidencyManager::BeginFrame(uint64_t frame)
+{
+    vmaSetCurrentFrameIndex(mAllocator, static_cast<uint32_t>(frame));
+}
+
+ResidencyHandle ResidencyManager::Register(ResidentType type, void* resource, VkDeviceSize size, bool bPinned)
+{
+    mEntries.push_back({ type, resource, size, 0, true, bPinned });
+    return static_cast<ResidencyHandle>(mEntries.size()) - 1;
+}
+
+bool ResidencyManager::Touch(ResidencyHandle handle, uint64_t frame)
+{
+    Entry& entry = mEntries[handle];
+    entry.mLastUsedFrame = frame;
+    return entry.mbResident;
+}
+
+void ResidencyManager::SetResident(ResidencyHandle handle, bool bResident)
+{
+    Entry& entry = mEntries[handle];
+    if (entry.mbResident == bResident) return;
+
+    entry.mbResident = bResident;
+    if (bResident)
+    {
+        mReloadCount++;
+    }
+    else
+    {
+        mEvictionCount++;
+        mEvictedBytes += entry.mSize;
+    }
+}
+
+VkDeviceSize ResidencyManager::GetDeviceUsage() const
+{
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetBudget(mAllocator, budgets);
+
+    VkDeviceSize usage = 0;
+    for (uint32_t i = 0; i < VK_MAX_MEMORY_HEAPS; i++)
+    {
+        if (mDeviceHeaps & (1u << i))
+        {
+            usage += budgets[i].allocationBytes;
+        }
+    }
+    return usage;
+}
+
+VkDeviceSize ResidencyManager::GetBudget() const
+{
+    if (mBudget > 0 || !mbMemoryBudgetExt)
+    {
+        return mBudget;
+    }
+
+    // 其他程序也在用显存，扩展报告的预算每帧都可能变化
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetBudget(mAllocator, budgets);
+
+    VkDeviceSize budget = 0;
+    for (uint32_t i = 0; i < VK_MAX_MEMORY_HEAPS; i++)
+    {
+        if (mDeviceHeaps & (1u << i))
+        {
+            budget += budgets[i].budget;
+        }
+    }
+    return budget / 10 * 9;
+}
+
+void ResidencyManager::CollectEvictions(VkDeviceSize usage, uint64_t frame, std::vector<ResidencyHandle>& outHandles)
+{
+    outHandles.clear();
+    VkDeviceSize budget = GetBudget();
+    if (budget == 0 || usage <= budget) return;
+
+    // 最后一次使用之后已经过了framesInFlight帧，GPU一定已经用完
+    mCandidates.clear();
+    for (ResidencyHandle handle = 0; handle < mEntries.size(); handle++)
+    {
+        const Entry& entry = mEntries[handle];
+        if (entry.mbResident && !entry.mbPinned && entry.mLastUsedFrame + mFramesInFlight <= frame)
+        {
+            mCandidates.push_back(handle);
+        }
+    }
+    std::sort(mCandidates.begin(), mCandidates.end(), [&](ResidencyHandle a, ResidencyHandle b)
+    {
+        return mEntries[a].mLastUsedFrame < mEntries[b].mLastUsedFrame;
+    });
+
+    VkDeviceSize excess = usage - budget;
+    VkDeviceSize freed = 0;
+    for (ResidencyHandle handle : mCandidates)
+    {
+        if (freed >= excess) break;
+        outHandles.push_back(handle);
+        freed += mEntries[handle].mSize;
+    }
+}
+
+void ResidencyManager::AddPendingFree(VkDeviceSize bytes, uint64_t retireValue)
+{
+    mPendingFrees.push_back({ retireValue, bytes });
+    mPendingFreeBytes += bytes;
+}
+
+void ResidencyManager::RetirePendingFree(uint64_t completedValue)
+{
+    size_t retired = 0;
+    while (retired < mPendingFrees.size() && mPendingFrees[retired].mRetireValue <= completedValue)
+    {
+        mPendingFreeBytes -= mPendingFrees[retired].mBytes;
+        retired++;
+    }
+    mPendingFrees.erase(mPendingFrees.begin(), mPendingFrees.begin() + retired);
+}
+
+uint32_t ResidencyManager::GetResidentCount(ResidentType type) const
+{
+    uint32_t count = 0;
+    for (const Entry& entry : mEntries)
+    {
+        count += (entry.mType == type && entry.mbResident) ? 1 : 0;
+    }
+    return count;
+}
+
+uint32_t ResidencyManager::GetCount(ResidentType type) const
+{
+    uint32_t count = 0;
+    for (const Entry& entry : mEntries)
+    {
+        count += entry.mType == type ? 1 : 0;
+    }
+    return count;
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "VKTypes.hpp"
+
+using ResidencyHandle = uint32_t;
+constexpr ResidencyHandle RESIDENCY_INVALID_HANDLE = UINT32_MAX;
+
+enum class ResidentType : uint32_t
+{
+    Mesh,
+    Texture,
+};
+
+// 记录网格和贴图是否在显存里，以及最后一次使用的帧
+// 显存使用超过预算时按最久没用的顺序选出要驱逐的资源，还在飞的帧用到的资源不会被选中
+// 驱逐和重新加载由调用者完成，这里只做记录和选择
+class ResidencyManager
+{
+public:
+    // budget为0时使用VK_EXT_memory_budget报告的预算的90%，扩展不可用时不驱逐
+    void Init(VmaAllocator allocator, VkDeviceSize budget, bool bMemoryBudgetExt, uint32_t framesInFlight);
+
+    // 每帧开始时调用，VMA按帧号刷新扩展报告的预算
+    void BeginFrame(uint64_t frame);
+
+    // 固定的资源永远不会被驱逐
+    ResidencyHandle Register(ResidentType type, void* resource, VkDeviceSize size, bool bPinned = false);
+    // 标记这一帧要用，返回资源是否在显存里，不在时调用者重新加载后调用SetResident
+    bool Touch(ResidencyHandle handle, uint64_t frame);
+    void SetResident(ResidencyHandle handle, bool bResident);
+
+    ResidentType GetType(ResidencyHandle handle) const { return mEntries[handle].mType; }
+    void* GetResource(ResidencyHandle handle) const { return mEntries[handle].mResource; }
+
+    // DEVICE_LOCAL堆上所有Buffer和Image占用的字节数，GeometryBuffer的块按整块计算
+    // VMA保留的空块和块里的空隙不算，之后的分配会先使用它们
+    VkDeviceSize GetDeviceUsage() const;
+    VkDeviceSize GetBudget() const;
+    // usage超过预算时按LRU选出要驱逐的资源，释放的大小加起来不少于超出的部分
+    // 调用者释放后对每个资源调用SetResident(false)
+    void CollectEvictions(VkDeviceSize usage, uint64_t frame, std::vector<ResidencyHandle>& outHandles);
+
+    // 驱逐的资源交给延迟删除后还占着显存，Timeline到达retireValue之前算作待释放
+    // 判断是否超出预算时从用量里减去，不会因为还没销毁而多驱逐
+    void AddPendingFree(VkDeviceSize bytes, uint64_t retireValue);
+    // 和删除队列的Retire使用同一个已完成的Timeline值
+    void RetirePendingFree(uint64_t completedValue);
+    VkDeviceSize GetPendingFreeBytes() const { return mPendingFreeBytes; }
+
+    uint32_t GetResidentCount(ResidentType type) const;
+    uint32_t GetCount(ResidentType type) const;
+
+    // 统计信息
+    uint64_t mEvictionCount = 0;
+    uint64_t mReloadCount = 0;
+    VkDeviceSize mEvictedBytes = 0;
+
+private:
+    struct Entry
+    {
+        ResidentType mType;
+        void* mResource;
+        VkDeviceSize mSize;
+        uint64_t mLastUsedFrame;
+        bool mbResident;
+        bool mbPinned;
+    };
+
+    VmaAllocator mAllocator = VK_NULL_HANDLE;
+    VkDeviceSize mBudget = 0;
+    bool mbMemoryBudgetExt = false;
+    uint32_t mFramesInFlight = 1;
+    // DEVICE_LOCAL堆的位掩码
+    uint32_t mDeviceHeaps = 0;
+
+    struct PendingFree
+    {
+        uint64_t mRetireValue;
+        VkDeviceSize mBytes;
+    };
+
+    std::vector<Entry> mEntries;
+    std::vector<ResidencyHandle> mCandidates;
+    // 按加入的顺序排列，retireValue递增
+    std::vector<PendingFree> mPendingFrees;
+    VkDeviceSize mPendingFreeBytes = 0;
+};
\ No newline at end of file
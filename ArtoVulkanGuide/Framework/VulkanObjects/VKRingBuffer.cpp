@@ -0,0 +1,39 @@
+#include "VKRingBuffer.hpp"
+
+void RingBuffer::Init(BufferAllocator& allocator, size_t capacity, size_t bindRange, size_t alignment, VkBufferUsageFlags usage)
+{
+    mCapacity = capacity;
+    mAlignment = alignment > 0 ? alignment : 1;
+    mHead = 0;
+
+    // PerFrame的内存是HOST_COHERENT，写完不需要手动Flush
+    void* mappedData = nullptr;
+    mBuffer = allocator.CreateBuffer(capacity + bindRange, usage, MemoryClass::PerFrame, &mappedData);
+    mMappedData = (uint8_t*)mappedData;
+}
+
+void RingBuffer::Destroy(BufferAllocator& allocator)
+{
+    allocator.DestroyBuffer(mBuffer);
+    mMappedData = nullptr;
+}
+
+void RingBuffer::Reset()
+{
+    mHead = 0;
+}
+
+uint32_t RingBuffer::Allocate(size_t size, void** outData)
+{
+    size_t offset = (mHead + mAlignment - 1) & ~(mAlignment - 1);
+    if (offset + size > mCapacity)
+    {
+        std::cout << "Ring buffer overflow: requested " << size << " bytes, "
+            << mCapacity - mHead << " bytes left" << std::endl;
+        abort();
+    }
+
+    mHead = offset + size;
+    *outData = mMappedData + offset;
+    return static_cast<uint32_t>(offset);
+}
\ No newline at end of file
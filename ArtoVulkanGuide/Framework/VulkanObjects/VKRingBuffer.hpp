@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstring>
+
+#include "VKTypes.hpp"
+#include "VKAllocator.hpp"
+
+// 每帧一个的线性分配器，Buffer创建时就常驻映射，不再需要每帧Map/Unmap
+// 帧的Fence完成后整体Reset，分配出的偏移直接作为动态偏移绑定
+class RingBuffer
+{
+public:
+    // bindRange是绑定到动态描述符上的最大Range，Buffer尾部会额外留出这一段，
+    // 保证任意分配偏移加上描述符的Range都不会越界
+    // 从PerFrame Pool里分配，所有帧的Buffer在同一块显存里
+    void Init(BufferAllocator& allocator, size_t capacity, size_t bindRange, size_t alignment, VkBufferUsageFlags usage);
+    void Destroy(BufferAllocator& allocator);
+    void Reset();
+
+    uint32_t Allocate(size_t size, void** outData);
+
+    template<typename T>
+    uint32_t Push(const T& data)
+    {
+        void* dst;
+        uint32_t offset = Allocate(sizeof(T), &dst);
+        memcpy(dst, &data, sizeof(T));
+        return offset;
+    }
+
+public:
+    AllocatedBuffer mBuffer {};
+    uint8_t* mMappedData = nullptr;
+
+    size_t mCapacity = 0;
+    size_t mAlignment = 1;
+    size_t mHead = 0;
+};
\ No newline at end of file
@@ -5,5 +5,10 @@
 
 namespace VKUtil
 {
+    // 读出RGBA8的像素，贴图被驱逐后用它重新上传
+    bool LoadPixelsFromFile(const std::string& filename, std::vector<uint32_t>& outPixels, uint32_t& outWidth, uint32_t& outHeight);
+    // 创建出的Image由调用者销毁
     bool LoadImageFromFile(VulkanEngine& engine, const std::string& filename, AllocatedImage& outImage);
+    // RGBA8的像素，拷贝进Staging后就可以释放
+    bool LoadImageFromPixels(VulkanEngine& engine, const void* pixels, uint32_t width, uint32_t height, AllocatedImage& outImage);
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "VKTimeline.hpp"
+#include "VKInitializers.hpp"
+
+void QueueTimeline::Init(VkDevice device, VkQueue queue, uint32_t queueFamily)
+{
+    mDevice = device;
+    mQueue = queue;
+    mQueueFamily = queueFamily;
+    mLastSubmitted = 0;
+    mLastCompleted = 0;
+
+    VkSemaphoreTypeCreateInfo typeCI = VKInit::SemaphoreTypeCreateInfo(VK_SEMAPHORE_TYPE_TIMELINE, 0);
+    VkSemaphoreCreateInfo semCI = VKInit::SemaphoreCreateInfo();
+    semCI.pNext = &typeCI;
+
+    VK_CHECK(vkCreateSemaphore(mDevice, &semCI, nullptr, &mSemaphore));
+}
+
+void QueueTimeline::Destroy()
+{
+    vkDestroySemaphore(mDevice, mSemaphore, nullptr);
+    mSemaphore = VK_NULL_HANDLE;
+}
+
+uint64_t QueueTimeline::Submit(
+    VkCommandBuffer cmdBuffer,
+    VkSemaphoreSubmitInfo* waits, uint32_t waitCount,
+    VkSemaphoreSubmitInfo* signals, uint32_t signalCount)
+{
+    if (signalCount > MAX_EXTRA_SIGNALS)
+    {
+        std::cout << "Too many signal semaphores in one submit: " << signalCount << std::endl;
+        abort();
+    }
+
+    uint64_t value = ++mLastSubmitted;
+
+    VkSemaphoreSubmitInfo signalInfos[MAX_EXTRA_SIGNALS + 1];
+    signalInfos[0] = VKInit::SemaphoreSubmitInfo(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, mSemaphore, value);
+    for (uint32_t i = 0; i < signalCount; i++)
+    {
+        signalInfos[i + 1] = signals[i];
+    }
+
+    VkCommandBufferSubmitInfo cmdInfo = VKInit::CmdBufferSubmitInfo(cmdBuffer);
+    VkSubmitInfo2 submit = VKInit::SubmitInfo2(&cmdInfo, signalInfos, waits);
+    submit.waitSemaphoreInfoCount = waitCount;
+    submit.signalSemaphoreInfoCount = signalCount + 1;
+    submit.commandBufferInfoCount = cmdBuffer == VK_NULL_HANDLE ? 0 : 1;
+
+    VK_CHECK(vkQueueSubmit2(mQueue, 1, &submit, VK_NULL_HANDLE));
+
+    return value;
+}
+
+bool QueueTimeline::IsComplete(uint64_t value)
+{
+    if (value <= mLastCompleted) return true;
+    return GetCompletedValue() >= value;
+}
+
+uint64_t QueueTimeline::GetCompletedValue()
+{
+    VK_CHECK(vkGetSemaphoreCounterValue(mDevice, mSemaphore, &mLastCompleted));
+    return mLastCompleted;
+}
+
+void QueueTimeline::Wait(uint64_t value, uint64_t timeout)
+{
+    if (IsComplete(value)) return;
+
+    VkSemaphoreWaitInfo waitInfo {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.pNext = nullptr;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &mSemaphore;
+    waitInfo.pValues = &value;
+
+    VK_CHECK(vkWaitSemaphores(mDevice, &waitInfo, timeout));
+    mLastCompleted = value > mLastCompleted ? value : mLastCompleted;
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "VKTypes.hpp"
+
+// 每个队列一个Timeline Semaphore，每次提交signal一个单调递增的值
+// 帧同步、上传完成和延迟删除都只需要记录这个值，然后和已完成的值比较
+class QueueTimeline
+{
+public:
+    static constexpr uint32_t MAX_EXTRA_SIGNALS = 4;
+
+    void Init(VkDevice device, VkQueue queue, uint32_t queueFamily);
+    void Destroy();
+
+    // 提交一个Command Buffer(可以为空，只做signal)，返回这次提交signal的值
+    uint64_t Submit(
+        VkCommandBuffer cmdBuffer,
+        VkSemaphoreSubmitInfo* waits = nullptr, uint32_t waitCount = 0,
+        VkSemaphoreSubmitInfo* signals = nullptr, uint32_t signalCount = 0);
+
+    // 只查询不阻塞，已完成的值会缓存下来，减少对驱动的调用
+    bool IsComplete(uint64_t value);
+    uint64_t GetCompletedValue();
+    void Wait(uint64_t value, uint64_t timeout = UINT64_MAX);
+
+public:
+    VkDevice mDevice = VK_NULL_HANDLE;
+    VkQueue mQueue = VK_NULL_HANDLE;
+    uint32_t mQueueFamily = 0;
+    VkSemaphore mSemaphore = VK_NULL_HANDLE;
+
+    uint64_t mLastSubmitted = 0;
+    uint64_t mLastCompleted = 0;
+};
\ No newline at end of file
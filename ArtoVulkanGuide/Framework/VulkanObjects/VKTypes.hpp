@@ -17,6 +17,7 @@
 		}                                                               \
 	} while (0)
 
+// 初始化时注册退出时的销毁函数，运行中释放的对象用VKDeletion.hpp里的TypedDeletionQueue
 struct DeletionQueue
 {
     std::deque<std::function<void()>> mDeletors;
@@ -0,0 +1,360 @@
+#include <cstring>
+
+#include "VKUpload.hpp"
+#include "VKInitializers.hpp"
+
+#include <Tracy.hpp>
+
+constexpr size_t STAGING_ALIGNMENT = 16;
+
+void UploadEngine::Init(
+    VkDevice device, BufferAllocator* allocator,
+    VkQueue transferQueue, uint32_t transferFamily, uint32_t graphicsFamily,
+    size_t stagingSize)
+{
+    mDevice = device;
+    mAllocator = allocator;
+    mTransferFamily = transferFamily;
+    mGraphicsFamily = graphicsFamily;
+
+    mTimeline.Init(device, transferQueue, transferFamily);
+
+    VkCommandPoolCreateInfo cmdPoolCI = VKInit::CmdPoolCreateInfo(mTransferFamily, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+    for (auto & batch : mBatches)
+    {
+        VK_CHECK(vkCreateCommandPool(mDevice, &cmdPoolCI, nullptr, &batch.mCmdPool));
+
+        VkCommandBufferAllocateInfo cmdBufferAI = VKInit::CmdBufferAllocateInfo(batch.mCmdPool, 1);
+        VK_CHECK(vkAllocateCommandBuffers(mDevice, &cmdBufferAI, &batch.mCmdBuffer));
+    }
+
+    mStagingSize = stagingSize;
+
+    void* stagingData = nullptr;
+    mStagingBuffer = mAllocator->CreateBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, MemoryClass::Staging, &stagingData);
+    mStagingData = (uint8_t*)stagingData;
+}
+
+void UploadEngine::Destroy()
+{
+    for (auto & batch : mBatches)
+    {
+        vkDestroyCommandPool(mDevice, batch.mCmdPool, nullptr);
+    }
+    for (auto & retired : mRetiredBuffers)
+    {
+        mAllocator->DestroyBuffer(retired.mBuffer);
+    }
+    mRetiredBuffers.clear();
+
+    mAllocator->DestroyBuffer(mStagingBuffer);
+    mTimeline.Destroy();
+}
+
+UploadHandle UploadEngine::UploadBuffer(
+    VkBuffer dst, VkDeviceSize dstOffset, const void* data, size_t size,
+    VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess)
+{
+    ZoneScoped;
+    void* staging;
+    VkBuffer srcBuffer;
+    size_t srcOffset = allocateStaging(size, &staging, srcBuffer);
+    memcpy(staging, data, size);
+
+    VkCommandBuffer cmdBuffer = beginBatch();
+
+    VkBufferCopy copy {};
+    copy.srcOffset = srcOffset;
+    copy.dstOffset = dstOffset;
+    copy.size = size;
+    vkCmdCopyBuffer(cmdBuffer, srcBuffer, dst, 1, &copy);
+
+    // 同一个Queue Family时Buffer不需要Barrier，Graphics提交等待Timeline就保证了可见性
+    if (!IsSameQueueFamily())
+    {
+        VkBufferMemoryBarrier2 release {};
+        release.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+        release.pNext = nullptr;
+        release.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        release.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        release.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+        release.dstAccessMask = VK_ACCESS_2_NONE;
+        release.srcQueueFamilyIndex = mTransferFamily;
+        release.dstQueueFamilyIndex = mGraphicsFamily;
+        release.buffer = dst;
+        release.offset = dstOffset;
+        release.size = size;
+        mRelease.mBuffers.push_back(release);
+
+        VkBufferMemoryBarrier2 acquire = release;
+        acquire.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+        acquire.srcAccessMask = VK_ACCESS_2_NONE;
+        acquire.dstStageMask = dstStage;
+        acquire.dstAccessMask = dstAccess;
+        mBatchAcquire.mBuffers.push_back(acquire);
+    }
+    mBatchDstStage |= dstStage;
+
+    mBytesUploaded += size;
+    mCopyCount++;
+
+    return mTimeline.mLastSubmitted + 1;
+}
+
+UploadHandle UploadEngine::UploadImage(
+    VkImage dst, VkExtent3D extent, const void* data, size_t size, VkImageLayout finalLayout,
+    VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess)
+{
+    ZoneScoped;
+    void* staging;
+    VkBuffer srcBuffer;
+    size_t srcOffset = allocateStaging(size, &staging, srcBuffer);
+    memcpy(staging, data, size);
+
+    VkCommandBuffer cmdBuffer = beginBatch();
+
+    VkImageMemoryBarrier2 toTransfer {};
+    toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    toTransfer.pNext = nullptr;
+    toTransfer.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+    toTransfer.srcAccessMask = VK_ACCESS_2_NONE;
+    toTransfer.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    toTransfer.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    toTransfer.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.image = dst;
+    toTransfer.subresourceRange = VKInit::ImageSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT);
+
+    VkDependencyInfo depInfo {};
+    depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    depInfo.pNext = nullptr;
+    depInfo.imageMemoryBarrierCount = 1;
+    depInfo.pImageMemoryBarriers = &toTransfer;
+    vkCmdPipelineBarrier2(cmdBuffer, &depInfo);
+
+    VkBufferImageCopy copyRegion {};
+    copyRegion.bufferOffset = srcOffset;
+    copyRegion.bufferRowLength = 0;
+    copyRegion.bufferImageHeight = 0;
+    copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    copyRegion.imageSubresource.mipLevel = 0;
+    copyRegion.imageSubresource.baseArrayLayer = 0;
+    copyRegion.imageSubresource.layerCount = 1;
+    copyRegion.imageExtent = extent;
+    vkCmdCopyBufferToImage(cmdBuffer, srcBuffer, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+    // Layout转换放在Release Barrier里一起做，Acquire Barrier要用同样的oldLayout/newLayout
+    VkImageMemoryBarrier2 release = toTransfer;
+    release.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    release.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    release.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    release.newLayout = finalLayout;
+
+    if (IsSameQueueFamily())
+    {
+        release.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        release.dstAccessMask = VK_ACCESS_2_NONE;
+        mRelease.mImages.push_back(release);
+    }
+    else
+    {
+        release.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+        release.dstAccessMask = VK_ACCESS_2_NONE;
+        release.srcQueueFamilyIndex = mTransferFamily;
+        release.dstQueueFamilyIndex = mGraphicsFamily;
+        mRelease.mImages.push_back(release);
+
+        VkImageMemoryBarrier2 acquire = release;
+        acquire.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+        acquire.srcAccessMask = VK_ACCESS_2_NONE;
+        acquire.dstStageMask = dstStage;
+        acquire.dstAccessMask = dstAccess;
+        mBatchAcquire.mImages.push_back(acquire);
+    }
+    mBatchDstStage |= dstStage;
+
+    mBytesUploaded += size;
+    mCopyCount++;
+
+    return mTimeline.mLastSubmitted + 1;
+}
+
+UploadHandle UploadEngine::Flush()
+{
+    if (!mbRecording) return mTimeline.mLastSubmitted;
+    ZoneScoped;
+
+    UploadBatch& batch = mBatches[mBatchIndex];
+
+    recordBarriers(batch.mCmdBuffer, mRelease);
+    mRelease.Clear();
+
+    VK_CHECK(vkEndCommandBuffer(batch.mCmdBuffer));
+
+    batch.mValue = mTimeline.Submit(batch.mCmdBuffer);
+    mbRecording = false;
+    mBatchIndex = (mBatchIndex + 1) % BATCH_COUNT;
+    mSubmitCount++;
+
+    // 这一批的Acquire Barrier交给Graphics队列，下一帧开始时录制
+    mAcquire.mBuffers.insert(mAcquire.mBuffers.end(), mBatchAcquire.mBuffers.begin(), mBatchAcquire.mBuffers.end());
+    mAcquire.mImages.insert(mAcquire.mImages.end(), mBatchAcquire.mImages.begin(), mBatchAcquire.mImages.end());
+    mBatchAcquire.Clear();
+    mAcquireDstStage |= mBatchDstStage;
+    mBatchDstStage = VK_PIPELINE_STAGE_2_NONE;
+    mAcquireValue = batch.mValue;
+
+    return batch.mValue;
+}
+
+bool UploadEngine::IsComplete(UploadHandle handle)
+{
+    return mTimeline.IsComplete(handle);
+}
+
+void UploadEngine::Wait(UploadHandle handle)
+{
+    ZoneScoped;
+    if (handle > mTimeline.mLastSubmitted) Flush();
+    mTimeline.Wait(handle);
+}
+
+uint64_t UploadEngine::RecordAcquireBarriers(VkCommandBuffer graphicsCmd, VkPipelineStageFlags2& outWaitStage)
+{
+    Flush();
+    Update();
+
+    outWaitStage = VK_PIPELINE_STAGE_2_NONE;
+    if (mAcquireValue == 0) return 0;
+
+    recordBarriers(graphicsCmd, mAcquire);
+    mAcquire.Clear();
+
+    // 已经完成的上传不需要再让GPU等待
+    uint64_t waitValue = mTimeline.IsComplete(mAcquireValue) ? 0 : mAcquireValue;
+    outWaitStage = mAcquireDstStage;
+
+    mAcquireValue = 0;
+    mAcquireDstStage = VK_PIPELINE_STAGE_2_NONE;
+
+    return waitValue;
+}
+
+void UploadEngine::Update()
+{
+    reclaimStaging();
+
+    while (!mRetiredBuffers.empty() && mTimeline.IsComplete(mRetiredBuffers.front().mValue))
+    {
+        mAllocator->DestroyBuffer(mRetiredBuffers.front().mBuffer);
+        mRetiredBuffers.pop_front();
+    }
+}
+
+VkCommandBuffer UploadEngine::beginBatch()
+{
+    UploadBatch& batch = mBatches[mBatchIndex];
+    if (mbRecording) return batch.mCmdBuffer;
+
+    // 只有BATCH_COUNT个批次都还在执行时才会阻塞
+    mTimeline.Wait(batch.mValue);
+    VK_CHECK(vkResetCommandPool(mDevice, batch.mCmdPool, 0));
+
+    VkCommandBufferBeginInfo cmdBufferBI = VKInit::CmdBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    VK_CHECK(vkBeginCommandBuffer(batch.mCmdBuffer, &cmdBufferBI));
+    mbRecording = true;
+
+    return batch.mCmdBuffer;
+}
+
+size_t UploadEngine::allocateStaging(size_t size, void** outData, VkBuffer& outBuffer)
+{
+    size_t alignedSize = (size + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+
+    // 超过环形Buffer容量的数据单独创建一个Staging，上传完成后回收
+    if (alignedSize > mStagingSize)
+    {
+        RetiredBuffer retired {};
+        retired.mBuffer = mAllocator->CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, MemoryClass::Staging, outData);
+        retired.mValue = mTimeline.mLastSubmitted + 1;
+        mRetiredBuffers.push_back(retired);
+
+        outBuffer = retired.mBuffer.mBuffer;
+        return 0;
+    }
+
+    while (true)
+    {
+        reclaimStaging();
+
+        size_t offset = 0;
+        bool bFits = false;
+        if (mStagingRegions.empty())
+        {
+            mStagingHead = 0;
+            bFits = true;
+        }
+        else
+        {
+            // 非空时head等于tail表示已经写满
+            size_t tail = mStagingRegions.front().mOffset;
+            if (mStagingHead > tail)
+            {
+                if (mStagingHead + alignedSize <= mStagingSize)
+                {
+                    offset = mStagingHead;
+                    bFits = true;
+                }
+                else if (alignedSize <= tail)
+                {
+                    offset = 0;
+                    bFits = true;
+                }
+            }
+            else if (mStagingHead < tail && mStagingHead + alignedSize <= tail)
+            {
+                offset = mStagingHead;
+                bFits = true;
+            }
+        }
+
+        if (bFits)
+        {
+            mStagingRegions.push_back({ offset, alignedSize, mTimeline.mLastSubmitted + 1 });
+            mStagingHead = offset + alignedSize;
+
+            *outData = mStagingData + offset;
+            outBuffer = mStagingBuffer.mBuffer;
+            return offset;
+        }
+
+        // 空间不够，先把正在录制的批次提交，再等最早的一块Staging用完
+        Flush();
+        mTimeline.Wait(mStagingRegions.front().mValue);
+    }
+}
+
+void UploadEngine::reclaimStaging()
+{
+    while (!mStagingRegions.empty() && mTimeline.IsComplete(mStagingRegions.front().mValue))
+    {
+        mStagingRegions.pop_front();
+    }
+}
+
+void UploadEngine::recordBarriers(VkCommandBuffer cmdBuffer, const BarrierList& barriers)
+{
+    if (barriers.Empty()) return;
+
+    VkDependencyInfo depInfo {};
+    depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    depInfo.pNext = nullptr;
+    depInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(barriers.mBuffers.size());
+    depInfo.pBufferMemoryBarriers = barriers.mBuffers.data();
+    depInfo.imageMemoryBarrierCount = static_cast<uint32_t>(barriers.mImages.size());
+    depInfo.pImageMemoryBarriers = barriers.mImages.data();
+
+    vkCmdPipelineBarrier2(cmdBuffer, &depInfo);
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "VKTypes.hpp"
+#include "VKTimeline.hpp"
+#include "VKAllocator.hpp"
+
+// 上传的句柄就是Transfer Timeline上的值，值到达后上传完成
+using UploadHandle = uint64_t;
+
+// 在专用Transfer队列上异步上传数据
+// Staging是一块常驻映射的环形Buffer，多次拷贝合并成一次提交
+// Transfer和Graphics不在同一个Queue Family时，用Release/Acquire Barrier转移所有权
+class UploadEngine
+{
+public:
+    static constexpr uint32_t BATCH_COUNT = 4;
+
+    void Init(
+        VkDevice device, BufferAllocator* allocator,
+        VkQueue transferQueue, uint32_t transferFamily, uint32_t graphicsFamily,
+        size_t stagingSize);
+    void Destroy();
+
+    // 数据会立即拷贝到Staging里，调用返回后data就可以释放
+    // dstStage/dstAccess是资源在Graphics队列上第一次使用的方式
+    UploadHandle UploadBuffer(
+        VkBuffer dst, VkDeviceSize dstOffset, const void* data, size_t size,
+        VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess);
+    UploadHandle UploadImage(
+        VkImage dst, VkExtent3D extent, const void* data, size_t size, VkImageLayout finalLayout,
+        VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess);
+
+    // 提交当前批次，返回这一批完成时的Timeline值
+    UploadHandle Flush();
+    bool IsComplete(UploadHandle handle);
+    void Wait(UploadHandle handle);
+
+    // 每帧在Graphics Command Buffer的开头调用，先提交还没提交的批次，再录制Acquire Barrier
+    // 返回Graphics提交需要等待的Transfer Timeline值，0表示不需要等待
+    uint64_t RecordAcquireBarriers(VkCommandBuffer graphicsCmd, VkPipelineStageFlags2& outWaitStage);
+
+    // 回收已经完成的Staging空间和临时Buffer，不会阻塞
+    void Update();
+
+    bool IsSameQueueFamily() const { return mTransferFamily == mGraphicsFamily; }
+
+private:
+    struct UploadBatch
+    {
+        VkCommandPool mCmdPool = VK_NULL_HANDLE;
+        VkCommandBuffer mCmdBuffer = VK_NULL_HANDLE;
+        uint64_t mValue = 0;
+    };
+
+    struct StagingRegion
+    {
+        size_t mOffset;
+        size_t mSize;
+        uint64_t mValue;
+    };
+
+    struct RetiredBuffer
+    {
+        AllocatedBuffer mBuffer;
+        uint64_t mValue;
+    };
+
+    VkCommandBuffer beginBatch();
+    // 从环形Staging里分配，空间不够时会先提交当前批次再等最早的批次完成
+    size_t allocateStaging(size_t size, void** outData, VkBuffer& outBuffer);
+    void reclaimStaging();
+
+public:
+    QueueTimeline mTimeline;
+
+    // 统计信息
+    uint64_t mBytesUploaded = 0;
+    uint32_t mCopyCount = 0;
+    uint32_t mSubmitCount = 0;
+
+private:
+    VkDevice mDevice = VK_NULL_HANDLE;
+    BufferAllocator* mAllocator = nullptr;
+    uint32_t mTransferFamily = 0;
+    uint32_t mGraphicsFamily = 0;
+
+    UploadBatch mBatches[BATCH_COUNT];
+    uint32_t mBatchIndex = 0;
+    bool mbRecording = false;
+
+    AllocatedBuffer mStagingBuffer {};
+    uint8_t* mStagingData = nullptr;
+    size_t mStagingSize = 0;
+    size_t mStagingHead = 0;
+    std::deque<StagingRegion> mStagingRegions;
+    std::deque<RetiredBuffer> mRetiredBuffers;
+
+    struct BarrierList
+    {
+        void Clear() { mBuffers.clear(); mImages.clear(); }
+        bool Empty() const { return mBuffers.empty() && mImages.empty(); }
+
+        std::vector<VkBufferMemoryBarrier2> mBuffers;
+        std::vector<VkImageMemoryBarrier2> mImages;
+    };
+    void recordBarriers(VkCommandBuffer cmdBuffer, const BarrierList& barriers);
+
+    // 录制中批次的Release Barrier，提交前统一录制
+    BarrierList mRelease;
+    // 录制中批次对应的Acquire Barrier，提交后才能交给Graphics队列
+    BarrierList mBatchAcquire;
+    VkPipelineStageFlags2 mBatchDstStage = VK_PIPELINE_STAGE_2_NONE;
+
+    // 已提交但Graphics队列还没取走的Acquire Barrier
+    BarrierList mAcquire;
+    VkPipelineStageFlags2 mAcquireDstStage = VK_PIPELINE_STAGE_2_NONE;
+    uint64_t mAcquireValue = 0;
+};
\ No newline at end of file
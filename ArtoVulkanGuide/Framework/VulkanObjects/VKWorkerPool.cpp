@@ -0,0 +1,102 @@
+#include "VKWorkerPool.hpp"
+
+void WorkerPool::Init(uint32_t workerCount)
+{
+    mbQuit = false;
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        mThreads.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+void WorkerPool::Destroy()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mbQuit = true;
+    }
+    mWakeCV.notify_all();
+
+    for (auto & thread : mThreads)
+    {
+        thread.join();
+    }
+    mThreads.clear();
+}
+
+void WorkerPool::ParallelFor(uint32_t taskCount, const std::function<void(uint32_t)>& task)
+{
+    if (taskCount == 0) return;
+
+    // 没有工作线程或者只有一个任务时直接在当前线程执行
+    if (mThreads.empty() || taskCount == 1)
+    {
+        for (uint32_t i = 0; i < taskCount; i++) task(i);
+        return;
+    }
+
+    {
+        // 上一批醒得晚的工作线程可能还在runTasks里对mNextTask做fetch_add，
+        // 等它们都退出后再重置，否则会领到新一批的任务号去执行旧的任务
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDoneCV.wait(lock, [this]() { return mActiveWorkers == 0; });
+        mTask = &task;
+        mTaskCount = taskCount;
+        mRemaining = taskCount;
+        mNextTask = 0;
+        mGeneration++;
+    }
+    mWakeCV.notify_all();
+
+    runTasks(&task, taskCount);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDoneCV.wait(lock, [this]() { return mRemaining == 0; });
+    mTask = nullptr;
+}
+
+void WorkerPool::workerLoop()
+{
+    uint64_t generation = 0;
+    while (true)
+    {
+        const std::function<void(uint32_t)>* task;
+        uint32_t taskCount;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWakeCV.wait(lock, [&]() { return mbQuit || mGeneration != generation; });
+            if (mbQuit) return;
+            generation = mGeneration;
+            task = mTask;
+            taskCount = mTaskCount;
+            mActiveWorkers++;
+        }
+
+        // 这一批已经结束时mNextTask不小于taskCount，不会再调用task
+        runTasks(task, taskCount);
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mActiveWorkers--;
+            if (mActiveWorkers == 0)
+            {
+                mDoneCV.notify_all();
+            }
+        }
+    }
+}
+
+void WorkerPool::runTasks(const std::function<void(uint32_t)>* task, uint32_t taskCount)
+{
+    uint32_t taskIndex;
+    while ((taskIndex = mNextTask.fetch_add(1)) < taskCount)
+    {
+        (*task)(taskIndex);
+
+        if (mRemaining.fetch_sub(1) == 1)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mDoneCV.notify_all();
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 简单的常驻线程池，只支持ParallelFor：把[0, taskCount)分给所有线程执行
+// 调用线程也会参与执行，所有任务完成后才返回
+class WorkerPool
+{
+public:
+    void Init(uint32_t workerCount);
+    void Destroy();
+
+    void ParallelFor(uint32_t taskCount, const std::function<void(uint32_t taskIndex)>& task);
+
+    // 包括调用线程在内，可以同时执行任务的线程数
+    uint32_t GetThreadCount() const { return static_cast<uint32_t>(mThreads.size()) + 1; }
+
+private:
+    void workerLoop();
+    // task和taskCount在锁内读取后传进来，执行期间不再读共享的成员
+    void runTasks(const std::function<void(uint32_t)>* task, uint32_t taskCount);
+
+private:
+    std::vector<std::thread> mThreads;
+
+    std::mutex mMutex;
+    std::condition_variable mWakeCV;
+    std::condition_variable mDoneCV;
+
+    // mTask、mTaskCount、mGeneration和mActiveWorkers只在锁内读写
+    const std::function<void(uint32_t)>* mTask = nullptr;
+    uint32_t mTaskCount = 0;
+    std::atomic<uint32_t> mNextTask {0};
+    std::atomic<uint32_t> mRemaining {0};
+    uint64_t mGeneration = 0;
+    // 正在runTasks里的工作线程数，为0时才能重置mNextTask发布下一批
+    uint32_t mActiveWorkers = 0;
+    bool mbQuit = false;
+};
\ No newline at end of file
@@ -3,6 +3,7 @@
 int main(int argc, char* argv[])
 {
     VulkanEngine engine;
+    engine.mConfig = EngineConfig::FromCommandLine(argc, argv);
 
     engine.Init();
     engine.Run();